@@ -280,6 +280,55 @@ using firebase::firestore::local::LevelDbTransaction;
   XCTAssertFalse(it->Valid());
 }
 
+- (void)testCurrentEntryRemainsValidAfterChanges {
+  Status status = _db->Put(LevelDbTransaction::DefaultWriteOptions(), "key_0", "value_0");
+  XCTAssertTrue(status.ok());
+
+  LevelDbTransaction transaction(_db.get(), "testCurrentEntryRemainsValidAfterChanges");
+  transaction.Put("key_1", "value_1");
+
+  // Changing the entry an iterator points to doesn't affect what it reads until it moves on,
+  // whether the entry is committed or pending.
+  auto it = transaction.NewIterator();
+  it->Seek("key_0");
+  XCTAssertEqual("key_0", it->key());
+  transaction.Put("key_0", "new_value_0");
+  XCTAssertEqual("value_0", it->value());
+
+  it->Next();
+  XCTAssertEqual("key_1", it->key());
+  transaction.Put("key_1", "new_value_1");
+  XCTAssertEqual("value_1", it->value());
+  transaction.Delete("key_1");
+  XCTAssertEqual("key_1", it->key());
+  XCTAssertEqual("value_1", it->value());
+
+  it->Next();
+  XCTAssertFalse(it->Valid());
+}
+
+- (void)testPendingEntryRemainsValidAfterShorterOverwrites {
+  LevelDbTransaction transaction(_db.get(), "testPendingEntryRemainsValidAfterShorterOverwrites");
+  transaction.Put("key_0", "original");
+
+  // Overwriting a pending entry with a value that fits in the old one's space, or deleting and
+  // then putting it again, doesn't change what an iterator on that entry reads.
+  auto it = transaction.NewIterator();
+  it->Seek("key_0");
+  XCTAssertEqual("key_0", it->key());
+  transaction.Put("key_0", "short");
+  XCTAssertEqual("original", it->value());
+  transaction.Put("key_0", "equal");
+  XCTAssertEqual("original", it->value());
+  transaction.Delete("key_0");
+  transaction.Put("key_0", "other");
+  XCTAssertEqual("key_0", it->key());
+  XCTAssertEqual("original", it->value());
+
+  it->Seek("key_0");
+  XCTAssertEqual("other", it->value());
+}
+
 - (void)testToString {
   std::string key = LevelDbMutationKey::Key("user1", 42);
   FSTPBWriteBatch *message = [FSTPBWriteBatch message];
@@ -20,6 +20,7 @@
 
 #import "Firestore/Source/Local/FSTPersistence.h"
 #include "Firestore/core/src/firebase/firestore/core/database_info.h"
+#include "Firestore/core/src/firebase/firestore/local/leveldb_options.h"
 #include "Firestore/core/src/firebase/firestore/local/leveldb_transaction.h"
 #include "leveldb/db.h"
 
@@ -32,11 +33,17 @@ NS_ASSUME_NONNULL_BEGIN
 @interface FSTLevelDB : NSObject <FSTPersistence, FSTTransactional>
 
 /**
- * Initializes the LevelDB in the given directory. Note that all expensive startup work including
- * opening any database files is deferred until -[FSTPersistence start] is called.
+ * Initializes the LevelDB in the given directory, tuned with the given options. Note that all
+ * expensive startup work including opening any database files is deferred until
+ * -[FSTPersistence start] is called.
  */
 - (instancetype)initWithDirectory:(NSString *)directory
-                       serializer:(FSTLocalSerializer *)serializer NS_DESIGNATED_INITIALIZER;
+                       serializer:(FSTLocalSerializer *)serializer
+                          options:(const firebase::firestore::local::LevelDbOptions &)options
+    NS_DESIGNATED_INITIALIZER;
+
+/** Initializes the LevelDB in the given directory with the default LevelDbOptions. */
+- (instancetype)initWithDirectory:(NSString *)directory serializer:(FSTLocalSerializer *)serializer;
 
 - (instancetype)init __attribute__((unavailable("Use -initWithDirectory: instead.")));
 
@@ -94,6 +101,12 @@ NS_ASSUME_NONNULL_BEGIN
  */
 + (NSString *)descriptionOfStatus:(leveldb::Status)status;
 
+/**
+ * Counters of the reads made from the database, including how many table reads lookups of absent
+ * keys cost.
+ */
+- (const firebase::firestore::local::LevelDbStats &)stats;
+
 /** The native db pointer, allocated during start. */
 @property(nonatomic, assign, readonly) leveldb::DB *ptr;
 
@@ -31,6 +31,7 @@
 #include "Firestore/core/src/firebase/firestore/local/leveldb_transaction.h"
 #include "Firestore/core/src/firebase/firestore/model/database_id.h"
 #include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
+#include "Firestore/core/src/firebase/firestore/util/log.h"
 #include "Firestore/core/src/firebase/firestore/util/string_apple.h"
 #include "absl/memory/memory.h"
 #include "leveldb/db.h"
@@ -44,9 +45,11 @@ NS_ASSUME_NONNULL_BEGIN
 
 static NSString *const kReservedPathComponent = @"firestore";
 
+using firebase::firestore::local::LevelDbConfig;
+using firebase::firestore::local::LevelDbOptions;
+using firebase::firestore::local::LevelDbStats;
 using firebase::firestore::local::LevelDbTransaction;
 using leveldb::DB;
-using leveldb::Options;
 using leveldb::ReadOptions;
 using leveldb::Status;
 using leveldb::WriteOptions;
@@ -60,6 +63,8 @@ using leveldb::WriteOptions;
 @end
 
 @implementation FSTLevelDB {
+  // Declared before _ptr so that it's destroyed after the database that refers to it.
+  std::unique_ptr<LevelDbConfig> _config;
   std::unique_ptr<LevelDbTransaction> _transaction;
   std::unique_ptr<leveldb::DB> _ptr;
   FSTTransactionRunner _transactionRunner;
@@ -76,9 +81,16 @@ using leveldb::WriteOptions;
 
 - (instancetype)initWithDirectory:(NSString *)directory
                        serializer:(FSTLocalSerializer *)serializer {
+  return [self initWithDirectory:directory serializer:serializer options:LevelDbOptions{}];
+}
+
+- (instancetype)initWithDirectory:(NSString *)directory
+                       serializer:(FSTLocalSerializer *)serializer
+                          options:(const LevelDbOptions &)options {
   if (self = [super init]) {
     _directory = [directory copy];
     _serializer = serializer;
+    _config = absl::make_unique<LevelDbConfig>(options);
     _transactionRunner.SetBackingPersistence(self);
   }
   return self;
@@ -88,6 +100,10 @@ using leveldb::WriteOptions;
   return _ptr.get();
 }
 
+- (const LevelDbStats &)stats {
+  return _config->stats();
+}
+
 - (const FSTTransactionRunner &)run {
   return _transactionRunner;
 }
@@ -192,11 +208,8 @@ using leveldb::WriteOptions;
 
 /** Opens the database within the given directory. */
 - (nullable DB *)createDBWithDirectory:(NSString *)directory error:(NSError **)error {
-  Options options;
-  options.create_if_missing = true;
-
   DB *database;
-  Status status = DB::Open(options, [directory UTF8String], &database);
+  Status status = DB::Open(_config->open_options(), [directory UTF8String], &database);
   if (!status.ok()) {
     if (error) {
       NSString *name = [directory lastPathComponent];
@@ -231,7 +244,7 @@ using leveldb::WriteOptions;
 
 - (void)startTransaction:(absl::string_view)label {
   HARD_ASSERT(_transaction == nullptr, "Starting a transaction while one is already outstanding");
-  _transaction = absl::make_unique<LevelDbTransaction>(_ptr.get(), label);
+  _transaction = absl::make_unique<LevelDbTransaction>(_ptr.get(), label, *_config);
 }
 
 - (void)commitTransaction {
@@ -244,6 +257,11 @@ using leveldb::WriteOptions;
   HARD_ASSERT(self.isStarted, "FSTLevelDB shutdown without start!");
   self.started = NO;
   _ptr.reset();
+
+  const LevelDbStats &stats = _config->stats();
+  LOG_DEBUG("LevelDB %s: %s lookups, %s misses costing %s block reads, %s block reads in total",
+            self.directory, stats.lookups.load(), stats.misses.load(),
+            stats.miss_block_reads.load(), stats.block_reads.load());
 }
 
 - (_Nullable id<FSTReferenceDelegate>)referenceDelegate {
@@ -19,6 +19,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #import "Firestore/Protos/objc/firestore/local/Target.pbobjc.h"
 #import "Firestore/Source/Core/FSTQuery.h"
@@ -335,7 +336,7 @@ using firebase::firestore::model::DocumentKeySet;
   auto indexIterator = _db.currentTransaction->NewIterator();
   indexIterator->Seek(indexPrefix);
 
-  DocumentKeySet result;
+  std::vector<DocumentKey> keys;
   FSTLevelDBTargetDocumentKey *rowKey = [[FSTLevelDBTargetDocumentKey alloc] init];
   for (; indexIterator->Valid(); indexIterator->Next()) {
     absl::string_view indexKey = indexIterator->key();
@@ -345,10 +346,11 @@ using firebase::firestore::model::DocumentKeySet;
       break;
     }
 
-    result = result.insert(rowKey.documentKey);
+    keys.emplace_back(rowKey.documentKey);
   }
 
-  return result;
+  // Rows for a target are ordered by document key, so the set can be built in a single pass.
+  return DocumentKeySet::FromSortedRange(keys.begin(), keys.end());
 }
 
 #pragma mark - FSTGarbageSource implementation
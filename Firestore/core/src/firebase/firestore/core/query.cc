@@ -37,7 +37,7 @@ bool Query::Matches(const Document& doc) const {
 }
 
 bool Query::MatchesPath(const Document& doc) const {
-  ResourcePath doc_path = doc.key().path();
+  const ResourcePath& doc_path = doc.key().path();
   if (DocumentKey::IsDocumentKey(path_)) {
     return path_ == doc_path;
   } else {
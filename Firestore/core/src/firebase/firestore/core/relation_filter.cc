@@ -18,6 +18,7 @@
 
 #include <utility>
 
+#include "Firestore/core/src/firebase/firestore/util/comparison.h"
 #include "absl/types/optional.h"
 
 namespace firebase {
@@ -26,6 +27,7 @@ namespace core {
 
 using model::FieldPath;
 using model::FieldValue;
+using util::ComparisonResult;
 
 RelationFilter::RelationFilter(FieldPath field,
                                Operator op,
@@ -54,17 +56,22 @@ bool RelationFilter::MatchesValue(const FieldValue& other) const {
 }
 
 bool RelationFilter::MatchesComparison(const FieldValue& other) const {
+  if (op_ == Operator::Equal) {
+    return other.Equals(value_rhs_);
+  }
+
+  ComparisonResult comparison = other.CompareTo(value_rhs_);
   switch (op_) {
     case Operator::LessThan:
-      return other < value_rhs_;
+      return comparison == ComparisonResult::Ascending;
     case Operator::LessThanOrEqual:
-      return other <= value_rhs_;
-    case Operator::Equal:
-      return other == value_rhs_;
+      return comparison != ComparisonResult::Descending;
     case Operator::GreaterThan:
-      return other > value_rhs_;
+      return comparison == ComparisonResult::Descending;
     case Operator::GreaterThanOrEqual:
-      return other >= value_rhs_;
+      return comparison != ComparisonResult::Ascending;
+    case Operator::Equal:
+      return comparison == ComparisonResult::Same;
   }
   UNREACHABLE();
 }
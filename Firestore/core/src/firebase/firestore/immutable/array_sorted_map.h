@@ -18,11 +18,14 @@
 #define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_ARRAY_SORTED_MAP_H_
 
 #include <algorithm>
-#include <array>
 #include <cassert>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <new>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/firebase/firestore/immutable/keys_view.h"
 #include "Firestore/core/src/firebase/firestore/immutable/map_entry.h"
@@ -41,9 +44,14 @@ namespace impl {
  * saves a heap allocation when compared with std::vector (though std::vector
  * can resize itself while FixedArray cannot).
  *
- * Unlike std::array, FixedArray keeps track of its size and grows up to the
- * fixed_size limit. Inserting more elements than fixed_size will trigger an
- * assertion failure.
+ * Unlike std::array, FixedArray keeps track of its size and grows up to its
+ * capacity, constructing elements only as they're appended. Appending more
+ * elements than the capacity will trigger an assertion failure.
+ *
+ * FixedArray itself is just the interface: its elements are stored in an
+ * InlineArray of one of a few capacities up to kFixedSize, so that a small
+ * map doesn't carry the storage of a large one. Create picks the smallest
+ * capacity that fits.
  *
  * ArraySortedMap does not actually contain its array: it contains a shared_ptr
  * to a FixedArray.
@@ -54,18 +62,29 @@ template <typename T>
 class FixedArray {
  public:
   using size_type = SortedMapBase::size_type;
-  using array_type = std::array<T, SortedMapBase::kFixedSize>;
-  using iterator = typename array_type::iterator;
-  using const_iterator = typename array_type::const_iterator;
+  using const_iterator = const T*;
 
-  FixedArray() {
-  }
+  /**
+   * Creates an empty FixedArray with room for at least `capacity` elements,
+   * which must not be more than kFixedSize.
+   */
+  static std::shared_ptr<FixedArray> Create(size_type capacity);
 
-  template <typename SourceIterator>
-  FixedArray(SourceIterator src_begin, SourceIterator src_end) {
-    append(src_begin, src_end);
+  /**
+   * Returns the capacity of the array that Create allocates to hold `size`
+   * elements.
+   */
+  static size_type CapacityFor(size_type size) {
+    for (size_type capacity = 2; capacity < SortedMapBase::kFixedSize;
+         capacity *= 2) {
+      if (size <= capacity) return capacity;
+    }
+    return SortedMapBase::kFixedSize;
   }
 
+  FixedArray(const FixedArray&) = delete;
+  FixedArray& operator=(const FixedArray&) = delete;
+
   /**
    * Appends to this array, copying from the given src_begin up to but not
    * including the src_end.
@@ -74,9 +93,9 @@ class FixedArray {
   void append(SourceIterator src_begin, SourceIterator src_end) {
     auto appending = static_cast<size_type>(src_end - src_begin);
     auto new_size = size_ + appending;
-    HARD_ASSERT(new_size <= SortedMapBase::kFixedSize);
+    HARD_ASSERT(new_size <= capacity_);
 
-    std::copy(src_begin, src_end, end());
+    std::uninitialized_copy(src_begin, src_end, data_ + size_);
     size_ = new_size;
   }
 
@@ -85,14 +104,14 @@ class FixedArray {
    */
   void append(T&& value) {
     size_type new_size = size_ + 1;
-    HARD_ASSERT(new_size <= SortedMapBase::kFixedSize);
+    HARD_ASSERT(new_size <= capacity_);
 
-    *end() = std::move(value);
+    new (data_ + size_) T(std::move(value));
     size_ = new_size;
   }
 
   const_iterator begin() const {
-    return contents_.begin();
+    return data_;
   }
 
   const_iterator end() const {
@@ -103,19 +122,56 @@ class FixedArray {
     return size_;
   }
 
- private:
-  iterator begin() {
-    return contents_.begin();
+  size_type capacity() const {
+    return capacity_;
   }
 
-  iterator end() {
-    return begin() + size_;
+ protected:
+  FixedArray(T* data, size_type capacity) : data_{data}, capacity_{capacity} {
   }
 
-  array_type contents_;
+  ~FixedArray() {
+    for (size_type i = 0; i < size_; i++) {
+      data_[i].~T();
+    }
+  }
+
+ private:
+  T* data_;
   size_type size_ = 0;
+  size_type capacity_;
+};
+
+/**
+ * The storage for a FixedArray of capacity N.
+ */
+template <typename T, SortedMapBase::size_type N>
+class InlineArray : public FixedArray<T> {
+ public:
+  InlineArray() : FixedArray<T>{reinterpret_cast<T*>(&storage_), N} {
+  }
+
+ private:
+  typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type storage_;
 };
 
+template <typename T>
+std::shared_ptr<FixedArray<T>> FixedArray<T>::Create(size_type capacity) {
+  HARD_ASSERT(capacity <= SortedMapBase::kFixedSize);
+  switch (CapacityFor(capacity)) {
+    case 2:
+      return std::make_shared<InlineArray<T, 2>>();
+    case 4:
+      return std::make_shared<InlineArray<T, 4>>();
+    case 8:
+      return std::make_shared<InlineArray<T, 8>>();
+    case 16:
+      return std::make_shared<InlineArray<T, 16>>();
+    default:
+      return std::make_shared<InlineArray<T, SortedMapBase::kFixedSize>>();
+  }
+}
+
 /**
  * ArraySortedMap is a value type containing a map. It is immutable, but has
  * methods to efficiently create new maps that are mutations of it.
@@ -131,10 +187,18 @@ class ArraySortedMap : public SortedMapBase {
   using value_type = std::pair<K, V>;
 
   /**
-   * The type of the fixed-size array containing entries of value_type.
+   * The type of the bounded-size array containing entries of value_type.
    */
   using array_type = FixedArray<value_type>;
-  using const_iterator = typename array_type::const_iterator;
+
+  /**
+   * Iterators are plain pointers into the array. This is spelled out here
+   * rather than taken from array_type so that naming the iterator type does
+   * not instantiate FixedArray, allowing V to be an incomplete type at the
+   * point where the map type is used as a member (as in a recursive value
+   * type).
+   */
+  using const_iterator = const value_type*;
   using const_key_iterator = util::iterator_first<const_iterator>;
 
   using array_pointer = std::shared_ptr<const array_type>;
@@ -147,14 +211,32 @@ class ArraySortedMap : public SortedMapBase {
   }
 
   /**
-   * Creates an ArraySortedMap containing the given entries.
+   * Creates an ArraySortedMap containing the given entries. The entries need
+   * not be in order. If a key appears more than once, the last value for that
+   * key wins, matching TreeSortedMap::Create.
    */
   ArraySortedMap(std::initializer_list<value_type> entries,
                  const C& comparator = C())
-      : array_{std::make_shared<array_type>(entries.begin(), entries.end())},
+      : array_{SortedArray(entries, key_comparator_type{comparator})},
         key_comparator_{comparator} {
   }
 
+  /**
+   * Creates an ArraySortedMap from the entries in the given range, which must
+   * be in ascending order by key with no duplicate keys.
+   */
+  template <typename Iter>
+  static ArraySortedMap FromSortedRange(Iter begin,
+                                        Iter end,
+                                        const C& comparator = C()) {
+    auto array = array_type::Create(
+        static_cast<size_type>(std::distance(begin, end)));
+    for (; begin != end; ++begin) {
+      array->append(value_type{*begin});
+    }
+    return ArraySortedMap{array, key_comparator_type{comparator}};
+  }
+
   /** Returns true if the map contains no elements. */
   bool empty() const {
     return size() == 0;
@@ -193,7 +275,8 @@ class ArraySortedMap : public SortedMapBase {
 
     // Copy the segment before the found position. If not found, this is
     // everything.
-    auto copy = std::make_shared<array_type>(begin(), pos);
+    auto copy = array_type::Create(replacing_entry ? size() : size() + 1);
+    copy->append(begin(), pos);
 
     // Copy the value to be inserted.
     copy->append({key, value});
@@ -223,7 +306,8 @@ class ArraySortedMap : public SortedMapBase {
       // the result empty.
       return wrap(EmptyArray());
     } else {
-      auto copy = std::make_shared<array_type>(begin(), pos);
+      auto copy = array_type::Create(size() - 1);
+      copy->append(begin(), pos);
       copy->append(pos + 1, current_end);
       return wrap(copy);
     }
@@ -261,6 +345,22 @@ class ArraySortedMap : public SortedMapBase {
     return found == end() ? npos : static_cast<size_type>(found - begin());
   }
 
+  /**
+   * Returns the number of entries in the map whose keys are less than the
+   * given key.
+   */
+  size_type rank(const K& key) const {
+    return static_cast<size_type>(lower_bound(key) - begin());
+  }
+
+  /**
+   * Returns an iterator pointing to the entry at the given index, or end() if
+   * the index is not less than size().
+   */
+  const_iterator iterator_at(size_type index) const {
+    return index < size() ? begin() + index : end();
+  }
+
   /**
    * Finds the first entry in the map containing a key greater than or equal
    * to the given key.
@@ -329,11 +429,29 @@ class ArraySortedMap : public SortedMapBase {
 
  private:
   static array_pointer EmptyArray() {
-    static const array_pointer kEmptyArray =
-        std::make_shared<const array_type>();
+    static const array_pointer kEmptyArray = array_type::Create(0);
     return kEmptyArray;
   }
 
+  static array_pointer SortedArray(std::initializer_list<value_type> entries,
+                                   const key_comparator_type& key_comparator) {
+    std::vector<value_type> sorted{entries};
+    std::stable_sort(sorted.begin(), sorted.end(), key_comparator);
+
+    auto result =
+        array_type::Create(static_cast<typename array_type::size_type>(
+            sorted.size()));
+    for (auto iter = sorted.begin(); iter != sorted.end(); ++iter) {
+      auto next = iter + 1;
+      if (next != sorted.end() && !key_comparator(*iter, *next)) {
+        // Superseded by a later entry with the same key.
+        continue;
+      }
+      result->append(std::move(*iter));
+    }
+    return result;
+  }
+
   ArraySortedMap(const array_pointer& array,
                  const key_comparator_type& key_comparator) noexcept
       : array_{array}, key_comparator_{key_comparator} {
@@ -0,0 +1,1124 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_BTREE_NODE_H_
+#define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_BTREE_NODE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Firestore/core/src/firebase/firestore/immutable/btree_node_iterator.h"
+#include "Firestore/core/src/firebase/firestore/immutable/sorted_map_base.h"
+#include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
+
+namespace firebase {
+namespace firestore {
+namespace immutable {
+namespace impl {
+
+/**
+ * An array of up to N elements stored directly in itself. Unlike FixedArray,
+ * elements are only constructed as they're appended, so T need not be
+ * default-constructible (or cheap to default-construct).
+ */
+template <typename T, size_t N>
+class NodeArray {
+ public:
+  NodeArray() {
+  }
+
+  NodeArray(const NodeArray&) = delete;
+  NodeArray& operator=(const NodeArray&) = delete;
+
+  ~NodeArray() {
+    for (size_t i = 0; i < size_; i++) {
+      data()[i].~T();
+    }
+  }
+
+  void push_back(const T& value) {
+    HARD_ASSERT(size_ < N);
+    new (data() + size_) T(value);
+    size_++;
+  }
+
+  /** Inserts `value` before the element at `pos`, shifting the rest up. */
+  void insert(size_t pos, const T& value) {
+    HARD_ASSERT(size_ < N && pos <= size_);
+    if (pos == size_) {
+      push_back(value);
+      return;
+    }
+    new (data() + size_) T(std::move(data()[size_ - 1]));
+    for (size_t i = size_ - 1; i > pos; i--) {
+      data()[i] = std::move(data()[i - 1]);
+    }
+    data()[pos] = value;
+    size_++;
+  }
+
+  /** Removes the element at `pos`, shifting the rest down. */
+  void erase(size_t pos) {
+    HARD_ASSERT(pos < size_);
+    for (size_t i = pos + 1; i < size_; i++) {
+      data()[i - 1] = std::move(data()[i]);
+    }
+    size_--;
+    data()[size_].~T();
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  const T* begin() const {
+    return data();
+  }
+
+  const T* end() const {
+    return data() + size_;
+  }
+
+  const T& operator[](size_t i) const {
+    return data()[i];
+  }
+
+  T& operator[](size_t i) {
+    return data()[i];
+  }
+
+ private:
+  T* data() {
+    return reinterpret_cast<T*>(&storage_);
+  }
+  const T* data() const {
+    return reinterpret_cast<const T*>(&storage_);
+  }
+
+  typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type storage_;
+  size_t size_ = 0;
+};
+
+/**
+ * BTreeNode is a node in a BTreeSortedMap: a B+ tree whose nodes are immutable
+ * and shared between versions of the map.
+ *
+ * Entries are stored only in leaves, up to kMaxCount to a leaf. Branches hold
+ * up to kMaxCount children, along with the smallest key and the number of
+ * entries under each, so that lookups and find_index can pick a child without
+ * visiting its siblings. Every node other than the root holds at least
+ * kMinCount entries or children, so a tree of n entries is at most about
+ * log16(n) levels deep.
+ *
+ * Modifications copy the path from the root to the affected leaf, splitting
+ * nodes that grow too large and merging those that shrink too small, and
+ * share everything else with the original. InsertInPlace and EraseInPlace
+ * instead modify the nodes along that path that no other tree shares, copying
+ * only those that are shared.
+ */
+template <typename K, typename V>
+class BTreeNode : public SortedMapBase {
+ public:
+  using first_type = K;
+  using second_type = V;
+
+  /** The type of the entries stored in the map. */
+  using value_type = std::pair<K, V>;
+
+  // Unlike LlrbNode, nodes are held by std::shared_ptr rather than an
+  // intrusive count, and aren't allocated from a NodePool. Each node holds up
+  // to kMaxCount entries, so the control block is a small fraction of it and
+  // a B-tree allocates far fewer nodes per update than an LLRB tree.
+  using pointer_type = std::shared_ptr<const BTreeNode>;
+  using const_iterator = BTreeNodeIterator<BTreeNode<K, V>>;
+
+  static constexpr size_type kMaxCount = 32;
+  static constexpr size_type kMinCount = kMaxCount / 2;
+
+  /** A branch's reference to one of its children. */
+  struct Child {
+    K min_key;
+    size_type size;
+    pointer_type node;
+  };
+
+  /** Returns true if this node holds entries rather than children. */
+  bool leaf() const {
+    return height_ == 0;
+  }
+
+  /** Returns the number of levels beneath this node. */
+  size_type height() const {
+    return height_;
+  }
+
+  /** Returns the number of entries at or beneath this node. */
+  size_type size() const {
+    return size_;
+  }
+
+  /** Returns the number of entries in a leaf, or children in a branch. */
+  size_type count() const {
+    return leaf() ? static_cast<size_type>(AsLeaf().entries.size())
+                  : static_cast<size_type>(AsBranch().children.size());
+  }
+
+  /** Returns the entry at the given index of a leaf. */
+  const value_type& entry(size_type index) const {
+    return AsLeaf().entries[index];
+  }
+
+  /** Returns the child at the given index of a branch. */
+  const Child& child(size_type index) const {
+    return AsBranch().children[index];
+  }
+
+  /** Returns the smallest key at or beneath this node. */
+  const K& min_key() const {
+    return leaf() ? entry(0).first : child(0).min_key;
+  }
+
+  /**
+   * In a leaf, returns the index of the first entry whose key is not less
+   * than the given key, or count() if there is none.
+   */
+  template <typename Comparator>
+  size_type LowerBoundIndex(const K& key, const Comparator& comparator) const {
+    const auto& entries = AsLeaf().entries;
+    auto found = std::lower_bound(
+        entries.begin(), entries.end(), key,
+        [&](const value_type& entry, const K& k) {
+          return comparator(entry.first, k);
+        });
+    return static_cast<size_type>(found - entries.begin());
+  }
+
+  /**
+   * In a branch, returns the index of the child whose range of keys includes
+   * the given key: the last child whose smallest key is not greater than the
+   * key, or the first child if the key precedes all of them.
+   */
+  template <typename Comparator>
+  size_type ChildIndex(const K& key, const Comparator& comparator) const {
+    const auto& children = AsBranch().children;
+    auto found = std::upper_bound(
+        children.begin() + 1, children.end(), key,
+        [&](const K& k, const Child& child) {
+          return comparator(k, child.min_key);
+        });
+    return static_cast<size_type>(found - children.begin()) - 1;
+  }
+
+  /**
+   * Builds a tree containing the `size` entries starting at `begin`, which
+   * must be in ascending order by key with no duplicate keys. Returns null if
+   * `size` is zero.
+   */
+  template <typename Iter>
+  static pointer_type FromSortedRange(Iter begin, size_type size);
+
+  /**
+   * Returns a tree with the given key-value pair set/updated in the tree
+   * rooted at `root`, which may be null.
+   */
+  template <typename Comparator>
+  static pointer_type Insert(const pointer_type& root,
+                             const K& key,
+                             const V& value,
+                             const Comparator& comparator);
+
+  /**
+   * Returns a tree without the given key, which may be null if that leaves the
+   * tree empty. Returns `root` itself if the key isn't present.
+   */
+  template <typename Comparator>
+  static pointer_type Erase(const pointer_type& root,
+                            const K& key,
+                            const Comparator& comparator);
+
+  /**
+   * Sets/updates the given key-value pair in the tree rooted at `*root`, which
+   * may be null, modifying in place any node that no other tree shares. The
+   * result is the same as `*root = Insert(*root, key, value, comparator)`.
+   */
+  template <typename Comparator>
+  static void InsertInPlace(pointer_type* root,
+                            const K& key,
+                            const V& value,
+                            const Comparator& comparator);
+
+  /**
+   * Removes the given key from the tree rooted at `*root`, modifying in place
+   * any node that no other tree shares. The result is the same as
+   * `*root = Erase(*root, key, comparator)`.
+   */
+  template <typename Comparator>
+  static void EraseInPlace(pointer_type* root,
+                           const K& key,
+                           const Comparator& comparator);
+
+  /**
+   * Returns a tree without the entries whose keys are in the range
+   * [start_key, end_key), which must not be empty. Returns `root` itself if
+   * there are no such entries.
+   *
+   * Rather than visiting the removed entries, this splits the tree at each end
+   * of the range and joins the outer parts, so it takes O(log n) time
+   * regardless of how many entries are removed.
+   */
+  template <typename Comparator>
+  static pointer_type EraseRange(const pointer_type& root,
+                                 const K& start_key,
+                                 const K& end_key,
+                                 const Comparator& comparator);
+
+  /**
+   * Splits the tree rooted at `root` into a tree of the entries whose keys are
+   * less than the given key, in `left`, and a tree of the rest, in `right`.
+   * Either may be null, and either may be `root` itself if the other is.
+   */
+  template <typename Comparator>
+  static void Split(const pointer_type& root,
+                    const K& key,
+                    const Comparator& comparator,
+                    pointer_type* left,
+                    pointer_type* right);
+
+  /**
+   * Returns a tree of the entries of `left` followed by those of `right`,
+   * whose keys must all be greater than those in `left`. Either may be null.
+   * This takes time proportional to the difference in their heights.
+   */
+  static pointer_type Join(const pointer_type& left, const pointer_type& right);
+
+ private:
+  struct Leaf;
+  struct Branch;
+
+  explicit BTreeNode(size_type height) : height_{height} {
+  }
+
+  const Leaf& AsLeaf() const {
+    return static_cast<const Leaf&>(*this);
+  }
+
+  const Branch& AsBranch() const {
+    return static_cast<const Branch&>(*this);
+  }
+
+  Leaf& AsLeaf() {
+    return static_cast<Leaf&>(*this);
+  }
+
+  Branch& AsBranch() {
+    return static_cast<Branch&>(*this);
+  }
+
+  static BTreeNode& EnsureUnique(pointer_type* node);
+
+  static Child ChildFor(const pointer_type& node) {
+    return Child{node->min_key(), node->size(), node};
+  }
+
+  template <typename Get>
+  static pointer_type MakeLeaf(size_type begin, size_type end, const Get& get);
+
+  template <typename Get>
+  static pointer_type MakeBranch(size_type height,
+                                 size_type begin,
+                                 size_type end,
+                                 const Get& get);
+
+  static size_type SplitPoint(size_type count) {
+    return count <= kMaxCount ? count : count / 2;
+  }
+
+  template <typename Get>
+  static void MakeLeaves(size_type count,
+                         const Get& get,
+                         pointer_type* first,
+                         pointer_type* second);
+
+  template <typename Get>
+  static void MakeBranches(size_type height,
+                           size_type count,
+                           const Get& get,
+                           pointer_type* first,
+                           pointer_type* second);
+
+  static void Concat(const BTreeNode& left,
+                     const BTreeNode& right,
+                     pointer_type* first,
+                     pointer_type* second);
+
+  static pointer_type MakeRoot(const pointer_type& first,
+                               const pointer_type& second);
+
+  static pointer_type Slice(const BTreeNode& branch,
+                            size_type begin,
+                            size_type end);
+
+  static void JoinRight(const pointer_type& left,
+                        const pointer_type& right,
+                        pointer_type* first,
+                        pointer_type* second);
+
+  static void JoinLeft(const pointer_type& left,
+                       const pointer_type& right,
+                       pointer_type* first,
+                       pointer_type* second);
+
+  template <typename Comparator>
+  static void InsertInto(const pointer_type& node,
+                         const K& key,
+                         const V& value,
+                         const Comparator& comparator,
+                         pointer_type* first,
+                         pointer_type* second);
+
+  template <typename Comparator>
+  static pointer_type EraseFrom(const pointer_type& node,
+                                const K& key,
+                                const Comparator& comparator);
+
+  template <typename Comparator>
+  static void InsertIntoInPlace(pointer_type* node,
+                                const K& key,
+                                const V& value,
+                                const Comparator& comparator,
+                                pointer_type* second);
+
+  template <typename Comparator>
+  static void EraseFromInPlace(pointer_type* node,
+                               const K& key,
+                               const Comparator& comparator);
+
+  size_type height_;
+  size_type size_ = 0;
+};
+
+template <typename K, typename V>
+struct BTreeNode<K, V>::Leaf : public BTreeNode<K, V> {
+  Leaf() : BTreeNode{0} {
+  }
+
+  NodeArray<value_type, kMaxCount> entries;
+};
+
+template <typename K, typename V>
+struct BTreeNode<K, V>::Branch : public BTreeNode<K, V> {
+  explicit Branch(size_type height) : BTreeNode{height} {
+  }
+
+  NodeArray<Child, kMaxCount> children;
+};
+
+template <typename K, typename V>
+constexpr typename BTreeNode<K, V>::size_type BTreeNode<K, V>::kMaxCount;
+
+template <typename K, typename V>
+constexpr typename BTreeNode<K, V>::size_type BTreeNode<K, V>::kMinCount;
+
+/**
+ * Makes a leaf holding the entries `get(i)` for i in [begin, end).
+ */
+template <typename K, typename V>
+template <typename Get>
+typename BTreeNode<K, V>::pointer_type BTreeNode<K, V>::MakeLeaf(
+    size_type begin, size_type end, const Get& get) {
+  auto leaf = std::make_shared<Leaf>();
+  for (size_type i = begin; i < end; i++) {
+    leaf->entries.push_back(get(i));
+  }
+  leaf->size_ = end - begin;
+  return leaf;
+}
+
+/**
+ * Makes a branch of the given height holding the children `get(i)` for i in
+ * [begin, end).
+ */
+template <typename K, typename V>
+template <typename Get>
+typename BTreeNode<K, V>::pointer_type BTreeNode<K, V>::MakeBranch(
+    size_type height, size_type begin, size_type end, const Get& get) {
+  auto branch = std::make_shared<Branch>(height);
+  for (size_type i = begin; i < end; i++) {
+    const Child& child = get(i);
+    branch->children.push_back(child);
+    branch->size_ += child.size;
+  }
+  return branch;
+}
+
+/**
+ * Makes a leaf holding the `count` entries `get(i)`, or two leaves splitting
+ * them evenly if they don't fit in one.
+ */
+template <typename K, typename V>
+template <typename Get>
+void BTreeNode<K, V>::MakeLeaves(size_type count,
+                                 const Get& get,
+                                 pointer_type* first,
+                                 pointer_type* second) {
+  size_type split = SplitPoint(count);
+  *first = MakeLeaf(0, split, get);
+  if (split < count) *second = MakeLeaf(split, count, get);
+}
+
+/**
+ * Makes a branch holding the `count` children `get(i)`, or two branches
+ * splitting them evenly if they don't fit in one.
+ */
+template <typename K, typename V>
+template <typename Get>
+void BTreeNode<K, V>::MakeBranches(size_type height,
+                                   size_type count,
+                                   const Get& get,
+                                   pointer_type* first,
+                                   pointer_type* second) {
+  size_type split = SplitPoint(count);
+  *first = MakeBranch(height, 0, split, get);
+  if (split < count) *second = MakeBranch(height, split, count, get);
+}
+
+/**
+ * Combines two adjacent nodes of the same height into one node, or two nodes
+ * of roughly equal size if they don't fit in one.
+ */
+template <typename K, typename V>
+void BTreeNode<K, V>::Concat(const BTreeNode& left,
+                             const BTreeNode& right,
+                             pointer_type* first,
+                             pointer_type* second) {
+  size_type left_count = left.count();
+  size_type count = left_count + right.count();
+  if (left.leaf()) {
+    MakeLeaves(count,
+               [&](size_type i) -> const value_type& {
+                 return i < left_count ? left.entry(i)
+                                       : right.entry(i - left_count);
+               },
+               first, second);
+  } else {
+    MakeBranches(left.height(), count,
+                 [&](size_type i) -> const Child& {
+                   return i < left_count ? left.child(i)
+                                         : right.child(i - left_count);
+                 },
+                 first, second);
+  }
+}
+
+/**
+ * Returns the root of a tree made of `first` and, if it's non-null, `second`,
+ * which are the replacements for a root that may have split. If it did, the
+ * tree grows a level.
+ */
+template <typename K, typename V>
+typename BTreeNode<K, V>::pointer_type BTreeNode<K, V>::MakeRoot(
+    const pointer_type& first, const pointer_type& second) {
+  if (!second) {
+    return first;
+  }
+
+  const Child children[] = {ChildFor(first), ChildFor(second)};
+  return MakeBranch(first->height() + 1, 0, 2,
+                    [&](size_type i) -> const Child& { return children[i]; });
+}
+
+/**
+ * Returns a tree of the children of `branch` in [begin, end), which is null
+ * if there are none and the child itself if there's only one.
+ */
+template <typename K, typename V>
+typename BTreeNode<K, V>::pointer_type BTreeNode<K, V>::Slice(
+    const BTreeNode& branch, size_type begin, size_type end) {
+  if (begin == end) {
+    return nullptr;
+  }
+  if (end - begin == 1) {
+    return branch.child(begin).node;
+  }
+  return MakeBranch(
+      branch.height(), begin, end,
+      [&](size_type i) -> const Child& { return branch.child(i); });
+}
+
+template <typename K, typename V>
+template <typename Iter>
+typename BTreeNode<K, V>::pointer_type BTreeNode<K, V>::FromSortedRange(
+    Iter begin, size_type size) {
+  if (size == 0) {
+    return nullptr;
+  }
+
+  // Splits `count` items into as few nodes as possible, spread evenly so that
+  // every node gets at least kMinCount of them if there's more than one.
+  auto node_sizes = [](size_type count) {
+    size_t nodes = (count + kMaxCount - 1) / kMaxCount;
+    std::vector<size_type> sizes;
+    for (size_t i = 0; i < nodes; i++) {
+      sizes.push_back(static_cast<size_type>(uint64_t{count} * (i + 1) / nodes -
+                                             uint64_t{count} * i / nodes));
+    }
+    return sizes;
+  };
+
+  std::vector<Child> level;
+  for (size_type leaf_size : node_sizes(size)) {
+    auto leaf = std::make_shared<Leaf>();
+    for (size_type i = 0; i < leaf_size; i++, ++begin) {
+      leaf->entries.push_back(*begin);
+    }
+    leaf->size_ = leaf_size;
+    level.push_back(ChildFor(leaf));
+  }
+
+  size_type height = 0;
+  while (level.size() > 1) {
+    height++;
+    std::vector<Child> parents;
+    size_type offset = 0;
+    for (size_type branch_size :
+         node_sizes(static_cast<size_type>(level.size()))) {
+      parents.push_back(ChildFor(
+          MakeBranch(height, offset, offset + branch_size,
+                     [&](size_type i) -> const Child& { return level[i]; })));
+      offset += branch_size;
+    }
+    level = std::move(parents);
+  }
+  return level[0].node;
+}
+
+template <typename K, typename V>
+template <typename Comparator>
+typename BTreeNode<K, V>::pointer_type BTreeNode<K, V>::Insert(
+    const pointer_type& root,
+    const K& key,
+    const V& value,
+    const Comparator& comparator) {
+  if (!root) {
+    const value_type entry{key, value};
+    return MakeLeaf(0, 1, [&](size_type) -> const value_type& {
+      return entry;
+    });
+  }
+
+  pointer_type first;
+  pointer_type second;
+  InsertInto(root, key, value, comparator, &first, &second);
+  return MakeRoot(first, second);
+}
+
+/**
+ * Inserts into the subtree rooted at `node`, producing its replacement in
+ * `first`, or two replacements in `first` and `second` if it had to split.
+ */
+template <typename K, typename V>
+template <typename Comparator>
+void BTreeNode<K, V>::InsertInto(const pointer_type& node,
+                                 const K& key,
+                                 const V& value,
+                                 const Comparator& comparator,
+                                 pointer_type* first,
+                                 pointer_type* second) {
+  size_type count = node->count();
+
+  if (node->leaf()) {
+    size_type pos = node->LowerBoundIndex(key, comparator);
+    bool replacing = pos < count && !comparator(key, node->entry(pos).first);
+    const value_type entry{key, value};
+    if (replacing) {
+      MakeLeaves(count,
+                 [&](size_type i) -> const value_type& {
+                   return i == pos ? entry : node->entry(i);
+                 },
+                 first, second);
+    } else {
+      MakeLeaves(count + 1,
+                 [&](size_type i) -> const value_type& {
+                   return i < pos ? node->entry(i)
+                                  : i == pos ? entry : node->entry(i - 1);
+                 },
+                 first, second);
+    }
+    return;
+  }
+
+  size_type pos = node->ChildIndex(key, comparator);
+  const Child& child = node->child(pos);
+  pointer_type child_first;
+  pointer_type child_second;
+  InsertInto(child.node, key, value, comparator, &child_first, &child_second);
+
+  // The second replacement is only read if the child split.
+  const Child replaced[] = {
+      ChildFor(child_first),
+      ChildFor(child_second ? child_second : child_first)};
+  size_type added = child_second ? 2 : 1;
+  MakeBranches(node->height(), count - 1 + added,
+               [&](size_type i) -> const Child& {
+                 if (i < pos) return node->child(i);
+                 if (i < pos + added) return replaced[i - pos];
+                 return node->child(i - added + 1);
+               },
+               first, second);
+}
+
+template <typename K, typename V>
+template <typename Comparator>
+typename BTreeNode<K, V>::pointer_type BTreeNode<K, V>::Erase(
+    const pointer_type& root, const K& key, const Comparator& comparator) {
+  if (!root) {
+    return root;
+  }
+
+  pointer_type result = EraseFrom(root, key, comparator);
+
+  // Merging children may leave the root with just one, in which case the
+  // tree shrinks a level.
+  while (result && !result->leaf() && result->count() == 1) {
+    result = result->child(0).node;
+  }
+  return result;
+}
+
+/**
+ * Erases from the subtree rooted at `node`, returning its replacement, which
+ * may have fewer than kMinCount entries or children, or be null if it's
+ * empty. Returns `node` itself if the key isn't present.
+ */
+template <typename K, typename V>
+template <typename Comparator>
+typename BTreeNode<K, V>::pointer_type BTreeNode<K, V>::EraseFrom(
+    const pointer_type& node, const K& key, const Comparator& comparator) {
+  size_type count = node->count();
+
+  if (node->leaf()) {
+    size_type pos = node->LowerBoundIndex(key, comparator);
+    if (pos == count || comparator(key, node->entry(pos).first)) {
+      return node;
+    }
+    if (count == 1) {
+      return nullptr;
+    }
+    return MakeLeaf(0, count - 1, [&](size_type i) -> const value_type& {
+      return node->entry(i < pos ? i : i + 1);
+    });
+  }
+
+  size_type pos = node->ChildIndex(key, comparator);
+  const Child& child = node->child(pos);
+  pointer_type erased = EraseFrom(child.node, key, comparator);
+  if (erased == child.node) {
+    return node;
+  }
+
+  if (!erased) {
+    if (count == 1) {
+      return nullptr;
+    }
+    return MakeBranch(node->height(), 0, count - 1,
+                      [&](size_type i) -> const Child& {
+                        return node->child(i < pos ? i : i + 1);
+                      });
+  }
+
+  if (erased->count() >= kMinCount || count == 1) {
+    const Child replaced = ChildFor(erased);
+    return MakeBranch(node->height(), 0, count,
+                      [&](size_type i) -> const Child& {
+                        return i == pos ? replaced : node->child(i);
+                      });
+  }
+
+  // The child is now too small, so combine it with a neighbor, splitting the
+  // two evenly again if they don't fit in one node.
+  size_type left = pos > 0 ? pos - 1 : pos;
+  pointer_type first;
+  pointer_type second;
+  if (left == pos) {
+    Concat(*erased, *node->child(pos + 1).node, &first, &second);
+  } else {
+    Concat(*node->child(left).node, *erased, &first, &second);
+  }
+
+  const Child replaced[] = {ChildFor(first),
+                            ChildFor(second ? second : first)};
+  size_type added = second ? 2 : 1;
+  pointer_type result;
+  pointer_type unused;
+  MakeBranches(node->height(), count - 2 + added,
+               [&](size_type i) -> const Child& {
+                 if (i < left) return node->child(i);
+                 if (i < left + added) return replaced[i - left];
+                 return node->child(i - added + 2);
+               },
+               &result, &unused);
+  return result;
+}
+
+/**
+ * Returns `*node` for modification, first replacing it with a copy if any
+ * other tree shares it. Nodes are only ever created non-const, so once no one
+ * else can see a node it's safe to modify.
+ */
+template <typename K, typename V>
+BTreeNode<K, V>& BTreeNode<K, V>::EnsureUnique(pointer_type* node) {
+  if (node->use_count() != 1) {
+    const BTreeNode& shared = **node;
+    if (shared.leaf()) {
+      *node = MakeLeaf(0, shared.count(),
+                       [&](size_type i) -> const value_type& {
+                         return shared.entry(i);
+                       });
+    } else {
+      *node = MakeBranch(
+          shared.height(), 0, shared.count(),
+          [&](size_type i) -> const Child& { return shared.child(i); });
+    }
+  }
+  return const_cast<BTreeNode&>(**node);
+}
+
+template <typename K, typename V>
+template <typename Comparator>
+void BTreeNode<K, V>::InsertInPlace(pointer_type* root,
+                                    const K& key,
+                                    const V& value,
+                                    const Comparator& comparator) {
+  if (!*root) {
+    *root = Insert(*root, key, value, comparator);
+    return;
+  }
+
+  pointer_type second;
+  InsertIntoInPlace(root, key, value, comparator, &second);
+  if (second) {
+    *root = MakeRoot(*root, second);
+  }
+}
+
+/**
+ * Inserts into the subtree rooted at `*node`, modifying it in place if it's
+ * unshared. If it had to split, `*node` becomes the first half and `second`
+ * the other. Splits build new nodes, as InsertInto does.
+ */
+template <typename K, typename V>
+template <typename Comparator>
+void BTreeNode<K, V>::InsertIntoInPlace(pointer_type* node,
+                                        const K& key,
+                                        const V& value,
+                                        const Comparator& comparator,
+                                        pointer_type* second) {
+  size_type count = (*node)->count();
+
+  if ((*node)->leaf()) {
+    size_type pos = (*node)->LowerBoundIndex(key, comparator);
+    if (pos < count && !comparator(key, (*node)->entry(pos).first)) {
+      EnsureUnique(node).AsLeaf().entries[pos].second = value;
+    } else if (count < kMaxCount) {
+      Leaf& leaf = EnsureUnique(node).AsLeaf();
+      leaf.entries.insert(pos, value_type{key, value});
+      leaf.size_++;
+    } else {
+      pointer_type first;
+      InsertInto(*node, key, value, comparator, &first, second);
+      *node = std::move(first);
+    }
+    return;
+  }
+
+  Branch& branch = EnsureUnique(node).AsBranch();
+  size_type pos = branch.ChildIndex(key, comparator);
+  Child& child = branch.children[pos];
+  size_type old_size = child.size;
+  pointer_type child_second;
+  InsertIntoInPlace(&child.node, key, value, comparator, &child_second);
+  child = ChildFor(child.node);
+  branch.size_ += child.size - old_size;
+  if (!child_second) {
+    return;
+  }
+
+  const Child added = ChildFor(child_second);
+  branch.size_ += added.size;
+  if (count < kMaxCount) {
+    branch.children.insert(pos + 1, added);
+    return;
+  }
+
+  pointer_type first;
+  MakeBranches(branch.height(), count + 1,
+               [&](size_type i) -> const Child& {
+                 if (i <= pos) return branch.child(i);
+                 if (i == pos + 1) return added;
+                 return branch.child(i - 1);
+               },
+               &first, second);
+  *node = std::move(first);
+}
+
+template <typename K, typename V>
+template <typename Comparator>
+void BTreeNode<K, V>::EraseInPlace(pointer_type* root,
+                                   const K& key,
+                                   const Comparator& comparator) {
+  // Check that the key is present first, so that erasing a missing key
+  // doesn't copy any shared nodes.
+  const BTreeNode* node = root->get();
+  while (node && !node->leaf()) {
+    node = node->child(node->ChildIndex(key, comparator)).node.get();
+  }
+  if (!node) {
+    return;
+  }
+  size_type pos = node->LowerBoundIndex(key, comparator);
+  if (pos == node->count() || comparator(key, node->entry(pos).first)) {
+    return;
+  }
+
+  EraseFromInPlace(root, key, comparator);
+  while (*root && !(*root)->leaf() && (*root)->count() == 1) {
+    pointer_type only_child = (*root)->child(0).node;
+    *root = std::move(only_child);
+  }
+}
+
+/**
+ * Erases the key, which must be present, from the subtree rooted at `*node`,
+ * modifying it in place if it's unshared. As with EraseFrom, the result may
+ * have fewer than kMinCount entries or children, or be null if it's empty.
+ * Merges build new nodes, as EraseFrom does.
+ */
+template <typename K, typename V>
+template <typename Comparator>
+void BTreeNode<K, V>::EraseFromInPlace(pointer_type* node,
+                                       const K& key,
+                                       const Comparator& comparator) {
+  size_type count = (*node)->count();
+  if (count == 1 && (*node)->size() == 1) {
+    *node = nullptr;
+    return;
+  }
+
+  if ((*node)->leaf()) {
+    Leaf& leaf = EnsureUnique(node).AsLeaf();
+    leaf.entries.erase(leaf.LowerBoundIndex(key, comparator));
+    leaf.size_--;
+    return;
+  }
+
+  Branch& branch = EnsureUnique(node).AsBranch();
+  size_type pos = branch.ChildIndex(key, comparator);
+  Child& child = branch.children[pos];
+  EraseFromInPlace(&child.node, key, comparator);
+  branch.size_--;
+  if (!child.node) {
+    branch.children.erase(pos);
+    return;
+  }
+
+  child = ChildFor(child.node);
+  if (child.node->count() >= kMinCount || count == 1) {
+    return;
+  }
+
+  // The child is now too small, so combine it with a neighbor, splitting the
+  // two evenly again if they don't fit in one node.
+  size_type left = pos > 0 ? pos - 1 : pos;
+  pointer_type first;
+  pointer_type second;
+  Concat(*branch.child(left).node, *branch.child(left + 1).node, &first,
+         &second);
+  branch.children[left] = ChildFor(first);
+  if (second) {
+    branch.children[left + 1] = ChildFor(second);
+  } else {
+    branch.children.erase(left + 1);
+  }
+}
+
+template <typename K, typename V>
+template <typename Comparator>
+typename BTreeNode<K, V>::pointer_type BTreeNode<K, V>::EraseRange(
+    const pointer_type& root,
+    const K& start_key,
+    const K& end_key,
+    const Comparator& comparator) {
+  pointer_type before;
+  pointer_type rest;
+  Split(root, start_key, comparator, &before, &rest);
+  if (!rest) {
+    return root;
+  }
+
+  pointer_type erased;
+  pointer_type after;
+  Split(rest, end_key, comparator, &erased, &after);
+  if (!erased) {
+    return root;
+  }
+  return Join(before, after);
+}
+
+template <typename K, typename V>
+template <typename Comparator>
+void BTreeNode<K, V>::Split(const pointer_type& root,
+                            const K& key,
+                            const Comparator& comparator,
+                            pointer_type* left,
+                            pointer_type* right) {
+  if (!root) {
+    *left = nullptr;
+    *right = nullptr;
+    return;
+  }
+
+  size_type count = root->count();
+  if (root->leaf()) {
+    size_type pos = root->LowerBoundIndex(key, comparator);
+    auto get = [&](size_type i) -> const value_type& {
+      return root->entry(i);
+    };
+    *left = pos == 0 ? nullptr : pos == count ? root : MakeLeaf(0, pos, get);
+    *right = pos == count ? nullptr
+                          : pos == 0 ? root : MakeLeaf(pos, count, get);
+    return;
+  }
+
+  size_type pos = root->ChildIndex(key, comparator);
+  pointer_type child_left;
+  pointer_type child_right;
+  Split(root->child(pos).node, key, comparator, &child_left, &child_right);
+  if (pos == 0 && !child_left) {
+    *left = nullptr;
+    *right = root;
+  } else if (pos == count - 1 && !child_right) {
+    *left = root;
+    *right = nullptr;
+  } else {
+    // The children on either side of the split one are each valid subtrees,
+    // so they can be joined to the halves of the split child.
+    *left = Join(Slice(*root, 0, pos), child_left);
+    *right = Join(child_right, Slice(*root, pos + 1, count));
+  }
+}
+
+template <typename K, typename V>
+typename BTreeNode<K, V>::pointer_type BTreeNode<K, V>::Join(
+    const pointer_type& left, const pointer_type& right) {
+  if (!left) {
+    return right;
+  }
+  if (!right) {
+    return left;
+  }
+
+  pointer_type first;
+  pointer_type second;
+  if (left->height() == right->height()) {
+    Concat(*left, *right, &first, &second);
+  } else if (left->height() > right->height()) {
+    JoinRight(left, right, &first, &second);
+  } else {
+    JoinLeft(left, right, &first, &second);
+  }
+  return MakeRoot(first, second);
+}
+
+/**
+ * Joins `right` onto the right edge of `left`, which is taller, producing the
+ * replacement for `left` in `first`, or two replacements in `first` and
+ * `second` if it had to split.
+ */
+template <typename K, typename V>
+void BTreeNode<K, V>::JoinRight(const pointer_type& left,
+                                const pointer_type& right,
+                                pointer_type* first,
+                                pointer_type* second) {
+  size_type count = left->count();
+  const pointer_type& last = left->child(count - 1).node;
+  pointer_type last_first;
+  pointer_type last_second;
+  if (last->height() > right->height()) {
+    JoinRight(last, right, &last_first, &last_second);
+  } else if (right->count() >= kMinCount) {
+    // `right` was a root, but is big enough to be an ordinary child.
+    last_first = last;
+    last_second = right;
+  } else {
+    Concat(*last, *right, &last_first, &last_second);
+  }
+
+  const Child replaced[] = {ChildFor(last_first),
+                            ChildFor(last_second ? last_second : last_first)};
+  size_type added = last_second ? 2 : 1;
+  MakeBranches(left->height(), count - 1 + added,
+               [&](size_type i) -> const Child& {
+                 return i < count - 1 ? left->child(i)
+                                      : replaced[i - (count - 1)];
+               },
+               first, second);
+}
+
+/**
+ * Joins `left` onto the left edge of `right`, which is taller, producing the
+ * replacement for `right` in `first`, or two replacements in `first` and
+ * `second` if it had to split.
+ */
+template <typename K, typename V>
+void BTreeNode<K, V>::JoinLeft(const pointer_type& left,
+                               const pointer_type& right,
+                               pointer_type* first,
+                               pointer_type* second) {
+  size_type count = right->count();
+  const pointer_type& head = right->child(0).node;
+  pointer_type head_first;
+  pointer_type head_second;
+  if (head->height() > left->height()) {
+    JoinLeft(left, head, &head_first, &head_second);
+  } else if (left->count() >= kMinCount) {
+    // `left` was a root, but is big enough to be an ordinary child.
+    head_first = left;
+    head_second = head;
+  } else {
+    Concat(*left, *head, &head_first, &head_second);
+  }
+
+  const Child replaced[] = {ChildFor(head_first),
+                            ChildFor(head_second ? head_second : head_first)};
+  size_type added = head_second ? 2 : 1;
+  MakeBranches(right->height(), count - 1 + added,
+               [&](size_type i) -> const Child& {
+                 return i < added ? replaced[i] : right->child(i - added + 1);
+               },
+               first, second);
+}
+
+}  // namespace impl
+}  // namespace immutable
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_BTREE_NODE_H_
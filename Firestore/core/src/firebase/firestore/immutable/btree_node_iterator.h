@@ -0,0 +1,259 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_BTREE_NODE_ITERATOR_H_
+#define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_BTREE_NODE_ITERATOR_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
+#include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
+
+namespace firebase {
+namespace firestore {
+namespace immutable {
+namespace impl {
+
+/**
+ * A forward iterator for traversing BTreeNodes in key order.
+ *
+ * Like LlrbNodeIterator, this keeps an explicit stack of the nodes from the
+ * root down to the current leaf, since shared nodes can't point back to their
+ * parents. B-trees are shallow, so the stack is a small fixed-size array and
+ * creating or copying an iterator doesn't allocate.
+ *
+ * Note: BTreeNodeIterator does not extend the lifetime of its underlying tree.
+ */
+template <typename N>
+class BTreeNodeIterator {
+ public:
+  using node_type = N;
+  using key_type = typename node_type::first_type;
+  using size_type = typename node_type::size_type;
+
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = typename node_type::value_type;
+
+  using pointer = typename node_type::value_type const*;
+  using reference = typename node_type::value_type const&;
+  using difference_type = std::ptrdiff_t;
+
+  /**
+   * The deepest tree this can traverse. Every node but the root has at least
+   * 16 children, so a tree holding 2^32 entries is only 8 levels deep.
+   */
+  static constexpr size_t kMaxDepth = 12;
+
+  // Default constructor to conform to the requirements of ForwardIterator
+  BTreeNodeIterator() {
+  }
+
+  BTreeNodeIterator(const BTreeNodeIterator& other) : depth_{other.depth_} {
+    std::copy(other.stack_, other.stack_ + depth_, stack_);
+  }
+
+  BTreeNodeIterator& operator=(const BTreeNodeIterator& other) {
+    depth_ = other.depth_;
+    std::copy(other.stack_, other.stack_ + depth_, stack_);
+    return *this;
+  }
+
+  /**
+   * Constructs an iterator pointing at the first entry in the tree rooted at
+   * the given node, which may be null.
+   */
+  static BTreeNodeIterator Begin(const node_type* root) {
+    BTreeNodeIterator result;
+    if (root) {
+      result.Push(root, 0);
+      result.DescendLeft();
+    }
+    return result;
+  }
+
+  /** Constructs an iterator pointing past the last entry of any tree. */
+  static BTreeNodeIterator End() {
+    return BTreeNodeIterator{};
+  }
+
+  /**
+   * Constructs an iterator pointing at the last entry in the tree rooted at
+   * the given node, which may be null.
+   */
+  static BTreeNodeIterator Last(const node_type* root) {
+    BTreeNodeIterator result;
+    const node_type* node = root;
+    while (node) {
+      size_type last = node->count() - 1;
+      result.Push(node, last);
+      node = node->leaf() ? nullptr : node->child(last).node.get();
+    }
+    return result;
+  }
+
+  /**
+   * Constructs an iterator pointing to the first entry whose key is not less
+   * than the given key, or an equivalent to `End()` if there is none.
+   */
+  template <typename C>
+  static BTreeNodeIterator LowerBound(const node_type* root,
+                                      const key_type& key,
+                                      const C& comparator) {
+    BTreeNodeIterator result;
+    const node_type* node = root;
+    while (node) {
+      if (node->leaf()) {
+        result.Push(node, node->LowerBoundIndex(key, comparator));
+        break;
+      }
+      size_type index = node->ChildIndex(key, comparator);
+      result.Push(node, index);
+      node = node->child(index).node.get();
+    }
+    result.Normalize();
+    return result;
+  }
+
+  /**
+   * Constructs an iterator pointing to the entry at the given index in the
+   * tree, or an equivalent to `End()` if the index is not less than the size
+   * of the tree.
+   */
+  static BTreeNodeIterator AtIndex(const node_type* root, size_type index) {
+    BTreeNodeIterator result;
+    if (!root || index >= root->size()) {
+      return result;
+    }
+
+    const node_type* node = root;
+    while (!node->leaf()) {
+      size_type pos = 0;
+      while (index >= node->child(pos).size) {
+        index -= node->child(pos).size;
+        pos++;
+      }
+      result.Push(node, pos);
+      node = node->child(pos).node.get();
+    }
+    result.Push(node, index);
+    return result;
+  }
+
+  /**
+   * Returns true if this iterator points at the end of the iteration sequence.
+   */
+  bool is_end() const {
+    return depth_ == 0;
+  }
+
+  /**
+   * Returns the address of the entry that this iterator points to. This can
+   * only be called if `is_end()` is false.
+   */
+  pointer get() const {
+    HARD_ASSERT(!is_end());
+    const Frame& leaf = stack_[depth_ - 1];
+    return &leaf.node->entry(leaf.index);
+  }
+
+  reference operator*() const {
+    return *get();
+  }
+
+  pointer operator->() const {
+    return get();
+  }
+
+  BTreeNodeIterator& operator++() {
+    HARD_ASSERT(!is_end());
+    stack_[depth_ - 1].index++;
+    Normalize();
+    return *this;
+  }
+
+  BTreeNodeIterator operator++(int /*unused*/) {
+    BTreeNodeIterator result = *this;
+    ++*this;
+    return result;
+  }
+
+  friend bool operator==(const BTreeNodeIterator& a,
+                         const BTreeNodeIterator& b) {
+    if (a.is_end() || b.is_end()) {
+      return a.is_end() == b.is_end();
+    }
+    const Frame& a_leaf = a.stack_[a.depth_ - 1];
+    const Frame& b_leaf = b.stack_[b.depth_ - 1];
+    return a_leaf.node == b_leaf.node && a_leaf.index == b_leaf.index;
+  }
+
+  bool operator!=(const BTreeNodeIterator& b) const {
+    return !(*this == b);
+  }
+
+ private:
+  struct Frame {
+    const node_type* node;
+    size_type index;
+  };
+
+  void Push(const node_type* node, size_type index) {
+    HARD_ASSERT(depth_ < kMaxDepth, "B-tree is too deep");
+    stack_[depth_++] = Frame{node, index};
+  }
+
+  /**
+   * Descends from the current position to the first entry beneath it.
+   */
+  void DescendLeft() {
+    const Frame* top = &stack_[depth_ - 1];
+    while (!top->node->leaf()) {
+      Push(top->node->child(top->index).node.get(), 0);
+      top = &stack_[depth_ - 1];
+    }
+  }
+
+  /**
+   * If the current position is past the end of its leaf, moves to the first
+   * entry of the next leaf, or to the end if there is none.
+   */
+  void Normalize() {
+    while (depth_ > 0 && stack_[depth_ - 1].index >=
+                             stack_[depth_ - 1].node->count()) {
+      depth_--;
+      if (depth_ > 0) {
+        stack_[depth_ - 1].index++;
+      }
+    }
+    if (depth_ > 0) {
+      DescendLeft();
+    }
+  }
+
+  Frame stack_[kMaxDepth];
+  size_t depth_ = 0;
+};
+
+template <typename N>
+constexpr size_t BTreeNodeIterator<N>::kMaxDepth;
+
+}  // namespace impl
+}  // namespace immutable
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_BTREE_NODE_ITERATOR_H_
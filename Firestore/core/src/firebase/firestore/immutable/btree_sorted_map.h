@@ -0,0 +1,481 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_BTREE_SORTED_MAP_H_
+#define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_BTREE_SORTED_MAP_H_
+
+#include <cstddef>
+#include <utility>
+
+#include "Firestore/core/src/firebase/firestore/immutable/btree_node.h"
+#include "Firestore/core/src/firebase/firestore/immutable/keys_view.h"
+#include "Firestore/core/src/firebase/firestore/immutable/map_entry.h"
+#include "Firestore/core/src/firebase/firestore/immutable/sorted_map_base.h"
+#include "Firestore/core/src/firebase/firestore/util/comparator_holder.h"
+#include "Firestore/core/src/firebase/firestore/util/comparison.h"
+#include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
+
+namespace firebase {
+namespace firestore {
+namespace immutable {
+namespace impl {
+
+/**
+ * BTreeSortedMap is a value type containing a map. It is immutable, but has
+ * methods to efficiently create new maps that are mutations of it.
+ *
+ * Compared with TreeSortedMap, each node holds many entries, so large maps
+ * take fewer, more cache-friendly steps to search and iterate, at the cost of
+ * copying more per modification. See BTreeNode.
+ */
+template <typename K, typename V, typename C = util::Comparator<K>>
+class BTreeSortedMap : public SortedMapBase,
+                       public util::ComparatorHolder<C> {
+ public:
+  /**
+   * The type of the entries stored in the map.
+   */
+  using value_type = std::pair<K, V>;
+
+  /**
+   * The type of the nodes containing entries of value_type.
+   */
+  using node_type = BTreeNode<K, V>;
+  using node_pointer = typename node_type::pointer_type;
+  using const_iterator = typename node_type::const_iterator;
+  using const_key_iterator = util::iterator_first<const_iterator>;
+
+  /**
+   * Creates an empty BTreeSortedMap.
+   */
+  explicit BTreeSortedMap(const C& comparator = {})
+      : util::ComparatorHolder<C>{comparator} {
+  }
+
+  /**
+   * Creates a BTreeSortedMap from the `size` entries starting at `begin`,
+   * which must be in ascending order by key with no duplicate keys. This takes
+   * linear time.
+   */
+  template <typename Iter>
+  static BTreeSortedMap FromSortedRange(Iter begin,
+                                        size_type size,
+                                        const C& comparator) {
+    return BTreeSortedMap{node_type::FromSortedRange(begin, size), comparator};
+  }
+
+  /** Returns true if the map contains no elements. */
+  bool empty() const {
+    return root_ == nullptr;
+  }
+
+  /** Returns the number of items in this map. */
+  size_type size() const {
+    return root_ ? root_->size() : 0;
+  }
+
+  /** Returns the root node of the tree, or null if the map is empty. */
+  const node_type* root() const {
+    return root_.get();
+  }
+
+  /**
+   * Creates a new map identical to this one, but with a key-value pair added or
+   * updated.
+   *
+   * @param key The key to insert/update.
+   * @param value The value to associate with the key.
+   * @return A new dictionary with the added/updated value.
+   */
+  BTreeSortedMap insert(const K& key, const V& value) const {
+    const C& comparator = this->comparator();
+    return BTreeSortedMap{node_type::Insert(root_, key, value, comparator),
+                          comparator};
+  }
+
+  /**
+   * Creates a new map identical to this one, but with a key removed from it.
+   *
+   * @param key The key to remove.
+   * @return A new map without that value.
+   */
+  BTreeSortedMap erase(const K& key) const {
+    const C& comparator = this->comparator();
+    return BTreeSortedMap{node_type::Erase(root_, key, comparator),
+                          comparator};
+  }
+
+  /**
+   * Adds or updates a key-value pair in this map, reusing any nodes that no
+   * other map shares. Equivalent to `*this = insert(key, value)`.
+   */
+  void InsertInPlace(const K& key, const V& value) {
+    node_type::InsertInPlace(&root_, key, value, this->comparator());
+  }
+
+  /**
+   * Removes a key from this map, reusing any nodes that no other map shares.
+   * Equivalent to `*this = erase(key)`.
+   */
+  void EraseInPlace(const K& key) {
+    node_type::EraseInPlace(&root_, key, this->comparator());
+  }
+
+  /**
+   * Creates a new map identical to this one, but without the entries whose
+   * keys are greater than or equal to `start_key` and less than `end_key`.
+   * This takes O(log n) time, however many entries are removed.
+   */
+  BTreeSortedMap erase_range(const K& start_key, const K& end_key) const {
+    const C& comparator = this->comparator();
+    if (!comparator(start_key, end_key)) {
+      return *this;
+    }
+    return BTreeSortedMap{
+        node_type::EraseRange(root_, start_key, end_key, comparator),
+        comparator};
+  }
+
+  /**
+   * Reports the differences between `old_map` and `new_map`, in key order:
+   * calls `on_removed(entry)` for each entry only in `old_map`,
+   * `on_added(entry)` for each entry only in `new_map`, and
+   * `on_changed(old_entry, new_entry)` for each key whose value differs.
+   *
+   * Subtrees that both maps share are skipped without being visited, so when
+   * `new_map` was derived from `old_map` by a few updates this only visits
+   * the nodes along the paths those updates copied: O(changes * log n) rather
+   * than O(n).
+   */
+  template <typename OnRemoved, typename OnAdded, typename OnChanged>
+  static void Diff(const BTreeSortedMap& old_map,
+                   const BTreeSortedMap& new_map,
+                   OnRemoved&& on_removed,
+                   OnAdded&& on_added,
+                   OnChanged&& on_changed) {
+    if (old_map.root_ == new_map.root_) {
+      return;
+    }
+
+    const C& comparator = new_map.comparator();
+    DiffCursor old_cursor{old_map.root_.get()};
+    DiffCursor new_cursor{new_map.root_.get()};
+
+    while (!old_cursor.done() && !new_cursor.done()) {
+      if (!old_cursor.at_entry() && !new_cursor.at_entry() &&
+          old_cursor.subtree() == new_cursor.subtree()) {
+        old_cursor.Next();
+        new_cursor.Next();
+        continue;
+      }
+
+      const K& old_key = old_cursor.min_key();
+      const K& new_key = new_cursor.min_key();
+      if (comparator(old_key, new_key)) {
+        if (old_cursor.at_entry()) {
+          on_removed(old_cursor.entry());
+          old_cursor.Next();
+        } else {
+          old_cursor.Descend();
+        }
+      } else if (comparator(new_key, old_key)) {
+        if (new_cursor.at_entry()) {
+          on_added(new_cursor.entry());
+          new_cursor.Next();
+        } else {
+          new_cursor.Descend();
+        }
+      } else if (old_cursor.at_entry() && new_cursor.at_entry()) {
+        if (!(old_cursor.entry().second == new_cursor.entry().second)) {
+          on_changed(old_cursor.entry(), new_cursor.entry());
+        }
+        old_cursor.Next();
+        new_cursor.Next();
+      } else {
+        // Both start with the same key, so descend whichever is the larger
+        // subtree until both are at subtrees of the same height, which are
+        // either shared or have to be compared entry by entry.
+        size_type old_level = old_cursor.level();
+        size_type new_level = new_cursor.level();
+        if (old_level >= new_level) old_cursor.Descend();
+        if (new_level >= old_level) new_cursor.Descend();
+      }
+    }
+
+    for (; !old_cursor.done(); old_cursor.Next()) {
+      old_cursor.DescendToEntry();
+      on_removed(old_cursor.entry());
+    }
+    for (; !new_cursor.done(); new_cursor.Next()) {
+      new_cursor.DescendToEntry();
+      on_added(new_cursor.entry());
+    }
+  }
+
+  bool contains(const K& key) const {
+    // Search without building up the stack required to construct a full
+    // iterator.
+    const C& comparator = this->comparator();
+    const node_type* node = root_.get();
+    while (node && !node->leaf()) {
+      node = node->child(node->ChildIndex(key, comparator)).node.get();
+    }
+    if (!node) {
+      return false;
+    }
+    size_type pos = node->LowerBoundIndex(key, comparator);
+    return pos < node->count() && !comparator(key, node->entry(pos).first);
+  }
+
+  /**
+   * Finds a value in the map.
+   *
+   * @param key The key to look up.
+   * @return An iterator pointing to the entry containing the key, or end() if
+   *     not found.
+   */
+  const_iterator find(const K& key) const {
+    const_iterator found = lower_bound(key);
+    if (!found.is_end() && !this->comparator()(key, found->first)) {
+      return found;
+    } else {
+      return end();
+    }
+  }
+
+  /**
+   * Finds the index of the given key in the map.
+   *
+   * @param key The key to look up.
+   * @return The index of the entry containing the key, or npos if not found.
+   */
+  size_type find_index(const K& key) const {
+    const C& comparator = this->comparator();
+
+    size_type preceding = 0;
+    const node_type* node = root_.get();
+    while (node && !node->leaf()) {
+      size_type index = node->ChildIndex(key, comparator);
+      for (size_type i = 0; i < index; i++) {
+        preceding += node->child(i).size;
+      }
+      node = node->child(index).node.get();
+    }
+    if (!node) {
+      return npos;
+    }
+
+    size_type pos = node->LowerBoundIndex(key, comparator);
+    if (pos < node->count() && !comparator(key, node->entry(pos).first)) {
+      return preceding + pos;
+    }
+    return npos;
+  }
+
+  /**
+   * Returns the number of entries in the map whose keys are less than the
+   * given key.
+   */
+  size_type rank(const K& key) const {
+    const C& comparator = this->comparator();
+
+    size_type preceding = 0;
+    const node_type* node = root_.get();
+    while (node && !node->leaf()) {
+      size_type index = node->ChildIndex(key, comparator);
+      for (size_type i = 0; i < index; i++) {
+        preceding += node->child(i).size;
+      }
+      node = node->child(index).node.get();
+    }
+    return node ? preceding + node->LowerBoundIndex(key, comparator) : 0;
+  }
+
+  /**
+   * Returns an iterator pointing to the entry at the given index, or end() if
+   * the index is not less than size().
+   */
+  const_iterator iterator_at(size_type index) const {
+    return const_iterator::AtIndex(root_.get(), index);
+  }
+
+  /**
+   * Finds the first entry in the map containing a key greater than or equal
+   * to the given key.
+   *
+   * @param key The key to look up.
+   * @return An iterator pointing to the entry containing the key or the next
+   *     largest key. Can return end() if all keys in the map are less than the
+   *     requested key.
+   */
+  const_iterator lower_bound(const K& key) const {
+    return const_iterator::LowerBound(root_.get(), key, this->comparator());
+  }
+
+  const_iterator min() const {
+    return begin();
+  }
+
+  const_iterator max() const {
+    return const_iterator::Last(root_.get());
+  }
+
+  /**
+   * Returns a forward iterator pointing to the first entry in the map. If there
+   * are no entries in the map, begin() == end().
+   *
+   * See BTreeNodeIterator for details
+   */
+  const_iterator begin() const {
+    return const_iterator::Begin(root_.get());
+  }
+
+  /**
+   * Returns an iterator pointing past the last entry in the map.
+   */
+  const_iterator end() const {
+    return const_iterator::End();
+  }
+
+  /**
+   * Returns a view of this SortedMap containing just the keys that have been
+   * inserted.
+   */
+  const util::range<const_key_iterator> keys() const {
+    return KeysView(*this);
+  }
+
+  /**
+   * Returns a view of this SortedMap containing just the keys that have been
+   * inserted that are greater than or equal to the given key.
+   */
+  const util::range<const_key_iterator> keys_from(const K& key) const {
+    return KeysViewFrom(*this, key);
+  }
+
+  /**
+   * Returns a view of this SortedMap containing just the keys that have been
+   * inserted that are greater than or equal to the given start_key and less
+   * than the given end_key.
+   */
+  const util::range<const_key_iterator> keys_in(const K& start_key,
+                                                const K& end_key) const {
+    return impl::KeysViewIn(*this, start_key, end_key, this->comparator());
+  }
+
+ private:
+  /**
+   * A position in a tree for Diff: either a whole subtree, which Diff may skip
+   * or descend into, or a single entry in a leaf. Like BTreeNodeIterator, this
+   * keeps the path from the root in a fixed-size stack.
+   */
+  class DiffCursor {
+   public:
+    explicit DiffCursor(const node_type* root) {
+      if (root) {
+        stack_[depth_++] = {root, 0};
+      }
+    }
+
+    /** Returns true if the cursor has passed the end of the tree. */
+    bool done() const {
+      return depth_ == 0;
+    }
+
+    bool at_entry() const {
+      return top().node->leaf();
+    }
+
+    const value_type& entry() const {
+      return top().node->entry(top().index);
+    }
+
+    /** Returns the subtree at the cursor, if it isn't at_entry(). */
+    const node_type* subtree() const {
+      return top().node->child(top().index).node.get();
+    }
+
+    /**
+     * Returns the height of the subtree at the cursor, counting an entry as
+     * height zero.
+     */
+    size_type level() const {
+      return top().node->height();
+    }
+
+    /** Returns the first key in the subtree or the key of the entry. */
+    const K& min_key() const {
+      const Frame& frame = top();
+      return frame.node->leaf() ? frame.node->entry(frame.index).first
+                                : frame.node->child(frame.index).min_key;
+    }
+
+    /** Moves to the first child of the subtree at the cursor. */
+    void Descend() {
+      HARD_ASSERT(depth_ < kMaxDepth, "B-tree is too deep");
+      stack_[depth_] = {subtree(), 0};
+      depth_++;
+    }
+
+    /** Moves past the entry or whole subtree at the cursor. */
+    void Next() {
+      while (depth_ > 0) {
+        Frame& frame = stack_[depth_ - 1];
+        frame.index++;
+        if (frame.index < frame.node->count()) {
+          return;
+        }
+        depth_--;
+      }
+    }
+
+    /** Moves to the first entry in the subtree at the cursor, if any. */
+    void DescendToEntry() {
+      while (!at_entry()) {
+        Descend();
+      }
+    }
+
+   private:
+    static constexpr size_t kMaxDepth =
+        BTreeNodeIterator<node_type>::kMaxDepth;
+
+    struct Frame {
+      const node_type* node;
+      size_type index;
+    };
+
+    const Frame& top() const {
+      return stack_[depth_ - 1];
+    }
+
+    Frame stack_[kMaxDepth];
+    size_t depth_ = 0;
+  };
+
+  BTreeSortedMap(node_pointer&& root, const C& comparator) noexcept
+      : util::ComparatorHolder<C>{comparator}, root_{std::move(root)} {
+  }
+
+  node_pointer root_;
+};
+
+}  // namespace impl
+}  // namespace immutable
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_BTREE_SORTED_MAP_H_
@@ -54,28 +54,45 @@ auto KeysViewFrom(const Range& range, const K& key)
 }
 
 /**
- * Returns a view of keys of the given key-value range that are greater than or
- * equal to the given start_key and less than the given end_key.
+ * Returns a view of the entries of the given key-value range whose keys are
+ * greater than or equal to the given start_key and less than the given
+ * end_key.
  *
  * If `end_key` is less than or equal to `start_key`, creates empty range.
  */
 template <typename Range, typename K, typename C>
-auto KeysViewIn(const Range& range,
-                const K& start_key,
-                const K& end_key,
-                const C& comparator)
-    -> KeysRange<decltype(range.lower_bound(start_key))> {
+auto ViewIn(const Range& range,
+            const K& start_key,
+            const K& end_key,
+            const C& comparator)
+    -> util::range<decltype(range.lower_bound(start_key))> {
   // Forward iterators can't ever reach the end if the end is behind the start:
   // they just keep incrementing until address space runs out. Adjust the range
   // accordingly.
   bool empty_range = !comparator(start_key, end_key);
   if (empty_range) {
-    return MakeKeysRange(std::end(range), std::end(range));
+    return util::make_range(std::end(range), std::end(range));
   }
 
   auto range_begin = range.lower_bound(start_key);
   auto range_end = range.lower_bound(end_key);
-  return MakeKeysRange(std::move(range_begin), std::move(range_end));
+  return util::make_range(std::move(range_begin), std::move(range_end));
+}
+
+/**
+ * Returns a view of keys of the given key-value range that are greater than or
+ * equal to the given start_key and less than the given end_key.
+ *
+ * If `end_key` is less than or equal to `start_key`, creates empty range.
+ */
+template <typename Range, typename K, typename C>
+auto KeysViewIn(const Range& range,
+                const K& start_key,
+                const K& end_key,
+                const C& comparator)
+    -> KeysRange<decltype(range.lower_bound(start_key))> {
+  auto entries = ViewIn(range, start_key, end_key, comparator);
+  return MakeKeysRange(entries.begin(), entries.end());
 }
 
 }  // namespace impl
@@ -17,11 +17,14 @@
 #ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_LLRB_NODE_H_
 #define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_LLRB_NODE_H_
 
-#include <memory>
+#include <atomic>
+#include <cstdint>
 #include <utility>
 
 #include "Firestore/core/src/firebase/firestore/immutable/llrb_node_iterator.h"
+#include "Firestore/core/src/firebase/firestore/immutable/node_pool.h"
 #include "Firestore/core/src/firebase/firestore/immutable/sorted_map_base.h"
+#include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
 
 namespace firebase {
 namespace firestore {
@@ -38,6 +41,12 @@ enum Color : unsigned int {
 
 /**
  * LlrbNode is a node in a TreeSortedMap.
+ *
+ * An LlrbNode is a reference-counted pointer to an immutable Rep holding the
+ * node's contents. The count lives in the Rep itself and Reps are allocated
+ * from a NodePool, so copying a node or building a new one is cheap compared
+ * with std::shared_ptr. Empty nodes all share one Rep that is never counted
+ * or freed.
  */
 template <typename K, typename V>
 class LlrbNode : public SortedMapBase {
@@ -54,7 +63,36 @@ class LlrbNode : public SortedMapBase {
   /**
    * Constructs an empty node.
    */
-  LlrbNode() : LlrbNode{EmptyRep()} {
+  LlrbNode() : rep_{EmptyRep()} {
+  }
+
+  LlrbNode(const LlrbNode& other) : rep_{other.rep_} {
+    Retain(rep_);
+  }
+
+  LlrbNode(LlrbNode&& other) noexcept : rep_{other.rep_} {
+    other.rep_ = EmptyRep();
+  }
+
+  ~LlrbNode() {
+    Release(rep_);
+  }
+
+  LlrbNode& operator=(const LlrbNode& other) {
+    // `other` may be part of the tree released below, so take its Rep first.
+    Rep* rep = other.rep_;
+    Retain(rep);
+    Reset(rep);
+    return *this;
+  }
+
+  LlrbNode& operator=(LlrbNode&& other) noexcept {
+    if (this != &other) {
+      Rep* rep = other.rep_;
+      other.rep_ = EmptyRep();
+      Reset(rep);
+    }
+    return *this;
   }
 
   /** Returns true if this is an empty node--a leaf node in the tree. */
@@ -91,6 +129,16 @@ class LlrbNode : public SortedMapBase {
     return rep_->right_;
   }
 
+  /**
+   * Builds a balanced tree containing the `size` entries starting at `begin`,
+   * which must be in ascending order by key with no duplicate keys.
+   *
+   * Unlike inserting the entries one at a time, this takes linear time and
+   * allocates exactly one node per entry.
+   */
+  template <typename Iter>
+  static LlrbNode FromSortedRange(Iter begin, size_type size);
+
   /** Returns a tree node with the given key-value pair set/updated. */
   template <typename Comparator>
   LlrbNode insert(const K& key,
@@ -100,6 +148,31 @@ class LlrbNode : public SortedMapBase {
   template <typename Comparator>
   LlrbNode erase(const K& key, const Comparator& comparator) const;
 
+  /**
+   * Sets/updates the given key-value pair in the tree rooted at this node,
+   * modifying nodes in place where they aren't shared with any other tree.
+   *
+   * The result is the same as `*this = insert(key, value, comparator)`, but
+   * nodes that only this tree refers to (for example, those created by an
+   * earlier in-place update) are reused rather than copied.
+   */
+  template <typename Comparator>
+  void InsertInPlace(const K& key,
+                     const V& value,
+                     const Comparator& comparator);
+
+  /**
+   * Removes the given key from the tree rooted at this node, modifying nodes in
+   * place where they aren't shared with any other tree. See InsertInPlace.
+   */
+  template <typename Comparator>
+  void EraseInPlace(const K& key, const Comparator& comparator);
+
+  /** Returns the number of bytes allocated for each node in a tree. */
+  static constexpr size_t node_size() {
+    return Pool::block_size();
+  }
+
   const LlrbNode& min() const {
     const LlrbNode* node = this;
     while (!node->left().empty()) {
@@ -138,49 +211,94 @@ class LlrbNode : public SortedMapBase {
           right_{std::move(right)} {
     }
 
+    // Copies start out with a single reference, held by the LlrbNode that
+    // adopts them.
+    Rep(const Rep& other)
+        : entry_{other.entry_},
+          color_{other.color_},
+          size_{other.size_},
+          left_{other.left_},
+          right_{other.right_} {
+    }
+
+    Rep(Rep&& other)
+        : entry_{std::move(other.entry_)},
+          color_{other.color_},
+          size_{other.size_},
+          left_{std::move(other.left_)},
+          right_{std::move(other.right_)} {
+    }
+
+    // Creates the empty Rep, whose children are itself so that you can
+    // traverse infinitely down left and right links.
+    struct EmptyTag {};
+    explicit Rep(EmptyTag)
+        : color_{Color::Black}, size_{0}, left_{this}, right_{this} {
+    }
+
     value_type entry_;
 
     // Store the color in the high bit of the size to save memory.
     size_type color_ : 1;
     size_type size_ : 31;
 
+    // The number of LlrbNodes referring to this Rep. Trees may be shared
+    // between threads, so this must be atomic.
+    std::atomic<uint32_t> refs_{1};
+
     LlrbNode left_;
     LlrbNode right_;
   };
 
-  explicit LlrbNode(Rep rep) : rep_{std::make_shared<Rep>(std::move(rep))} {
-  }
+  using Pool = NodePool<Rep>;
 
-  explicit LlrbNode(const std::shared_ptr<Rep>& rep) : rep_{rep} {
+  explicit LlrbNode(Rep&& rep) : rep_{Pool::New(std::move(rep))} {
   }
 
-  explicit LlrbNode(std::shared_ptr<Rep>&& rep) : rep_{std::move(rep)} {
+  /** Adopts the given Rep without adding a reference to it. */
+  explicit LlrbNode(Rep* rep) : rep_{rep} {
   }
 
   /**
    * Returns a shared Empty node, to cut down on allocations in the base case.
+   * The empty Rep is never freed, and the size of zero that identifies it
+   * exempts it from reference counting.
    */
-  static const std::shared_ptr<Rep>& EmptyRep() {
-    static const std::shared_ptr<Rep> empty_rep = [] {
-      auto empty = std::make_shared<Rep>(Rep{std::pair<K, V>{}, Color::Black,
-                                             /* size= */ 0u, LlrbNode{nullptr},
-                                             LlrbNode{nullptr}});
-
-      // Set up the empty Rep such that you can traverse infinitely down left
-      // and right links.
-      empty->left_.rep_ = empty;
-      empty->right_.rep_ = empty;
-      return empty;
-    }();
+  static Rep* EmptyRep() {
+    static Rep* empty_rep = new Rep(typename Rep::EmptyTag{});
     return empty_rep;
   }
 
+  static void Retain(Rep* rep) {
+    if (rep->size_ != 0) {
+      rep->refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  static void Release(Rep* rep) {
+    if (rep->size_ == 0) return;
+
+    // If this is the only reference, no other thread can be adding one, so
+    // the atomic decrement can be skipped.
+    if (rep->refs_.load(std::memory_order_acquire) == 1 ||
+        rep->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      Pool::Delete(rep);
+    }
+  }
+
+  /** Replaces this node's Rep with one it already holds a reference to. */
+  void Reset(Rep* rep) {
+    Rep* old = rep_;
+    rep_ = rep;
+    Release(old);
+  }
+
   /**
    * Creates a new copy of this node, duplicating the Rep but without
    * duplicating the left_ and right_ children.
    */
   LlrbNode Clone() const {
-    return LlrbNode{*rep_};
+    return LlrbNode{Pool::New(*rep_)};
   }
 
   void set_size(size_type size) {
@@ -212,6 +330,12 @@ class LlrbNode : public SortedMapBase {
     rep_->right_ = std::move(right);
   }
 
+  template <typename Iter>
+  static LlrbNode BuildSorted(Iter* iter,
+                              size_type size,
+                              size_type black_height);
+  static size_type MaxSize(size_type black_height);
+
   template <typename Comparator>
   LlrbNode InnerInsert(const K& key,
                        const V& value,
@@ -220,6 +344,29 @@ class LlrbNode : public SortedMapBase {
   template <typename Comparator>
   LlrbNode InnerErase(const K& key, const Comparator& comparator) const;
 
+  template <typename Comparator>
+  void InnerInsertInPlace(const K& key,
+                          const V& value,
+                          const Comparator& comparator);
+
+  template <typename Comparator>
+  void InnerEraseInPlace(const K& key, const Comparator& comparator);
+
+  /**
+   * Ensures this node's Rep can be modified without affecting any other tree,
+   * copying it if anything else refers to it.
+   *
+   * A Rep referenced only once is referenced only by this node, and if this
+   * node is itself exclusively owned then nothing else can observe the change.
+   * Copying a Rep adds a reference to each of its children, so once a node on
+   * a path has been copied, all the nodes below it are copied too.
+   */
+  void EnsureUnique() {
+    if (empty() || rep_->refs_.load(std::memory_order_acquire) != 1) {
+      *this = Clone();
+    }
+  }
+
   void FixUp();
   void FixRootColor();
 
@@ -235,9 +382,84 @@ class LlrbNode : public SortedMapBase {
     return rep_->color_ == Color::Red ? Color::Black : Color::Red;
   }
 
-  std::shared_ptr<Rep> rep_;
+  Rep* rep_;
 };
 
+template <typename K, typename V>
+template <typename Iter>
+LlrbNode<K, V> LlrbNode<K, V>::FromSortedRange(Iter begin, size_type size) {
+  // The tallest valid black height for this many entries: a perfectly
+  // balanced tree of black nodes has 2^h - 1 entries.
+  size_type black_height = 0;
+  while (size >= (size_type{2} << black_height) - 1) {
+    black_height++;
+  }
+  return BuildSorted(&begin, size, black_height);
+}
+
+/**
+ * Builds a tree of the given black height from the next `size` entries of
+ * `*iter`, in order.
+ *
+ * This treats the tree as the 2-3 tree it encodes: every node is black, and
+ * any node that holds two entries (a 3-node) is represented by a black node
+ * with a red left child. A 2-3 tree of height h holds between 2^h - 1 and
+ * 3^h - 1 entries, so each level chooses a 2-node if the remaining entries fit
+ * into two subtrees of height h - 1, or a 3-node otherwise, and then splits the
+ * remaining entries evenly between the subtrees.
+ */
+template <typename K, typename V>
+template <typename Iter>
+LlrbNode<K, V> LlrbNode<K, V>::BuildSorted(Iter* iter,
+                                           size_type size,
+                                           size_type black_height) {
+  if (black_height == 0) {
+    HARD_ASSERT(size == 0, "Too many entries for tree of this height");
+    return LlrbNode{};
+  }
+
+  size_type child_height = black_height - 1;
+  if (uint64_t{size} - 1 <= uint64_t{MaxSize(child_height)} * 2) {
+    size_type remaining = size - 1;
+    LlrbNode left = BuildSorted(iter, remaining - remaining / 2, child_height);
+    value_type entry = **iter;
+    ++*iter;
+    LlrbNode right = BuildSorted(iter, remaining / 2, child_height);
+    return LlrbNode{
+        Rep{std::move(entry), Color::Black, std::move(left), std::move(right)}};
+  }
+
+  size_type remaining = size - 2;
+  size_type third = remaining / 3;
+  size_type extra = remaining % 3;
+  LlrbNode left_left =
+      BuildSorted(iter, third + (extra > 0 ? 1 : 0), child_height);
+  value_type left_entry = **iter;
+  ++*iter;
+  LlrbNode left_right =
+      BuildSorted(iter, third + (extra > 1 ? 1 : 0), child_height);
+  value_type entry = **iter;
+  ++*iter;
+  LlrbNode right = BuildSorted(iter, third, child_height);
+
+  LlrbNode left{Rep{std::move(left_entry), Color::Red, std::move(left_left),
+                    std::move(left_right)}};
+  return LlrbNode{
+      Rep{std::move(entry), Color::Black, std::move(left), std::move(right)}};
+}
+
+/** Returns the largest number of entries a tree of the given height holds. */
+template <typename K, typename V>
+typename LlrbNode<K, V>::size_type LlrbNode<K, V>::MaxSize(
+    size_type black_height) {
+  // 3^h - 1, saturating rather than overflowing.
+  uint64_t result = 1;
+  for (size_type i = 0; i < black_height && result <= npos; i++) {
+    result *= 3;
+  }
+  return result - 1 >= npos ? npos : static_cast<size_type>(result - 1);
+}
+
 template <typename K, typename V>
 template <typename Comparator>
 LlrbNode<K, V> LlrbNode<K, V>::insert(const K& key,
@@ -340,6 +562,97 @@ LlrbNode<K, V> LlrbNode<K, V>::InnerErase(const K& key,
   return n;
 }
 
+template <typename K, typename V>
+template <typename Comparator>
+void LlrbNode<K, V>::InsertInPlace(const K& key,
+                                   const V& value,
+                                   const Comparator& comparator) {
+  InnerInsertInPlace(key, value, comparator);
+  FixRootColor();
+}
+
+template <typename K, typename V>
+template <typename Comparator>
+void LlrbNode<K, V>::InnerInsertInPlace(const K& key,
+                                        const V& value,
+                                        const Comparator& comparator) {
+  if (empty()) {
+    *this = LlrbNode{Rep{{key, value}, Color::Red, LlrbNode{}, LlrbNode{}}};
+    return;
+  }
+
+  EnsureUnique();
+
+  if (comparator(key, this->key())) {
+    rep_->left_.InnerInsertInPlace(key, value, comparator);
+    FixUp();
+
+  } else if (comparator(this->key(), key)) {
+    rep_->right_.InnerInsertInPlace(key, value, comparator);
+    FixUp();
+
+  } else {
+    // keys are equal so update the value.
+    set_value(value);
+  }
+}
+
+template <typename K, typename V>
+template <typename Comparator>
+void LlrbNode<K, V>::EraseInPlace(const K& key, const Comparator& comparator) {
+  InnerEraseInPlace(key, comparator);
+  FixRootColor();
+}
+
+template <typename K, typename V>
+template <typename Comparator>
+void LlrbNode<K, V>::InnerEraseInPlace(const K& key,
+                                       const Comparator& comparator) {
+  if (empty()) {
+    return;
+  }
+
+  // This mirrors InnerErase, with this node standing in for its clone.
+  EnsureUnique();
+
+  bool descending = comparator(key, this->key());
+  if (descending) {
+    if (!left().empty() && !left().red() && !left().left().red()) {
+      MoveRedLeft();
+    }
+    rep_->left_.InnerEraseInPlace(key, comparator);
+
+  } else {
+    if (left().red()) {
+      RotateRight();
+    }
+
+    if (!right().empty() && !right().red() && !right().left().red()) {
+      MoveRedRight();
+    }
+
+    if (util::Compare(key, this->key(), comparator) ==
+        util::ComparisonResult::Same) {
+      if (right().empty()) {
+        *this = LlrbNode{};
+        return;
+
+      } else {
+        // Move the minimum node from the right subtree in place of this node.
+        // Holding `smallest` keeps that node from being modified in place.
+        LlrbNode smallest = right().min();
+        rep_->right_.EnsureUnique();
+        rep_->right_.RemoveMin();
+
+        set_entry(smallest.entry());
+      }
+    } else {
+      rep_->right_.InnerEraseInPlace(key, comparator);
+    }
+  }
+  FixUp();
+}
+
 template <typename K, typename V>
 void LlrbNode<K, V>::FixUp() {
   set_size(left().size() + 1 + right().size());
@@ -137,6 +137,37 @@ class LlrbNodeIterator {
     return LlrbNodeIterator{std::move(stack)};
   }
 
+  /**
+   * Constructs an iterator pointing to the node at the given index in the
+   * iteration sequence, found using the sizes of the subtrees along the way.
+   * If the index is not less than the size of the tree, returns an equivalent
+   * to `End()`.
+   */
+  static LlrbNodeIterator AtIndex(const node_type* root,
+                                  typename node_type::size_type index) {
+    stack_type stack;
+
+    const node_type* node = root;
+    while (!node->empty()) {
+      auto left_size = node->left().size();
+      if (index == left_size) {
+        stack.push(node);
+        return LlrbNodeIterator{std::move(stack)};
+
+      } else if (index < left_size) {
+        stack.push(node);
+        node = &node->left();
+      } else {
+        // As in LowerBound, nodes to the left of the target aren't revisited.
+        index -= left_size + 1;
+        node = &node->right();
+      }
+    }
+
+    // Only reached if the index is past the end.
+    return End();
+  }
+
   /**
    * Returns true if this iterator points at the end of the iteration sequence.
    */
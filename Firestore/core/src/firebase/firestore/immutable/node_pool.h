@@ -0,0 +1,161 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_NODE_POOL_H_
+#define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_NODE_POOL_H_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "absl/base/config.h"
+
+namespace firebase {
+namespace firestore {
+namespace immutable {
+namespace impl {
+
+/**
+ * Allocates objects of type T from a per-thread free list.
+ *
+ * Tree rewrites free and allocate nodes of a single size in quick succession,
+ * so blocks released by Delete are kept for reuse by later calls to New on the
+ * same thread rather than being returned to the system allocator. Each thread
+ * keeps at most kMaxFreeBlocks; anything beyond that is freed normally, as is
+ * everything when the platform lacks thread_local.
+ *
+ * Only LlrbNode uses this. BTreeNode and ArraySortedMap allocate with
+ * std::make_shared.
+ */
+template <typename T>
+class NodePool {
+ public:
+  static constexpr size_t kMaxFreeBlocks = 256;
+
+  /** Constructs a T from the given arguments in a block from the pool. */
+  template <typename... Args>
+  static T* New(Args&&... args) {
+    void* block = Allocate();
+    try {
+      return new (block) T(std::forward<Args>(args)...);
+    } catch (...) {
+      Deallocate(block);
+      throw;
+    }
+  }
+
+  /** Destroys an object created by New and returns its block to the pool. */
+  static void Delete(T* object) {
+    object->~T();
+    Deallocate(object);
+  }
+
+  /** Returns the number of bytes allocated for each T. */
+  static constexpr size_t block_size() {
+    return sizeof(Block);
+  }
+
+ private:
+  union Block {
+    Block* next;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+#if ABSL_HAVE_THREAD_LOCAL
+  /**
+   * The blocks kept by a thread. This is trivially destructible, so it
+   * remains usable throughout thread shutdown, even by the destructors of
+   * other thread_locals that release nodes after FreeListCleanup has run.
+   */
+  struct FreeList {
+    Block* head;
+    size_t count;
+    bool cleanup_registered;
+  };
+
+  static_assert(std::is_trivially_destructible<FreeList>::value,
+                "FreeList must outlive every other thread_local");
+
+  /** Frees a thread's blocks when the thread exits. */
+  struct FreeListCleanup {
+    ~FreeListCleanup() {
+      FreeList& free_list = GetFreeList();
+      while (free_list.head) {
+        Block* next = free_list.head->next;
+        ::operator delete(free_list.head);
+        free_list.head = next;
+      }
+      // Nodes released later in thread shutdown bypass the list.
+      free_list.count = kMaxFreeBlocks;
+    }
+  };
+
+  static FreeList& GetFreeList() {
+    static thread_local FreeList free_list = {nullptr, 0, false};
+    return free_list;
+  }
+
+  static void* Allocate() {
+    FreeList& free_list = GetFreeList();
+    Block* block = free_list.head;
+    if (block) {
+      free_list.head = block->next;
+      free_list.count--;
+      return block;
+    }
+    return ::operator new(sizeof(Block));
+  }
+
+  static void Deallocate(void* pointer) {
+    FreeList& free_list = GetFreeList();
+    if (free_list.count < kMaxFreeBlocks) {
+      if (!free_list.cleanup_registered) {
+        // Constructing the cleanup registers its destructor to run at thread
+        // exit, before the list itself is released.
+        static thread_local FreeListCleanup cleanup;
+        (void)cleanup;
+        free_list.cleanup_registered = true;
+      }
+      auto block = static_cast<Block*>(pointer);
+      block->next = free_list.head;
+      free_list.head = block;
+      free_list.count++;
+      return;
+    }
+    ::operator delete(pointer);
+  }
+
+#else   // !ABSL_HAVE_THREAD_LOCAL
+  static void* Allocate() {
+    return ::operator new(sizeof(Block));
+  }
+
+  static void Deallocate(void* pointer) {
+    ::operator delete(pointer);
+  }
+#endif  // ABSL_HAVE_THREAD_LOCAL
+};
+
+template <typename T>
+constexpr size_t NodePool<T>::kMaxFreeBlocks;
+
+}  // namespace impl
+}  // namespace immutable
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_NODE_POOL_H_
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_PUBLISHED_MAP_H_
+#define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_PUBLISHED_MAP_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
+
+namespace firebase {
+namespace firestore {
+namespace immutable {
+
+/**
+ * Holds the latest version of an immutable map, such as a SortedMap, that one
+ * thread keeps replacing and any number of other threads read.
+ *
+ * Iterating over a SortedMap doesn't touch the reference counts of its nodes,
+ * but copying one (even just to read it) does touch the count of its root,
+ * which every reader of the same version contends on. A Reader instead pins
+ * the current version without copying it, so readers share nothing but the
+ * counter of the current epoch.
+ *
+ * Replaced versions are reclaimed in the style of RCU: each Reader registers
+ * in the counter of the epoch it started in, and Publish frees a replaced
+ * version only once every epoch in which a Reader might have seen it has
+ * drained. Publish never waits for readers--a long-lived Reader just delays
+ * the reclamation of replaced versions--and taking a Reader only retries if
+ * it races with a Publish that advances the epoch, so reads are lock-free.
+ *
+ * Usage:
+ *
+ *     // On the worker thread:
+ *     published.Publish(std::move(new_results));
+ *
+ *     // On any thread:
+ *     {
+ *       auto reader = published.Read();
+ *       for (const auto& entry : *reader) {
+ *         ...
+ *       }
+ *     }
+ *
+ * A Reader must not outlive its PublishedMap. To keep a version beyond the
+ * scope of a Reader, take a Snapshot(), which copies it.
+ */
+template <typename M>
+class PublishedMap {
+ public:
+  class Reader;
+
+  explicit PublishedMap(M map = M{})
+      : current_{new Version{std::move(map), 0}} {
+  }
+
+  PublishedMap(const PublishedMap&) = delete;
+  PublishedMap& operator=(const PublishedMap&) = delete;
+
+  ~PublishedMap() {
+    HARD_ASSERT(readers_[0] == 0 && readers_[1] == 0,
+                "PublishedMap destroyed while it's being read");
+    delete current_.load();
+    for (Version* version : retired_) {
+      delete version;
+    }
+  }
+
+  /**
+   * Replaces the current version of the map. Readers that have already
+   * started keep seeing the version they started with.
+   */
+  void Publish(M map) {
+    std::lock_guard<std::mutex> lock{publish_mutex_};
+
+    uint64_t epoch = epoch_.load();
+    auto version = new Version{std::move(map), 0};
+    retired_.push_back(current_.exchange(version));
+    retired_.back()->retired_epoch = epoch;
+
+    // Each advance frees the versions retired two epochs back, so advancing
+    // twice frees the version just replaced if it has no readers.
+    TryAdvance();
+    TryAdvance();
+  }
+
+  /** Starts reading the current version of the map. */
+  Reader Read() const {
+    return Reader{this};
+  }
+
+  /** Returns a copy of the current version of the map. */
+  M Snapshot() const {
+    return *Read();
+  }
+
+  /**
+   * Returns the number of replaced versions that haven't been reclaimed yet,
+   * for testing.
+   */
+  size_t retired_count() const {
+    std::lock_guard<std::mutex> lock{publish_mutex_};
+    return retired_.size();
+  }
+
+ private:
+  struct Version {
+    M map;
+    uint64_t retired_epoch;
+  };
+
+  /**
+   * Advances to the next epoch if no Reader remains from the one before the
+   * current epoch, whose counter the next epoch reuses. Frees every version
+   * retired before the current epoch, since only Readers from those epochs
+   * could have seen them.
+   */
+  void TryAdvance() {
+    uint64_t epoch = epoch_.load();
+    if (readers_[(epoch + 1) % 2].load() != 0) {
+      return;
+    }
+
+    auto kept = retired_.begin();
+    for (Version* version : retired_) {
+      if (version->retired_epoch < epoch) {
+        delete version;
+      } else {
+        *kept++ = version;
+      }
+    }
+    retired_.erase(kept, retired_.end());
+
+    epoch_.store(epoch + 1);
+  }
+
+  mutable std::atomic<uint64_t> epoch_{0};
+  mutable std::atomic<int64_t> readers_[2] = {{0}, {0}};
+  std::atomic<Version*> current_;
+
+  mutable std::mutex publish_mutex_;
+  std::vector<Version*> retired_;
+};
+
+/**
+ * A pinned version of a PublishedMap's map, which stays valid until the Reader
+ * is destroyed.
+ */
+template <typename M>
+class PublishedMap<M>::Reader {
+ public:
+  Reader(Reader&& other) noexcept
+      : counter_{other.counter_}, version_{other.version_} {
+    other.counter_ = nullptr;
+  }
+
+  Reader(const Reader&) = delete;
+  Reader& operator=(const Reader&) = delete;
+  Reader& operator=(Reader&&) = delete;
+
+  ~Reader() {
+    if (counter_) {
+      counter_->fetch_sub(1);
+    }
+  }
+
+  const M& operator*() const {
+    return version_->map;
+  }
+
+  const M* operator->() const {
+    return &version_->map;
+  }
+
+ private:
+  friend class PublishedMap;
+
+  explicit Reader(const PublishedMap* published) {
+    for (;;) {
+      uint64_t epoch = published->epoch_.load();
+      counter_ = &published->readers_[epoch % 2];
+      counter_->fetch_add(1);
+      if (published->epoch_.load() == epoch) {
+        break;
+      }
+      // The epoch advanced before this registered, so the counter may already
+      // have been checked. Register in the new epoch instead.
+      counter_->fetch_sub(1);
+    }
+    version_ = published->current_.load();
+  }
+
+  std::atomic<int64_t>* counter_ = nullptr;
+  const Version* version_ = nullptr;
+};
+
+}  // namespace immutable
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_PUBLISHED_MAP_H_
@@ -17,23 +17,35 @@
 #ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_SORTED_MAP_H_
 #define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_IMMUTABLE_SORTED_MAP_H_
 
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/firebase/firestore/immutable/array_sorted_map.h"
+#include "Firestore/core/src/firebase/firestore/immutable/btree_sorted_map.h"
 #include "Firestore/core/src/firebase/firestore/immutable/keys_view.h"
 #include "Firestore/core/src/firebase/firestore/immutable/sorted_map_base.h"
 #include "Firestore/core/src/firebase/firestore/immutable/sorted_map_iterator.h"
 #include "Firestore/core/src/firebase/firestore/immutable/tree_sorted_map.h"
 #include "Firestore/core/src/firebase/firestore/util/comparison.h"
+#include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
 #include "absl/base/attributes.h"
 
 namespace firebase {
 namespace firestore {
 namespace immutable {
 
+template <typename K, typename V, typename C, typename M>
+class SortedSet;
+
 /**
  * SortedMap is a value type containing a map. It is immutable, but
  * has methods to efficiently create new maps that are mutations of it.
+ *
+ * Internally, maps of up to kFixedSize entries are a sorted array, maps of up
+ * to kMaxTreeSize entries are a binary tree, and larger maps are a B-tree.
  */
 template <typename K, typename V, typename C = util::Comparator<K>>
 class SortedMap : public impl::SortedMapBase {
@@ -42,18 +54,29 @@ class SortedMap : public impl::SortedMapBase {
   using value_type = std::pair<K, V>;
   using array_type = impl::ArraySortedMap<K, V, C>;
   using tree_type = impl::TreeSortedMap<K, V, C>;
+  using btree_type = impl::BTreeSortedMap<K, V, C>;
 
   using const_iterator = impl::SortedMapIterator<
       value_type,
-      typename impl::FixedArray<value_type>::const_iterator,
-      typename impl::LlrbNode<K, V>::const_iterator>;
+      typename array_type::const_iterator,
+      typename impl::LlrbNode<K, V>::const_iterator,
+      typename impl::BTreeNode<K, V>::const_iterator>;
 
   using const_key_iterator = util::iterator_first<const_iterator>;
 
+  class Transient;
+
   /**
-   * Creates an empty SortedMap.
+   * Creates an empty SortedMap. Not explicit, so that `= {}` can be used to
+   * default an empty map, as with std::map.
    */
-  explicit SortedMap(const C& comparator = {})
+  SortedMap() : SortedMap{array_type{}} {
+  }
+
+  /**
+   * Creates an empty SortedMap that orders its keys with the given comparator.
+   */
+  explicit SortedMap(const C& comparator)
       : SortedMap{array_type{comparator}} {
   }
 
@@ -66,7 +89,42 @@ class SortedMap : public impl::SortedMapBase {
       tag_ = Tag::Array;
       new (&array_) array_type{entries, comparator};
     } else {
-      new (&tree_) tree_type{tree_type::Create(entries, comparator)};
+      tree_type tree = tree_type::Create(entries, comparator);
+      if (tree.size() <= kMaxTreeSize) {
+        tag_ = Tag::Tree;
+        new (&tree_) tree_type{std::move(tree)};
+      } else {
+        tag_ = Tag::BTree;
+        new (&btree_) btree_type{ToBTree(tree)};
+      }
+    }
+  }
+
+  /**
+   * Creates a SortedMap from the entries in the given range, which must be in
+   * ascending order by key with no duplicate keys, as produced by scanning an
+   * ordered index.
+   *
+   * This takes linear time and allocates one tree node per entry, where
+   * inserting the entries one at a time allocates O(n log n) nodes.
+   */
+  template <typename Iter>
+  static SortedMap FromSortedRange(Iter begin,
+                                   Iter end,
+                                   const C& comparator = {}) {
+    size_type size = 0;
+    for (Iter iter = begin, prev = begin; iter != end; prev = iter, ++iter) {
+      HARD_ASSERT(size == 0 || comparator((*prev).first, (*iter).first),
+                  "FromSortedRange requires ascending, unique keys");
+      size++;
+    }
+
+    if (size <= kFixedSize) {
+      return SortedMap{array_type::FromSortedRange(begin, end, comparator)};
+    } else if (size <= kMaxTreeSize) {
+      return SortedMap{tree_type::FromSortedRange(begin, size, comparator)};
+    } else {
+      return SortedMap{btree_type::FromSortedRange(begin, size, comparator)};
     }
   }
 
@@ -78,6 +136,9 @@ class SortedMap : public impl::SortedMapBase {
       case Tag::Tree:
         new (&tree_) tree_type{other.tree_};
         break;
+      case Tag::BTree:
+        new (&btree_) btree_type{other.btree_};
+        break;
     }
   }
 
@@ -89,6 +150,9 @@ class SortedMap : public impl::SortedMapBase {
       case Tag::Tree:
         new (&tree_) tree_type{std::move(other.tree_)};
         break;
+      case Tag::BTree:
+        new (&btree_) btree_type{std::move(other.btree_)};
+        break;
     }
   }
 
@@ -100,6 +164,9 @@ class SortedMap : public impl::SortedMapBase {
       case Tag::Tree:
         tree_.~TreeSortedMap();
         break;
+      case Tag::BTree:
+        btree_.~BTreeSortedMap();
+        break;
     }
   }
 
@@ -112,6 +179,9 @@ class SortedMap : public impl::SortedMapBase {
         case Tag::Tree:
           tree_ = other.tree_;
           break;
+        case Tag::BTree:
+          btree_ = other.btree_;
+          break;
       }
     } else {
       this->~SortedMap();
@@ -129,6 +199,9 @@ class SortedMap : public impl::SortedMapBase {
         case Tag::Tree:
           tree_ = std::move(other.tree_);
           break;
+        case Tag::BTree:
+          btree_ = std::move(other.btree_);
+          break;
       }
     } else {
       this->~SortedMap();
@@ -144,6 +217,8 @@ class SortedMap : public impl::SortedMapBase {
         return array_.empty();
       case Tag::Tree:
         return tree_.empty();
+      case Tag::BTree:
+        return btree_.empty();
     }
     UNREACHABLE();
   }
@@ -155,6 +230,8 @@ class SortedMap : public impl::SortedMapBase {
         return array_.size();
       case Tag::Tree:
         return tree_.size();
+      case Tag::BTree:
+        return btree_.size();
     }
     UNREACHABLE();
   }
@@ -177,13 +254,21 @@ class SortedMap : public impl::SortedMapBase {
           // exactly where this cut-off happens and just unconditionally
           // converting if the next insertion could overflow keeps things
           // simpler.
-          tree_type tree = tree_type::Create(array_, comparator());
+          tree_type tree = tree_type::FromSortedRange(
+              array_.begin(), array_.size(), comparator());
           return SortedMap{tree.insert(key, value)};
         } else {
           return SortedMap{array_.insert(key, value)};
         }
-      case Tag::Tree:
-        return SortedMap{tree_.insert(key, value)};
+      case Tag::Tree: {
+        tree_type result = tree_.insert(key, value);
+        if (result.size() > kMaxTreeSize) {
+          return SortedMap{ToBTree(result)};
+        }
+        return SortedMap{std::move(result)};
+      }
+      case Tag::BTree:
+        return SortedMap{btree_.insert(key, value)};
     }
     UNREACHABLE();
   }
@@ -198,23 +283,158 @@ class SortedMap : public impl::SortedMapBase {
     switch (tag_) {
       case Tag::Array:
         return SortedMap{array_.erase(key)};
-      case Tag::Tree:
+      case Tag::Tree: {
         tree_type result = tree_.erase(key);
         if (result.empty()) {
           // Flip back to the array representation for empty arrays.
-          return SortedMap{};
+          return SortedMap{comparator()};
         }
         return SortedMap{std::move(result)};
+      }
+      case Tag::BTree: {
+        btree_type result = btree_.erase(key);
+        if (result.empty()) {
+          return SortedMap{comparator()};
+        }
+        return SortedMap{std::move(result)};
+      }
     }
     UNREACHABLE();
   }
 
+  /**
+   * Creates a new map identical to this one, but with all of the given
+   * key-value pairs added or updated. The entries need not be in order; if a
+   * key appears more than once, the last value for that key wins.
+   *
+   * Large batches are merged with the existing entries and the result built
+   * in one pass, rather than rebalancing the tree after every insertion.
+   */
+  template <typename Range>
+  ABSL_MUST_USE_RESULT SortedMap insert_all(const Range& entries) const {
+    const C& comparator = this->comparator();
+    auto key_less = [&comparator](const value_type& lhs,
+                                  const value_type& rhs) {
+      return comparator(lhs.first, rhs.first);
+    };
+
+    std::vector<value_type> sorted(std::begin(entries), std::end(entries));
+    std::stable_sort(sorted.begin(), sorted.end(), key_less);
+    // Keep only the last of each run of equal keys.
+    auto last = std::unique(
+        sorted.rbegin(), sorted.rend(),
+        [&](const value_type& lhs, const value_type& rhs) {
+          return !key_less(lhs, rhs) && !key_less(rhs, lhs);
+        });
+    sorted.erase(sorted.begin(), last.base());
+
+    if (PreferIndividualUpdates(sorted.size())) {
+      SortedMap result = *this;
+      for (const value_type& entry : sorted) {
+        result = result.insert(entry.first, entry.second);
+      }
+      return result;
+    }
+
+    std::vector<value_type> merged;
+    merged.reserve(size() + sorted.size());
+    const_iterator existing = begin();
+    const_iterator existing_end = end();
+    for (value_type& entry : sorted) {
+      while (existing != existing_end && key_less(*existing, entry)) {
+        merged.push_back(*existing);
+        ++existing;
+      }
+      if (existing != existing_end && !key_less(entry, *existing)) {
+        // Replaced by the new entry.
+        ++existing;
+      }
+      merged.push_back(std::move(entry));
+    }
+    merged.insert(merged.end(), existing, existing_end);
+    return FromSortedRange(merged.begin(), merged.end(), comparator);
+  }
+
+  /**
+   * Creates a new map identical to this one, but with all of the given keys
+   * removed from it. The keys need not be in order.
+   *
+   * Large batches are applied by building the result in one pass, rather than
+   * rebalancing the tree after every removal.
+   */
+  template <typename Range>
+  ABSL_MUST_USE_RESULT SortedMap erase_all(const Range& keys) const {
+    const C& comparator = this->comparator();
+    std::vector<K> sorted(std::begin(keys), std::end(keys));
+    std::sort(sorted.begin(), sorted.end(), comparator);
+
+    if (PreferIndividualUpdates(sorted.size())) {
+      SortedMap result = *this;
+      for (const K& key : sorted) {
+        result = result.erase(key);
+      }
+      return result;
+    }
+
+    std::vector<value_type> kept;
+    kept.reserve(size());
+    auto key = sorted.begin();
+    for (const value_type& entry : *this) {
+      while (key != sorted.end() && comparator(*key, entry.first)) {
+        ++key;
+      }
+      if (key == sorted.end() || comparator(entry.first, *key)) {
+        kept.push_back(entry);
+      }
+    }
+    if (kept.size() == size()) {
+      return *this;
+    }
+    return FromSortedRange(kept.begin(), kept.end(), comparator);
+  }
+
+  /**
+   * Creates a new map identical to this one, but without the entries whose
+   * keys are greater than or equal to `start_key` and less than `end_key`.
+   *
+   * B-trees split and rejoin around the range in O(log n) time, no matter how
+   * many entries it covers; smaller maps are rebuilt from what remains.
+   */
+  ABSL_MUST_USE_RESULT SortedMap erase_range(const K& start_key,
+                                             const K& end_key) const {
+    if (tag_ == Tag::BTree) {
+      btree_type result = btree_.erase_range(start_key, end_key);
+      if (result.empty()) {
+        return SortedMap{comparator()};
+      }
+      return SortedMap{std::move(result)};
+    }
+
+    auto erased = range(start_key, end_key);
+    if (erased.begin() == erased.end()) {
+      return *this;
+    }
+    std::vector<value_type> kept{begin(), erased.begin()};
+    kept.insert(kept.end(), erased.end(), end());
+    return FromSortedRange(kept.begin(), kept.end(), comparator());
+  }
+
+  /**
+   * Returns a Transient that starts out with the contents of this map. See
+   * SortedMap::Transient.
+   */
+  Transient transient() const {
+    return Transient{*this};
+  }
+
   bool contains(const K& key) const {
     switch (tag_) {
       case Tag::Array:
         return array_.contains(key);
       case Tag::Tree:
         return tree_.contains(key);
+      case Tag::BTree:
+        return btree_.contains(key);
     }
     UNREACHABLE();
   }
@@ -232,12 +452,16 @@ class SortedMap : public impl::SortedMapBase {
         return const_iterator(array_.find(key));
       case Tag::Tree:
         return const_iterator{tree_.find(key)};
+      case Tag::BTree:
+        return const_iterator{btree_.find(key)};
     }
     UNREACHABLE();
   }
 
   /**
-   * Finds the index of the given key in the map.
+   * Finds the index of the given key in the map. Like rank(), at(), and
+   * slice(), this uses the entry counts kept in each tree node, so it takes
+   * O(log n) time.
    *
    * @param key The key to look up.
    * @return The index of the entry containing the key, or npos if not found.
@@ -248,10 +472,70 @@ class SortedMap : public impl::SortedMapBase {
         return array_.find_index(key);
       case Tag::Tree:
         return tree_.find_index(key);
+      case Tag::BTree:
+        return btree_.find_index(key);
+    }
+    UNREACHABLE();
+  }
+
+  /**
+   * Returns the number of entries in the map whose keys are less than the
+   * given key, which is the index at which the key is or would be found.
+   */
+  size_type rank(const K& key) const {
+    switch (tag_) {
+      case Tag::Array:
+        return array_.rank(key);
+      case Tag::Tree:
+        return tree_.rank(key);
+      case Tag::BTree:
+        return btree_.rank(key);
+    }
+    UNREACHABLE();
+  }
+
+  /**
+   * Returns the entry at the given index in key order, which must be less
+   * than size().
+   */
+  const value_type& at(size_type index) const {
+    HARD_ASSERT(index < size(), "index %s out of range for map of size %s",
+                index, size());
+    if (tag_ == Tag::Tree) {
+      return tree_.at(index);
+    }
+    return *iterator_at(index);
+  }
+
+  /**
+   * Returns an iterator pointing to the entry at the given index in key
+   * order, or end() if the index is not less than size().
+   */
+  const_iterator iterator_at(size_type index) const {
+    switch (tag_) {
+      case Tag::Array:
+        return const_iterator(array_.iterator_at(index));
+      case Tag::Tree:
+        return const_iterator{tree_.iterator_at(index)};
+      case Tag::BTree:
+        return const_iterator{btree_.iterator_at(index)};
     }
     UNREACHABLE();
   }
 
+  /**
+   * Returns a view of the entries in this SortedMap whose indexes in key order
+   * are greater than or equal to `begin_index` and less than `end_index`. For
+   * example, `slice(0, limit)` is the first `limit` entries.
+   */
+  const util::range<const_iterator> slice(size_type begin_index,
+                                          size_type end_index) const {
+    if (begin_index >= end_index || begin_index >= size()) {
+      return util::make_range(end(), end());
+    }
+    return util::make_range(iterator_at(begin_index), iterator_at(end_index));
+  }
+
   /**
    * Finds the first entry in the map containing a key greater than or equal
    * to the given key.
@@ -267,6 +551,8 @@ class SortedMap : public impl::SortedMapBase {
         return const_iterator(array_.lower_bound(key));
       case Tag::Tree:
         return const_iterator{tree_.lower_bound(key)};
+      case Tag::BTree:
+        return const_iterator{btree_.lower_bound(key)};
     }
     UNREACHABLE();
   }
@@ -277,6 +563,8 @@ class SortedMap : public impl::SortedMapBase {
         return const_iterator(array_.min());
       case Tag::Tree:
         return const_iterator{tree_.min()};
+      case Tag::BTree:
+        return const_iterator{btree_.min()};
     }
     UNREACHABLE();
   }
@@ -287,6 +575,8 @@ class SortedMap : public impl::SortedMapBase {
         return const_iterator(array_.max());
       case Tag::Tree:
         return const_iterator{tree_.max()};
+      case Tag::BTree:
+        return const_iterator{btree_.max()};
     }
     UNREACHABLE();
   }
@@ -301,6 +591,8 @@ class SortedMap : public impl::SortedMapBase {
         return const_iterator{array_.begin()};
       case Tag::Tree:
         return const_iterator{tree_.begin()};
+      case Tag::BTree:
+        return const_iterator{btree_.begin()};
     }
     UNREACHABLE();
   }
@@ -314,6 +606,8 @@ class SortedMap : public impl::SortedMapBase {
         return const_iterator{array_.end()};
       case Tag::Tree:
         return const_iterator{tree_.end()};
+      case Tag::BTree:
+        return const_iterator{btree_.end()};
     }
     UNREACHABLE();
   }
@@ -344,7 +638,90 @@ class SortedMap : public impl::SortedMapBase {
     return impl::KeysViewIn(*this, start_key, end_key, comparator());
   }
 
+  /**
+   * Returns a view of the entries in this SortedMap whose keys are greater
+   * than or equal to the given start_key and less than the given end_key. The
+   * view iterates over the map itself, without copying any entries.
+   */
+  const util::range<const_iterator> range(const K& start_key,
+                                          const K& end_key) const {
+    return impl::ViewIn(*this, start_key, end_key, comparator());
+  }
+
+  /**
+   * Reports the differences between `old_map` and `new_map`, in key order:
+   * calls `on_removed(entry)` for each entry only in `old_map`,
+   * `on_added(entry)` for each entry only in `new_map`, and
+   * `on_changed(old_entry, new_entry)` for each key whose value differs.
+   *
+   * When both maps are large and one was derived from the other, this skips
+   * the parts of the maps they share and takes O(changes * log n) time.
+   * Otherwise it compares the maps entry by entry.
+   */
+  template <typename OnRemoved, typename OnAdded, typename OnChanged>
+  static void Diff(const SortedMap& old_map,
+                   const SortedMap& new_map,
+                   OnRemoved&& on_removed,
+                   OnAdded&& on_added,
+                   OnChanged&& on_changed) {
+    if (old_map.tag_ == Tag::BTree && new_map.tag_ == Tag::BTree) {
+      btree_type::Diff(old_map.btree_, new_map.btree_, on_removed, on_added,
+                       on_changed);
+      return;
+    }
+
+    const C& comparator = new_map.comparator();
+    auto old_iter = old_map.begin();
+    auto old_end = old_map.end();
+    auto new_iter = new_map.begin();
+    auto new_end = new_map.end();
+    while (old_iter != old_end && new_iter != new_end) {
+      if (comparator(old_iter->first, new_iter->first)) {
+        on_removed(*old_iter);
+        ++old_iter;
+      } else if (comparator(new_iter->first, old_iter->first)) {
+        on_added(*new_iter);
+        ++new_iter;
+      } else {
+        if (!(old_iter->second == new_iter->second)) {
+          on_changed(*old_iter, *new_iter);
+        }
+        ++old_iter;
+        ++new_iter;
+      }
+    }
+    for (; old_iter != old_end; ++old_iter) {
+      on_removed(*old_iter);
+    }
+    for (; new_iter != new_end; ++new_iter) {
+      on_added(*new_iter);
+    }
+  }
+
+  /**
+   * Returns true if both maps contain the same entries. Like Diff, this skips
+   * the parts of large maps that they share.
+   */
+  friend bool operator==(const SortedMap& lhs, const SortedMap& rhs) {
+    if (lhs.size() != rhs.size()) {
+      return false;
+    }
+
+    bool equal = true;
+    auto differs = [&equal](const value_type&) { equal = false; };
+    Diff(lhs, rhs, differs, differs,
+         [&equal](const value_type&, const value_type&) { equal = false; });
+    return equal;
+  }
+
+  friend bool operator!=(const SortedMap& lhs, const SortedMap& rhs) {
+    return !(lhs == rhs);
+  }
+
  private:
+  template <typename, typename, typename, typename>
+  friend class SortedSet;
+
   explicit SortedMap(array_type&& array)
       : tag_{Tag::Array}, array_{std::move(array)} {
   }
@@ -353,12 +730,47 @@ class SortedMap : public impl::SortedMapBase {
       : tag_{Tag::Tree}, tree_{std::move(tree)} {
   }
 
+  explicit SortedMap(btree_type&& btree)
+      : tag_{Tag::BTree}, btree_{std::move(btree)} {
+  }
+
+  static btree_type ToBTree(const tree_type& tree) {
+    return btree_type::FromSortedRange(tree.begin(), tree.size(),
+                                       tree.comparator());
+  }
+
+  /**
+   * Returns true if applying `count` insertions or removals one at a time is
+   * expected to be cheaper than building a new map. Each update of a tree
+   * copies one path through it (about log2(size) nodes), while building a new
+   * map allocates one node per entry.
+   */
+  bool PreferIndividualUpdates(size_t count) const {
+    if (tag_ == Tag::Array) {
+      // Each update of an array copies the whole array.
+      return false;
+    }
+
+    uint64_t depth = 1;
+    for (size_type remaining = size(); remaining > 1; remaining >>= 1) {
+      depth++;
+    }
+    if (tag_ == Tag::BTree) {
+      // Each update of a B-tree copies about log16(size) nodes, each holding
+      // up to kMaxCount entries or children.
+      depth = (depth / 4 + 1) * impl::BTreeNode<K, V>::kMaxCount;
+    }
+    return count * depth < size();
+  }
+
   const C& comparator() const {
     switch (tag_) {
       case Tag::Array:
         return array_.comparator();
       case Tag::Tree:
         return tree_.comparator();
+      case Tag::BTree:
+        return btree_.comparator();
     }
     UNREACHABLE();
   }
@@ -366,15 +778,106 @@ class SortedMap : public impl::SortedMapBase {
   enum class Tag {
     Array,
     Tree,
+    BTree,
   };
 
   Tag tag_;
   union {
     array_type array_;
     tree_type tree_;
+    btree_type btree_;
   };
 };
 
+/**
+ * A mutable view of a SortedMap, for applying many updates in a row when the
+ * intermediate versions aren't needed.
+ *
+ * Each SortedMap::insert or erase copies the path from the root to the
+ * affected node. A Transient instead modifies in place any node that no other
+ * map shares--which, after the first few updates, is most of the nodes near
+ * the root--so a loop of updates allocates far less. Maps the Transient was
+ * created from are never affected.
+ *
+ * Usage:
+ *
+ *     SortedMap<K, V>::Transient transient = map.transient();
+ *     for (...) {
+ *       transient.insert(key, value);
+ *     }
+ *     map = std::move(transient).persistent();
+ *
+ * A Transient is not thread-safe, and must not be used after persistent().
+ */
+template <typename K, typename V, typename C>
+class SortedMap<K, V, C>::Transient {
+ public:
+  explicit Transient(SortedMap map) : map_{std::move(map)} {
+  }
+
+  bool empty() const {
+    return map_.empty();
+  }
+
+  size_type size() const {
+    return map_.size();
+  }
+
+  bool contains(const K& key) const {
+    return map_.contains(key);
+  }
+
+  /** Adds or updates the value associated with the given key. */
+  void insert(const K& key, const V& value) {
+    switch (map_.tag_) {
+      case Tag::Array:
+        // Arrays are small and are copied on every update anyway.
+        map_ = map_.insert(key, value);
+        break;
+      case Tag::Tree:
+        // Trees may grow past kMaxTreeSize here; persistent() converts them.
+        map_.tree_.InsertInPlace(key, value);
+        break;
+      case Tag::BTree:
+        map_.btree_.InsertInPlace(key, value);
+        break;
+    }
+  }
+
+  /** Removes the given key, if present. */
+  void erase(const K& key) {
+    switch (map_.tag_) {
+      case Tag::Array:
+        map_ = map_.erase(key);
+        break;
+      case Tag::Tree:
+        map_.tree_.EraseInPlace(key);
+        break;
+      case Tag::BTree:
+        map_.btree_.EraseInPlace(key);
+        break;
+    }
+    if (map_.tag_ != Tag::Array && map_.empty()) {
+      // Flip back to the array representation for empty maps.
+      map_ = SortedMap{map_.comparator()};
+    }
+  }
+
+  /**
+   * Returns the resulting SortedMap. The Transient must not be used
+   * afterwards.
+   */
+  SortedMap persistent() && {
+    if (map_.tag_ == Tag::Tree && map_.size() > kMaxTreeSize) {
+      return SortedMap{ToBTree(map_.tree_)};
+    }
+    return std::move(map_);
+  }
+
+ private:
+  SortedMap map_;
+};
+
 }  // namespace immutable
 }  // namespace firestore
 }  // namespace firebase
@@ -55,6 +55,13 @@ class SortedMapBase {
   // TODO(wilhuff): actually use this for switching implementations.
   static constexpr size_type kFixedSize = 25;
 
+  /**
+   * The maximum size of a TreeSortedMap within a SortedMap. Larger maps use a
+   * BTreeSortedMap, whose wide nodes make lookups and iteration faster but
+   * make each modification copy more.
+   */
+  static constexpr size_type kMaxTreeSize = 64;
+
   /**
    * A sentinel return value that indicates not found. Functionally similar to
    * std::string::npos.
@@ -20,6 +20,7 @@
 #include <utility>
 
 #include "Firestore/core/src/firebase/firestore/immutable/array_sorted_map.h"
+#include "Firestore/core/src/firebase/firestore/immutable/btree_sorted_map.h"
 #include "Firestore/core/src/firebase/firestore/immutable/tree_sorted_map.h"
 
 namespace firebase {
@@ -27,7 +28,10 @@ namespace firestore {
 namespace immutable {
 namespace impl {
 
-template <typename V, typename ArrayIter, typename TreeIter>
+template <typename V,
+          typename ArrayIter,
+          typename TreeIter,
+          typename BTreeIter>
 class SortedMapIterator {
  public:
   using iterator_category = std::forward_iterator_tag;
@@ -49,6 +53,10 @@ class SortedMapIterator {
       : tag_{Tag::Tree}, tree_iter_{std::move(delegate)} {
   }
 
+  explicit SortedMapIterator(BTreeIter&& delegate)
+      : tag_{Tag::BTree}, btree_iter_{std::move(delegate)} {
+  }
+
   SortedMapIterator(const SortedMapIterator& other) : tag_(other.tag_) {
     switch (tag_) {
       case Tag::Array:
@@ -57,6 +65,9 @@ class SortedMapIterator {
       case Tag::Tree:
         new (&tree_iter_) TreeIter{other.tree_iter_};
         break;
+      case Tag::BTree:
+        new (&btree_iter_) BTreeIter{other.btree_iter_};
+        break;
     }
   }
 
@@ -68,6 +79,9 @@ class SortedMapIterator {
       case Tag::Tree:
         new (&tree_iter_) TreeIter{std::move(other.tree_iter_)};
         break;
+      case Tag::BTree:
+        new (&btree_iter_) BTreeIter{std::move(other.btree_iter_)};
+        break;
     }
   }
 
@@ -79,6 +93,9 @@ class SortedMapIterator {
       case Tag::Tree:
         tree_iter_.~TreeIter();
         break;
+      case Tag::BTree:
+        btree_iter_.~BTreeIter();
+        break;
     }
   }
 
@@ -91,6 +108,9 @@ class SortedMapIterator {
         case Tag::Tree:
           tree_iter_ = other.tree_iter_;
           break;
+        case Tag::BTree:
+          btree_iter_ = other.btree_iter_;
+          break;
       }
     } else {
       this->~SortedMapIterator();
@@ -108,6 +128,9 @@ class SortedMapIterator {
         case Tag::Tree:
           tree_iter_ = std::move(other.tree_iter_);
           break;
+        case Tag::BTree:
+          btree_iter_ = std::move(other.btree_iter_);
+          break;
       }
     } else {
       this->~SortedMapIterator();
@@ -124,6 +147,8 @@ class SortedMapIterator {
         return &*array_iter_;
       case Tag::Tree:
         return tree_iter_.get();
+      case Tag::BTree:
+        return btree_iter_.get();
     }
     UNREACHABLE();
   }
@@ -144,6 +169,9 @@ class SortedMapIterator {
       case Tag::Tree:
         ++tree_iter_;
         break;
+      case Tag::BTree:
+        ++btree_iter_;
+        break;
     }
     return *this;
   }
@@ -165,6 +193,8 @@ class SortedMapIterator {
         return a.array_iter_ == b.array_iter_;
       case Tag::Tree:
         return a.tree_iter_ == b.tree_iter_;
+      case Tag::BTree:
+        return a.btree_iter_ == b.btree_iter_;
     }
     UNREACHABLE();
   }
@@ -177,12 +207,14 @@ class SortedMapIterator {
   enum class Tag {
     Array,
     Tree,
+    BTree,
   };
 
   Tag tag_;
   union {
     ArrayIter array_iter_;
     TreeIter tree_iter_;
+    BTreeIter btree_iter_;
   };
 };
 
@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/firebase/firestore/immutable/sorted_map.h"
 #include "Firestore/core/src/firebase/firestore/immutable/sorted_map_base.h"
@@ -69,6 +70,22 @@ class SortedSet {
     }
   }
 
+  /**
+   * Creates a SortedSet from the keys in the given range, which must be in
+   * ascending order with no duplicates. See SortedMap::FromSortedRange.
+   */
+  template <typename Iter>
+  static SortedSet FromSortedRange(Iter begin,
+                                   Iter end,
+                                   const C& comparator = {}) {
+    std::vector<std::pair<K, V>> entries;
+    for (; begin != end; ++begin) {
+      entries.emplace_back(*begin, V{});
+    }
+    return SortedSet{
+        M::FromSortedRange(entries.begin(), entries.end(), comparator)};
+  }
+
   bool empty() const {
     return map_.empty();
   }
@@ -85,6 +102,129 @@ class SortedSet {
     return SortedSet{map_.erase(key)};
   }
 
+  /**
+   * Creates a new set with all of the given keys added. See
+   * SortedMap::insert_all.
+   */
+  template <typename Range>
+  ABSL_MUST_USE_RESULT SortedSet insert_all(const Range& keys) const {
+    std::vector<std::pair<K, V>> entries;
+    for (const K& key : keys) {
+      entries.emplace_back(key, V{});
+    }
+    return SortedSet{map_.insert_all(entries)};
+  }
+
+  /**
+   * Creates a new set with all of the given keys removed. See
+   * SortedMap::erase_all.
+   */
+  template <typename Range>
+  ABSL_MUST_USE_RESULT SortedSet erase_all(const Range& keys) const {
+    return SortedSet{map_.erase_all(keys)};
+  }
+
+  /**
+   * Returns the set of keys in this set, `other`, or both.
+   *
+   * If one set is much smaller than the other, its missing keys are added to
+   * the larger one individually, so the result shares most of its structure.
+   * Otherwise both sets are merged in one linear pass.
+   */
+  ABSL_MUST_USE_RESULT SortedSet set_union(const SortedSet& other) const {
+    const SortedSet& larger = size() >= other.size() ? *this : other;
+    const SortedSet& smaller = size() >= other.size() ? other : *this;
+    if (larger.map_.PreferIndividualUpdates(smaller.size())) {
+      typename M::Transient result = larger.map_.transient();
+      for (const K& key : smaller) {
+        if (!result.contains(key)) {
+          result.insert(key, {});
+        }
+      }
+      return SortedSet{std::move(result).persistent()};
+    }
+
+    SortedSet result = Merge(*this, other, /*keep_lhs_only=*/true,
+                             /*keep_both=*/true, /*keep_rhs_only=*/true);
+    return result.size() == larger.size() ? larger : result;
+  }
+
+  /**
+   * Returns the set of keys in both this set and `other`.
+   *
+   * If one set is much smaller than the other, each of its keys is looked up
+   * in the larger one. Otherwise both sets are merged in one linear pass.
+   */
+  ABSL_MUST_USE_RESULT SortedSet set_intersection(
+      const SortedSet& other) const {
+    const SortedSet& larger = size() >= other.size() ? *this : other;
+    const SortedSet& smaller = size() >= other.size() ? other : *this;
+    SortedSet result;
+    if (larger.map_.PreferIndividualUpdates(smaller.size())) {
+      result = Filter(smaller, larger, /*keep_found=*/true);
+    } else {
+      result = Merge(*this, other, /*keep_lhs_only=*/false,
+                     /*keep_both=*/true, /*keep_rhs_only=*/false);
+    }
+    return result.size() == smaller.size() ? smaller : result;
+  }
+
+  /**
+   * Returns the set of keys in this set but not in `other`.
+   *
+   * If `other` is much smaller, its keys are removed from this set
+   * individually, so the result shares most of this set's structure. If this
+   * set is much smaller, each of its keys is looked up in `other`. Otherwise
+   * both sets are merged in one linear pass.
+   */
+  ABSL_MUST_USE_RESULT SortedSet set_difference(const SortedSet& other) const {
+    if (map_.PreferIndividualUpdates(other.size())) {
+      typename M::Transient result = map_.transient();
+      for (const K& key : other) {
+        if (result.contains(key)) {
+          result.erase(key);
+        }
+      }
+      return SortedSet{std::move(result).persistent()};
+    }
+
+    SortedSet result;
+    if (other.map_.PreferIndividualUpdates(size())) {
+      result = Filter(*this, other, /*keep_found=*/false);
+    } else {
+      result = Merge(*this, other, /*keep_lhs_only=*/true,
+                     /*keep_both=*/false, /*keep_rhs_only=*/false);
+    }
+    return result.size() == size() ? *this : result;
+  }
+
+  /**
+   * Returns the set of keys in exactly one of this set and `other`.
+   *
+   * If one set is much smaller than the other, each of its keys is added to
+   * or removed from the larger one individually. Otherwise both sets are
+   * merged in one linear pass.
+   */
+  ABSL_MUST_USE_RESULT SortedSet
+  set_symmetric_difference(const SortedSet& other) const {
+    const SortedSet& larger = size() >= other.size() ? *this : other;
+    const SortedSet& smaller = size() >= other.size() ? other : *this;
+    if (larger.map_.PreferIndividualUpdates(smaller.size())) {
+      typename M::Transient result = larger.map_.transient();
+      for (const K& key : smaller) {
+        if (result.contains(key)) {
+          result.erase(key);
+        } else {
+          result.insert(key, {});
+        }
+      }
+      return SortedSet{std::move(result).persistent()};
+    }
+
+    return Merge(*this, other, /*keep_lhs_only=*/true, /*keep_both=*/false,
+                 /*keep_rhs_only=*/true);
+  }
+
   bool contains(const K& key) const {
     return map_.contains(key);
   }
@@ -131,11 +271,25 @@ class SortedSet {
     return map_.keys_in(start_key, end_key);
   }
 
+  /**
+   * Reports the differences between `old_set` and `new_set`, in order: calls
+   * `on_removed(key)` for each key only in `old_set` and `on_added(key)` for
+   * each key only in `new_set`. See SortedMap::Diff.
+   */
+  template <typename OnRemoved, typename OnAdded>
+  static void Diff(const SortedSet& old_set,
+                   const SortedSet& new_set,
+                   OnRemoved&& on_removed,
+                   OnAdded&& on_added) {
+    M::Diff(
+        old_set.map_, new_set.map_,
+        [&on_removed](const entry_type& entry) { on_removed(entry.first); },
+        [&on_added](const entry_type& entry) { on_added(entry.first); },
+        [](const entry_type&, const entry_type&) {});
+  }
+
   friend bool operator==(const SortedSet& lhs, const SortedSet& rhs) {
-    if (lhs.size() != rhs.size()) {
-      return false;
-    }
-    return std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    return lhs.map_ == rhs.map_;
   }
 
   friend bool operator!=(const SortedSet& lhs, const SortedSet& rhs) {
@@ -143,6 +297,61 @@ class SortedSet {
   }
 
  private:
+  using entry_type = typename M::value_type;
+
+  /**
+   * Merges the entries of `lhs` and `rhs` in one linear pass, keeping those
+   * whose keys are only in `lhs`, in both, or only in `rhs`, as requested.
+   */
+  static SortedSet Merge(const SortedSet& lhs,
+                         const SortedSet& rhs,
+                         bool keep_lhs_only,
+                         bool keep_both,
+                         bool keep_rhs_only) {
+    const C& comparator = lhs.map_.comparator();
+    std::vector<entry_type> merged;
+
+    auto left = lhs.map_.begin();
+    auto left_end = lhs.map_.end();
+    auto right = rhs.map_.begin();
+    auto right_end = rhs.map_.end();
+    while (left != left_end && right != right_end) {
+      if (comparator(left->first, right->first)) {
+        if (keep_lhs_only) merged.push_back(*left);
+        ++left;
+      } else if (comparator(right->first, left->first)) {
+        if (keep_rhs_only) merged.push_back(*right);
+        ++right;
+      } else {
+        if (keep_both) merged.push_back(*left);
+        ++left;
+        ++right;
+      }
+    }
+    if (keep_lhs_only) merged.insert(merged.end(), left, left_end);
+    if (keep_rhs_only) merged.insert(merged.end(), right, right_end);
+
+    return SortedSet{
+        M::FromSortedRange(merged.begin(), merged.end(), comparator)};
+  }
+
+  /**
+   * Returns the entries of `set` whose keys are (or, if `keep_found` is
+   * false, are not) in `lookup`, looking up each key individually.
+   */
+  static SortedSet Filter(const SortedSet& set,
+                          const SortedSet& lookup,
+                          bool keep_found) {
+    std::vector<entry_type> kept;
+    for (const entry_type& entry : set.map_) {
+      if (lookup.contains(entry.first) == keep_found) {
+        kept.push_back(entry);
+      }
+    }
+    return SortedSet{M::FromSortedRange(kept.begin(), kept.end(),
+                                        set.map_.comparator())};
+  }
+
   M map_;
 };
 
@@ -73,6 +73,18 @@ class TreeSortedMap : public SortedMapBase, public util::ComparatorHolder<C> {
     return TreeSortedMap{std::move(node), comparator};
   }
 
+  /**
+   * Creates a TreeSortedMap from the `size` entries starting at `begin`, which
+   * must be in ascending order by key with no duplicate keys. This takes
+   * linear time.
+   */
+  template <typename Iter>
+  static TreeSortedMap FromSortedRange(Iter begin,
+                                       size_type size,
+                                       const C& comparator) {
+    return TreeSortedMap{node_type::FromSortedRange(begin, size), comparator};
+  }
+
   /** Returns true if the map contains no elements. */
   bool empty() const {
     return root_.empty();
@@ -111,6 +123,22 @@ class TreeSortedMap : public SortedMapBase, public util::ComparatorHolder<C> {
     return TreeSortedMap{root_.erase(key, comparator), comparator};
   }
 
+  /**
+   * Adds or updates a key-value pair in this map, reusing any nodes that no
+   * other map shares. Equivalent to `*this = insert(key, value)`.
+   */
+  void InsertInPlace(const K& key, const V& value) {
+    root_.InsertInPlace(key, value, this->comparator());
+  }
+
+  /**
+   * Removes a key from this map, reusing any nodes that no other map shares.
+   * Equivalent to `*this = erase(key)`.
+   */
+  void EraseInPlace(const K& key) {
+    root_.EraseInPlace(key, this->comparator());
+  }
+
   bool contains(const K& key) const {
     // Inline the tree traversal here to avoid building up the stack required
     // to construct a full iterator.
@@ -172,6 +200,52 @@ class TreeSortedMap : public SortedMapBase, public util::ComparatorHolder<C> {
     return npos;
   }
 
+  /**
+   * Returns the number of entries in the map whose keys are less than the
+   * given key.
+   */
+  size_type rank(const K& key) const {
+    const C& comparator = this->comparator();
+
+    size_type pruned_nodes = 0;
+    const node_type* node = &root_;
+    while (!node->empty()) {
+      if (comparator(node->key(), key)) {
+        pruned_nodes += node->left().size() + 1;
+        node = &node->right();
+      } else {
+        node = &node->left();
+      }
+    }
+    return pruned_nodes;
+  }
+
+  /**
+   * Returns the entry at the given index, which must be less than size().
+   */
+  const value_type& at(size_type index) const {
+    // Inline the tree traversal here to avoid building up the stack required
+    // to construct a full iterator.
+    const node_type* node = &root();
+    while (index != node->left().size()) {
+      if (index < node->left().size()) {
+        node = &node->left();
+      } else {
+        index -= node->left().size() + 1;
+        node = &node->right();
+      }
+    }
+    return node->entry();
+  }
+
+  /**
+   * Returns an iterator pointing to the entry at the given index, or end() if
+   * the index is not less than size().
+   */
+  const_iterator iterator_at(size_type index) const {
+    return const_iterator::AtIndex(&root_, index);
+  }
+
   /**
    * Finds the first entry in the map containing a key greater than or equal
    * to the given key.
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/firebase/firestore/local/leveldb_options.h"
+
+#include <memory>
+#include <string>
+
+#include "leveldb/slice.h"
+#include "leveldb/status.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+namespace {
+
+/** A table file that counts the reads made from it. */
+class CountingRandomAccessFile : public leveldb::RandomAccessFile {
+ public:
+  CountingRandomAccessFile(leveldb::RandomAccessFile* file,
+                           std::atomic<int64_t>* reads)
+      : file_(file), reads_(reads) {
+  }
+
+  leveldb::Status Read(uint64_t offset,
+                       size_t n,
+                       leveldb::Slice* result,
+                       char* scratch) const override {
+    reads_->fetch_add(1, std::memory_order_relaxed);
+    return file_->Read(offset, n, result, scratch);
+  }
+
+ private:
+  std::unique_ptr<leveldb::RandomAccessFile> file_;
+  std::atomic<int64_t>* reads_;
+};
+
+/**
+ * The default environment, except that it counts reads from the files LevelDB
+ * opens for random access, which are the tables it reads blocks from.
+ */
+class CountingEnv : public leveldb::EnvWrapper {
+ public:
+  explicit CountingEnv(std::atomic<int64_t>* reads)
+      : EnvWrapper(leveldb::Env::Default()), reads_(reads) {
+  }
+
+  leveldb::Status NewRandomAccessFile(
+      const std::string& name, leveldb::RandomAccessFile** result) override {
+    leveldb::Status status = target()->NewRandomAccessFile(name, result);
+    if (status.ok()) {
+      *result = new CountingRandomAccessFile(*result, reads_);
+    }
+    return status;
+  }
+
+ private:
+  std::atomic<int64_t>* reads_;
+};
+
+}  // namespace
+
+LevelDbConfig::LevelDbConfig(const LevelDbOptions& options)
+    : env_(new CountingEnv(&stats_.block_reads)) {
+  open_options_.env = env_.get();
+  if (options.block_cache_bytes > 0) {
+    block_cache_.reset(leveldb::NewLRUCache(options.block_cache_bytes));
+    open_options_.block_cache = block_cache_.get();
+  }
+  if (options.bloom_filter_bits_per_key > 0) {
+    filter_policy_.reset(
+        leveldb::NewBloomFilterPolicy(options.bloom_filter_bits_per_key));
+    open_options_.filter_policy = filter_policy_.get();
+  }
+  open_options_.create_if_missing = true;
+  open_options_.write_buffer_size = options.write_buffer_bytes;
+  open_options_.max_open_files = options.max_open_files;
+  open_options_.compression = options.compression
+                                  ? leveldb::kSnappyCompression
+                                  : leveldb::kNoCompression;
+
+  read_options_.verify_checksums =
+      options.verify_checksums != ChecksumVerification::kNone;
+  scan_options_.verify_checksums =
+      options.verify_checksums == ChecksumVerification::kAll;
+  scan_options_.fill_cache = options.fill_cache_on_scans;
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_LOCAL_LEVELDB_OPTIONS_H_
+#define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_LOCAL_LEVELDB_OPTIONS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "leveldb/cache.h"
+#include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/options.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+/** Which reads should verify the checksums of the blocks they read. */
+enum class ChecksumVerification {
+  /** No reads verify checksums. */
+  kNone,
+
+  /**
+   * Point lookups verify checksums, but scans don't. A corrupt block read by
+   * a scan still fails to decompress or parse in most cases; checksums only
+   * add detection of corruption that leaves the block readable.
+   */
+  kPointReads,
+
+  /** All reads verify checksums. */
+  kAll,
+};
+
+/**
+ * Tuning parameters for the LevelDB database that backs local persistence.
+ *
+ * The defaults are LevelDB's own, except that checksums are verified on every
+ * read and tables carry bloom filters. Changing any of these is compatible
+ * with existing databases, though bloom filters only take effect for tables
+ * written after they're enabled.
+ */
+struct LevelDbOptions {
+  /**
+   * The capacity in bytes of the cache of uncompressed blocks shared by all
+   * reads, or 0 to use LevelDB's built-in 8MB cache. A larger cache speeds up
+   * repeated reads of large caches at the cost of resident memory.
+   */
+  size_t block_cache_bytes = 0;
+
+  /**
+   * The number of bits per key in the bloom filter stored with each table, or
+   * 0 for no filters. Filters let lookups of absent keys skip reading data
+   * blocks from most tables; 10 bits per key gives a false positive rate of
+   * about 1%.
+   *
+   * Lookups of absent keys are common--every document the remote document
+   * cache has never seen is one--and without filters each costs a data block
+   * read from every level whose key range covers the key.
+   */
+  int bloom_filter_bits_per_key = 10;
+
+  /**
+   * The number of bytes of writes to buffer in memory before converting them
+   * to a sorted table on disk. Larger buffers mean fewer, larger tables and
+   * faster bulk writes, at the cost of memory and of a longer log to replay
+   * when the database is opened.
+   */
+  size_t write_buffer_bytes = 4 * 1024 * 1024;
+
+  /** The number of table files LevelDB may keep open at once. */
+  int max_open_files = 1000;
+
+  /** Whether to compress blocks with Snappy, if LevelDB was built with it. */
+  bool compression = true;
+
+  ChecksumVerification verify_checksums = ChecksumVerification::kAll;
+
+  /**
+   * Whether blocks read by scans are added to the block cache. Turning this
+   * off keeps scans of large collections from evicting the blocks that point
+   * lookups reuse.
+   */
+  bool fill_cache_on_scans = true;
+};
+
+/**
+ * Counters of the work done by reads from a LevelDB database, for measuring
+ * in particular what lookups of absent keys cost.
+ */
+struct LevelDbStats {
+  /** The number of point lookups made through LevelDbTransactions. */
+  std::atomic<int64_t> lookups{0};
+
+  /** The number of those lookups that found no row. */
+  std::atomic<int64_t> misses{0};
+
+  /**
+   * The number of reads from table files made while looking up keys that
+   * turned out not to exist. Reads from a background compaction that overlap
+   * a lookup are counted too, so this is an upper bound.
+   */
+  std::atomic<int64_t> miss_block_reads{0};
+
+  /**
+   * The number of reads from table files for any purpose--lookups, scans and
+   * compactions. Reads of blocks found in the block cache aren't counted.
+   */
+  std::atomic<int64_t> block_reads{0};
+};
+
+/**
+ * The LevelDB options derived from a LevelDbOptions, along with the block
+ * cache, filter policy and environment they refer to. A LevelDbConfig must
+ * outlive any database opened with its open_options().
+ */
+class LevelDbConfig {
+ public:
+  explicit LevelDbConfig(const LevelDbOptions& options = LevelDbOptions{});
+
+  LevelDbConfig(const LevelDbConfig&) = delete;
+  LevelDbConfig& operator=(const LevelDbConfig&) = delete;
+
+  /** The options with which to open (and create) the database. */
+  const leveldb::Options& open_options() const {
+    return open_options_;
+  }
+
+  /** The options for looking up individual keys. */
+  const leveldb::ReadOptions& read_options() const {
+    return read_options_;
+  }
+
+  /** The options for iterating over ranges of keys. */
+  const leveldb::ReadOptions& scan_options() const {
+    return scan_options_;
+  }
+
+  const leveldb::WriteOptions& write_options() const {
+    return write_options_;
+  }
+
+  /**
+   * Counters of the reads from any database opened with open_options(),
+   * updated by LevelDbTransactions created with this config.
+   */
+  LevelDbStats& stats() const {
+    return stats_;
+  }
+
+ private:
+  mutable LevelDbStats stats_;
+
+  std::unique_ptr<leveldb::Cache> block_cache_;
+  std::unique_ptr<const leveldb::FilterPolicy> filter_policy_;
+  std::unique_ptr<leveldb::Env> env_;
+
+  leveldb::Options open_options_;
+  leveldb::ReadOptions read_options_;
+  leveldb::ReadOptions scan_options_;
+  leveldb::WriteOptions write_options_;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_LOCAL_LEVELDB_OPTIONS_H_
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/firebase/firestore/local/leveldb_remote_document_cache.h"
+
+#include <cstdint>
+#include <utility>
+
+#include "Firestore/core/src/firebase/firestore/local/leveldb_util.h"
+#include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
+#include "Firestore/core/src/firebase/firestore/util/status.h"
+#include "Firestore/core/src/firebase/firestore/util/string_util.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "leveldb/status.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+using model::Document;
+using model::DocumentKey;
+using model::MaybeDocument;
+using model::ResourcePath;
+using util::Status;
+
+void LevelDbRemoteDocumentCache::Add(const MaybeDocument& document) {
+  std::vector<uint8_t> bytes;
+  Status status = serializer_->EncodeMaybeDocument(document, &bytes);
+  HARD_ASSERT(status.ok(), "Failed to encode document %s: %s",
+              document.key().ToString(), status.ToString());
+
+  transaction_->Put(
+      LevelDbRemoteDocumentKey::Key(document.key()),
+      absl::string_view{reinterpret_cast<const char*>(bytes.data()),
+                        bytes.size()});
+}
+
+void LevelDbRemoteDocumentCache::Remove(const DocumentKey& key) {
+  transaction_->Delete(LevelDbRemoteDocumentKey::Key(key));
+}
+
+std::unique_ptr<MaybeDocument> LevelDbRemoteDocumentCache::Get(
+    const DocumentKey& key) {
+  std::string value;
+  leveldb::Status status =
+      transaction_->Get(LevelDbRemoteDocumentKey::Key(key), &value);
+  if (status.IsNotFound()) {
+    return nullptr;
+  }
+  HARD_ASSERT(status.ok(), "Fetch document for key (%s) failed with status: %s",
+              key.ToString(), status.ToString());
+  return Decode(value, key);
+}
+
+LevelDbRemoteDocumentCache::CollectionScan
+LevelDbRemoteDocumentCache::ScanCollection(const ResourcePath& collection) {
+  return CollectionScan{this, collection};
+}
+
+std::vector<std::unique_ptr<Document>>
+LevelDbRemoteDocumentCache::GetCollection(const ResourcePath& collection) {
+  std::vector<std::unique_ptr<Document>> result;
+  for (auto scan = ScanCollection(collection); scan.Valid(); scan.Next()) {
+    std::unique_ptr<MaybeDocument> document = scan.Decode();
+    if (document->type() == MaybeDocument::Type::Document) {
+      result.emplace_back(static_cast<Document*>(document.release()));
+    }
+  }
+  return result;
+}
+
+std::unique_ptr<MaybeDocument> LevelDbRemoteDocumentCache::Decode(
+    absl::string_view encoded, const DocumentKey& key) const {
+  auto decoded = serializer_->DecodeMaybeDocument(
+      reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+  HARD_ASSERT(decoded.ok(), "MaybeDocument for key (%s) failed to parse: %s",
+              key.ToString(), decoded.status().ToString());
+
+  std::unique_ptr<MaybeDocument> document = std::move(decoded).ValueOrDie();
+  HARD_ASSERT(document->key() == key,
+              "Read document has key (%s) instead of expected key (%s).",
+              document->key().ToString(), key.ToString());
+  return document;
+}
+
+LevelDbRemoteDocumentCache::CollectionScan::CollectionScan(
+    const LevelDbRemoteDocumentCache* cache, const ResourcePath& collection)
+    : cache_(cache),
+      it_(cache->transaction_->NewIterator()),
+      prefix_(LevelDbRemoteDocumentKey::KeyPrefix(collection)),
+      depth_(collection.size() + 1) {
+  HARD_ASSERT(!DocumentKey::IsDocumentKey(collection),
+              "ScanCollection requires a collection path, but got %s",
+              collection.CanonicalString());
+  it_->Seek(prefix_);
+  Settle();
+}
+
+void LevelDbRemoteDocumentCache::CollectionScan::Next() {
+  HARD_ASSERT(valid_, "Next() called on an invalid scan");
+  it_->Next();
+  Settle();
+}
+
+std::unique_ptr<MaybeDocument>
+LevelDbRemoteDocumentCache::CollectionScan::Decode() const {
+  HARD_ASSERT(valid_, "Decode() called on an invalid scan");
+  return cache_->Decode(it_->value(), key());
+}
+
+void LevelDbRemoteDocumentCache::CollectionScan::Settle() {
+  valid_ = false;
+  while (it_->Valid()) {
+    absl::string_view row = it_->key();
+    if (!absl::StartsWith(row, prefix_) || !row_key_.Decode(MakeSlice(row))) {
+      return;
+    }
+
+    const ResourcePath& path = row_key_.document_key().path();
+    if (path.size() == depth_) {
+      valid_ = true;
+      return;
+    }
+
+    // This row belongs to a subcollection of a document in the collection,
+    // and so do all the rows up to the end of that document's key range.
+    ResourcePath document{path.begin(), path.begin() + depth_};
+    it_->Seek(
+        util::PrefixSuccessor(LevelDbRemoteDocumentKey::KeyPrefix(document)));
+    skipped_subtrees_++;
+  }
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
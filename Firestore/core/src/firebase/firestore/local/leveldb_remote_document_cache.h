@@ -0,0 +1,161 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_LOCAL_LEVELDB_REMOTE_DOCUMENT_CACHE_H_
+#define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_LOCAL_LEVELDB_REMOTE_DOCUMENT_CACHE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Firestore/core/src/firebase/firestore/local/leveldb_key.h"
+#include "Firestore/core/src/firebase/firestore/local/leveldb_transaction.h"
+#include "Firestore/core/src/firebase/firestore/local/local_serializer.h"
+#include "Firestore/core/src/firebase/firestore/model/document.h"
+#include "Firestore/core/src/firebase/firestore/model/document_key.h"
+#include "Firestore/core/src/firebase/firestore/model/maybe_document.h"
+#include "Firestore/core/src/firebase/firestore/model/resource_path.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+/**
+ * Cached remote documents backed by LevelDB, stored in the same table and
+ * format as FSTLevelDBRemoteDocumentCache.
+ *
+ * A cache reads and writes through a single transaction, so create one for
+ * each transaction that uses it.
+ */
+class LevelDbRemoteDocumentCache {
+ public:
+  class CollectionScan;
+
+  /**
+   * Creates a cache that works through the given transaction and encodes
+   * documents with the given serializer, both of which must outlive it.
+   */
+  LevelDbRemoteDocumentCache(LevelDbTransaction* transaction,
+                             const LocalSerializer* serializer)
+      : transaction_(transaction), serializer_(serializer) {
+  }
+
+  /** Adds the given document to the cache, replacing any existing entry. */
+  void Add(const model::MaybeDocument& document);
+
+  /** Removes the cached entry for the given key, if there is one. */
+  void Remove(const model::DocumentKey& key);
+
+  /**
+   * Returns the cached entry for the given key: a Document, a NoDocument
+   * marking it deleted, or nullptr if nothing is cached for it.
+   */
+  std::unique_ptr<model::MaybeDocument> Get(const model::DocumentKey& key);
+
+  /**
+   * Returns a scan over the entries of the documents directly in the given
+   * collection, in key order. The documents of subcollections are skipped.
+   */
+  CollectionScan ScanCollection(const model::ResourcePath& collection);
+
+  /**
+   * Returns the documents directly in the given collection, in key order,
+   * leaving out the NoDocuments of deleted ones.
+   *
+   * This is all a collection query needs to match against: the documents of
+   * subcollections never match it.
+   */
+  std::vector<std::unique_ptr<model::Document>> GetCollection(
+      const model::ResourcePath& collection);
+
+ private:
+  std::unique_ptr<model::MaybeDocument> Decode(
+      absl::string_view encoded, const model::DocumentKey& key) const;
+
+  LevelDbTransaction* transaction_;
+  const LocalSerializer* serializer_;
+};
+
+/**
+ * A streaming scan over the entries of the documents directly in one
+ * collection, which decodes nothing but row keys until asked.
+ *
+ * Rows in subcollections of the collection's documents are skipped without
+ * decoding them: on reaching the first of them the scan seeks past the rest.
+ *
+ * Usage:
+ *
+ *     auto scan = cache.ScanCollection(path);
+ *     for (; scan.Valid(); scan.Next()) {
+ *       if (Wanted(scan.key())) {
+ *         std::unique_ptr<MaybeDocument> document = scan.Decode();
+ *         ...
+ *       }
+ *     }
+ */
+class LevelDbRemoteDocumentCache::CollectionScan {
+ public:
+  /** Returns true if the scan is positioned at an entry. */
+  bool Valid() const {
+    return valid_;
+  }
+
+  /** Advances to the entry of the next document in the collection. */
+  void Next();
+
+  /** The key of the current entry, decoded from the row key alone. */
+  const model::DocumentKey& key() const {
+    return row_key_.document_key();
+  }
+
+  /** Decodes the current entry. */
+  std::unique_ptr<model::MaybeDocument> Decode() const;
+
+  /**
+   * The number of times the scan has sought past the subcollections of a
+   * document, for testing.
+   */
+  size_t skipped_subtrees() const {
+    return skipped_subtrees_;
+  }
+
+ private:
+  friend class LevelDbRemoteDocumentCache;
+
+  CollectionScan(const LevelDbRemoteDocumentCache* cache,
+                 const model::ResourcePath& collection);
+
+  /**
+   * Moves forward from the current row to the next entry of a document
+   * directly in the collection, if there is one.
+   */
+  void Settle();
+
+  const LevelDbRemoteDocumentCache* cache_;
+  std::unique_ptr<LevelDbTransaction::Iterator> it_;
+  std::string prefix_;
+  size_t depth_;
+  LevelDbRemoteDocumentKey row_key_;
+  size_t skipped_subtrees_ = 0;
+  bool valid_ = false;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_LOCAL_LEVELDB_REMOTE_DOCUMENT_CACHE_H_
@@ -17,6 +17,7 @@
 #include "Firestore/core/src/firebase/firestore/local/leveldb_transaction.h"
 
 #include "Firestore/core/src/firebase/firestore/local/leveldb_key.h"
+#include "Firestore/core/src/firebase/firestore/local/leveldb_util.h"
 #include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
 #include "Firestore/core/src/firebase/firestore/util/log.h"
 #include "absl/memory/memory.h"
@@ -24,7 +25,6 @@
 
 using leveldb::DB;
 using leveldb::ReadOptions;
-using leveldb::Slice;
 using leveldb::Status;
 using leveldb::WriteBatch;
 using leveldb::WriteOptions;
@@ -34,19 +34,41 @@ namespace firestore {
 namespace local {
 
 LevelDbTransaction::Iterator::Iterator(LevelDbTransaction* txn)
-    : db_iter_(txn->db_->NewIterator(txn->read_options_)),
+    : db_iter_(txn->db_->NewIterator(txn->scan_options_)),
       last_version_(txn->version_),
       txn_(txn),
-      mutations_iter_(txn->mutations_.begin()),
-      current_(),
+      changes_iter_(txn->changes_.begin()),
+      current_key_(),
+      current_value_(),
       is_mutation_(false),
       // Iterator doesn't really point to anything yet, so is
       // invalid
       is_valid_(false) {
 }
 
+void LevelDbTransaction::Iterator::SkipDeleted() {
+  auto changes_end = txn_->changes_.end();
+  for (; changes_iter_ != changes_end && changes_iter_->second.deleted;
+       ++changes_iter_) {
+    if (db_iter_->Valid()) {
+      int cmp = db_iter_->key().compare(MakeSlice(changes_iter_->first));
+      if (cmp < 0) {
+        // The leveldb entry comes before the deletion, so isn't affected.
+        break;
+      } else if (cmp == 0) {
+        db_iter_->Next();
+      }
+    }
+  }
+  HARD_ASSERT(db_iter_->status().ok(), "leveldb iterator reported an error: %s",
+              db_iter_->status().ToString());
+}
+
 void LevelDbTransaction::Iterator::UpdateCurrent() {
-  bool mutation_is_valid = mutations_iter_ != txn_->mutations_.end();
+  SkipDeleted();
+
+  bool mutation_is_valid = changes_iter_ != txn_->changes_.end() &&
+                           !changes_iter_->second.deleted;
   is_valid_ = mutation_is_valid || db_iter_->Valid();
 
   if (is_valid_) {
@@ -59,12 +81,15 @@ void LevelDbTransaction::Iterator::UpdateCurrent() {
       // than the current mutation key, we are looking at a mutation next. It's
       // either sooner in the iteration or directly shadowing the underlying
       // committed value in leveldb.
-      is_mutation_ = db_iter_->key().compare(mutations_iter_->first) >= 0;
+      is_mutation_ =
+          db_iter_->key().compare(MakeSlice(changes_iter_->first)) >= 0;
     }
     if (is_mutation_) {
-      current_ = *mutations_iter_;
+      current_key_ = changes_iter_->first;
+      current_value_ = changes_iter_->second.value;
     } else {
-      current_ = {db_iter_->key().ToString(), db_iter_->value().ToString()};
+      current_key_ = MakeStringView(db_iter_->key());
+      current_value_ = MakeStringView(db_iter_->value());
     }
   }
 }
@@ -73,63 +98,51 @@ void LevelDbTransaction::Iterator::Seek(const std::string& key) {
   db_iter_->Seek(key);
   HARD_ASSERT(db_iter_->status().ok(), "leveldb iterator reported an error: %s",
               db_iter_->status().ToString());
-  for (; db_iter_->Valid() && IsDeleted(db_iter_->key()); db_iter_->Next()) {
-  }
-  HARD_ASSERT(db_iter_->status().ok(), "leveldb iterator reported an error: %s",
-              db_iter_->status().ToString());
-  mutations_iter_ = txn_->mutations_.lower_bound(key);
+  changes_iter_ = txn_->changes_.lower_bound(key);
   UpdateCurrent();
   last_version_ = txn_->version_;
 }
 
 absl::string_view LevelDbTransaction::Iterator::key() {
   HARD_ASSERT(Valid(), "key() called on invalid iterator");
-  return current_.first;
+  return current_key_;
 }
 
 absl::string_view LevelDbTransaction::Iterator::value() {
   HARD_ASSERT(Valid(), "value() called on invalid iterator");
-  return current_.second;
-}
-
-bool LevelDbTransaction::Iterator::IsDeleted(leveldb::Slice slice) {
-  return txn_->deletions_.find(slice.ToString()) != txn_->deletions_.end();
+  return current_value_;
 }
 
 bool LevelDbTransaction::Iterator::SyncToTransaction() {
   if (last_version_ < txn_->version_) {
-    // Intentionally copying here since Seek() may update current_. We need the
-    // copy to do the comparison below.
-    const std::string current_key = current_.first;
+    // Intentionally copying here since Seek() may update current_key_. We need
+    // the copy to do the comparison below.
+    const std::string current_key{current_key_};
     Seek(current_key);
     // If we advanced, we don't need to advance again.
-    return is_valid_ && current_.first > current_key;
+    return is_valid_ && current_key_ > current_key;
   } else {
     return false;
   }
 }
 
-void LevelDbTransaction::Iterator::AdvanceLDB() {
-  do {
-    db_iter_->Next();
-  } while (db_iter_->Valid() && IsDeleted(db_iter_->key()));
-  HARD_ASSERT(db_iter_->status().ok(), "leveldb iterator reported an error: %s",
-              db_iter_->status().ToString());
-}
-
 void LevelDbTransaction::Iterator::Next() {
   HARD_ASSERT(Valid(), "Next() called on invalid iterator");
   bool advanced = SyncToTransaction();
   if (!advanced && is_valid_) {
     if (is_mutation_) {
       // A mutation might be shadowing leveldb. If so, advance both.
-      if (db_iter_->Valid() && db_iter_->key() == mutations_iter_->first) {
-        AdvanceLDB();
+      if (db_iter_->Valid() &&
+          MakeStringView(db_iter_->key()) == changes_iter_->first) {
+        db_iter_->Next();
       }
-      ++mutations_iter_;
+      ++changes_iter_;
     } else {
-      AdvanceLDB();
+      db_iter_->Next();
     }
+    HARD_ASSERT(db_iter_->status().ok(),
+                "leveldb iterator reported an error: %s",
+                db_iter_->status().ToString());
     UpdateCurrent();
   }
 }
@@ -143,14 +156,24 @@ LevelDbTransaction::LevelDbTransaction(DB* db,
                                        const ReadOptions& read_options,
                                        const WriteOptions& write_options)
     : db_(db),
-      mutations_(),
-      deletions_(),
+      changes_(),
       read_options_(read_options),
+      scan_options_(read_options),
       write_options_(write_options),
+      stats_(nullptr),
       version_(0),
       label_(std::string{label}) {
 }
 
+LevelDbTransaction::LevelDbTransaction(DB* db,
+                                       absl::string_view label,
+                                       const LevelDbConfig& config)
+    : LevelDbTransaction(
+          db, label, config.read_options(), config.write_options()) {
+  scan_options_ = config.scan_options();
+  stats_ = &config.stats();
+}
+
 const ReadOptions& LevelDbTransaction::DefaultReadOptions() {
   static ReadOptions options = ([]() {
     ReadOptions read_options;
@@ -167,10 +190,7 @@ const WriteOptions& LevelDbTransaction::DefaultWriteOptions() {
 
 void LevelDbTransaction::Put(const absl::string_view& key,
                              const absl::string_view& value) {
-  std::string key_string(key);
-  std::string value_string(value);
-  mutations_[key_string] = value_string;
-  deletions_.erase(key_string);
+  changes_.Put(key, value);
   version_++;
 }
 
@@ -181,36 +201,37 @@ LevelDbTransaction::NewIterator() {
 
 Status LevelDbTransaction::Get(const absl::string_view& key,
                                std::string* value) {
-  std::string key_string(key);
-  if (deletions_.find(key_string) != deletions_.end()) {
-    return Status::NotFound(key_string + " is not present in the transaction");
-  } else {
-    Mutations::iterator iter(mutations_.find(key_string));
-    if (iter != mutations_.end()) {
-      *value = iter->second;
-      return Status::OK();
-    } else {
-      return db_->Get(read_options_, key_string, value);
+  auto change = changes_.find(key);
+  if (change == changes_.end()) {
+    if (!stats_) {
+      return db_->Get(read_options_, MakeSlice(key), value);
     }
+
+    int64_t block_reads = stats_->block_reads.load();
+    Status status = db_->Get(read_options_, MakeSlice(key), value);
+    stats_->lookups++;
+    if (status.IsNotFound()) {
+      stats_->misses++;
+      stats_->miss_block_reads += stats_->block_reads.load() - block_reads;
+    }
+    return status;
+  } else if (change->second.deleted) {
+    return Status::NotFound(std::string{key} +
+                            " is not present in the transaction");
+  } else {
+    value->assign(change->second.value.data(), change->second.value.size());
+    return Status::OK();
   }
 }
 
 void LevelDbTransaction::Delete(const absl::string_view& key) {
-  std::string to_delete(key);
-  deletions_.insert(to_delete);
-  mutations_.erase(to_delete);
+  changes_.Delete(key);
   version_++;
 }
 
 void LevelDbTransaction::Commit() {
   WriteBatch batch;
-  for (auto it = deletions_.begin(); it != deletions_.end(); it++) {
-    batch.Delete(*it);
-  }
-
-  for (auto it = mutations_.begin(); it != mutations_.end(); it++) {
-    batch.Put(it->first, it->second);
-  }
+  changes_.AppendTo(&batch);
 
   LOG_DEBUG("Committing transaction: %s", ToString());
 
@@ -221,18 +242,22 @@ void LevelDbTransaction::Commit() {
 
 std::string LevelDbTransaction::ToString() {
   std::string dest("<LevelDbTransaction " + label_ + ": ");
-  int64_t changes = deletions_.size() + mutations_.size();
+  int64_t changes = changes_.size();
   int64_t bytes = 0;  // accumulator for size of individual mutations.
   dest += std::to_string(changes) + " changes ";
   std::string items;  // accumulator for individual changes.
-  for (auto it = deletions_.begin(); it != deletions_.end(); it++) {
-    items += "\n  - Delete " + Describe(*it);
+  for (const auto& change : changes_) {
+    if (change.second.deleted) {
+      items += "\n  - Delete " + Describe(MakeSlice(change.first));
+    }
   }
-  for (auto it = mutations_.begin(); it != mutations_.end(); it++) {
-    int64_t change_bytes = it->second.length();
-    bytes += change_bytes;
-    items += "\n  - Put " + Describe(it->first) + " (" +
-             std::to_string(change_bytes) + " bytes)";
+  for (const auto& change : changes_) {
+    if (!change.second.deleted) {
+      int64_t change_bytes = change.second.value.size();
+      bytes += change_bytes;
+      items += "\n  - Put " + Describe(MakeSlice(change.first)) + " (" +
+               std::to_string(change_bytes) + " bytes)";
+    }
   }
   dest += "(" + std::to_string(bytes) + " bytes):" + items + ">";
   return dest;
@@ -18,12 +18,11 @@
 #define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_LOCAL_LEVELDB_TRANSACTION_H_
 
 #include <cstdint>
-#include <map>
 #include <memory>
-#include <set>
 #include <string>
-#include <utility>
 
+#include "Firestore/core/src/firebase/firestore/local/leveldb_options.h"
+#include "Firestore/core/src/firebase/firestore/local/leveldb_write_buffer.h"
 #include "absl/strings/string_view.h"
 #include "leveldb/db.h"
 
@@ -41,9 +40,6 @@ namespace local {
  * changes and committed values.
  */
 class LevelDbTransaction {
-  using Deletions = std::set<std::string>;
-  using Mutations = std::map<std::string, std::string>;
-
  public:
   /**
    * Iterator iterates over a merged view of pending changes from the
@@ -70,38 +66,35 @@ class LevelDbTransaction {
     void Next();
 
     /**
-     * Returns the key of the current entry
+     * Returns the key of the current entry. The result remains valid until the
+     * next call to Seek() or Next().
      */
     absl::string_view key();
 
     /**
-     * Returns the value of the current entry
+     * Returns the value of the current entry. The result remains valid until
+     * the next call to Seek() or Next().
      */
     absl::string_view value();
 
    private:
     /**
-     * Advances to the next non-deleted key in leveldb.
-     */
-    void AdvanceLDB();
-
-    /**
-     * Returns true if the given slice matches a key present in the deletions_
-     * set.
+     * Skips past the pending deletions at the front of changes_iter_, along
+     * with the leveldb entries they delete.
      */
-    bool IsDeleted(leveldb::Slice slice);
+    void SkipDeleted();
 
     /**
      * Syncs with the underlying transaction. If the transaction has been
      * updated, the mutation iterator may need to be reset. Returns true if this
-     * resulted in moving to a new underlying entry (i.e. the entry represented
-     * by current_ was deleted).
+     * resulted in moving to a new underlying entry (i.e. the current entry was
+     * deleted).
      */
     bool SyncToTransaction();
 
     /**
      * Given the current state of the internal iterators, set is_valid_,
-     * is_mutation_, and current_.
+     * is_mutation_, current_key_, and current_value_.
      */
     void UpdateCurrent();
 
@@ -111,13 +104,16 @@ class LevelDbTransaction {
     int32_t last_version_;
     // The underlying transaction.
     LevelDbTransaction* txn_;
-    Mutations::iterator mutations_iter_;
-    // We save the current key and value so that once an iterator is Valid(), it
-    // remains so at least until the next call to Seek() or Next(), even if the
-    // underlying data is deleted.
-    std::pair<std::string, std::string> current_;
-    // True if current_ represents an entry in the mutations_ map, rather than
-    // committed data.
+    LevelDbWriteBuffer::const_iterator changes_iter_;
+    // Once an iterator is Valid(), the current key and value remain valid at
+    // least until the next call to Seek() or Next(), even if the underlying
+    // data is changed: committed entries are read from db_iter_, which doesn't
+    // see changes in the transaction, and pending ones from the transaction's
+    // write buffer, which never frees them.
+    absl::string_view current_key_;
+    absl::string_view current_value_;
+    // True if the current entry is a pending change from the write buffer,
+    // rather than committed data.
     bool is_mutation_;
     // True if the iterator pointed to a valid entry the last time Next() or
     // Seek() was called.
@@ -130,6 +126,15 @@ class LevelDbTransaction {
       const leveldb::ReadOptions& read_options = DefaultReadOptions(),
       const leveldb::WriteOptions& write_options = DefaultWriteOptions());
 
+  /**
+   * Creates a transaction that reads and writes with the options in `config`,
+   * using its scan options for Iterators, and that counts its lookups in the
+   * config's stats(). The config must outlive the transaction.
+   */
+  LevelDbTransaction(leveldb::DB* db,
+                     absl::string_view label,
+                     const LevelDbConfig& config);
+
   LevelDbTransaction(const LevelDbTransaction& other) = delete;
 
   LevelDbTransaction& operator=(const LevelDbTransaction& other) = delete;
@@ -145,7 +150,7 @@ class LevelDbTransaction {
   static const leveldb::WriteOptions& DefaultWriteOptions();
 
   size_t changed_keys() const {
-    return mutations_.size() + deletions_.size();
+    return changes_.size();
   }
 
   /**
@@ -161,9 +166,8 @@ class LevelDbTransaction {
    */
   void Put(const absl::string_view& key, GPBMessage* message) {
     NSData* data = [message data];
-    std::string key_string(key);
-    mutations_[key_string] = std::string((const char*)data.bytes, data.length);
-    version_++;
+    Put(key, absl::string_view{static_cast<const char*>(data.bytes),
+                               data.length});
   }
 #endif
 
@@ -197,10 +201,13 @@ class LevelDbTransaction {
 
  private:
   leveldb::DB* db_;
-  Mutations mutations_;
-  Deletions deletions_;
+  LevelDbWriteBuffer changes_;
   leveldb::ReadOptions read_options_;
+  // The options with which Iterators read, which may differ from those of Get.
+  leveldb::ReadOptions scan_options_;
   leveldb::WriteOptions write_options_;
+  // Where to count lookups, or nullptr if they aren't counted.
+  LevelDbStats* stats_;
   int32_t version_;
   std::string label_;
 };
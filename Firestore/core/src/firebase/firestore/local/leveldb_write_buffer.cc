@@ -0,0 +1,101 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/firebase/firestore/local/leveldb_write_buffer.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "Firestore/core/src/firebase/firestore/local/leveldb_util.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+namespace {
+
+// The size of each arena block. Allocations larger than a quarter of this get
+// blocks of their own, so that they don't waste the rest of a block.
+const size_t kBlockSize = 32 * 1024;
+
+}  // namespace
+
+void LevelDbWriteBuffer::Put(absl::string_view key, absl::string_view value) {
+  Change& change = Entry(key);
+  change.value = Copy(value);
+  change.deleted = false;
+}
+
+void LevelDbWriteBuffer::Delete(absl::string_view key) {
+  Change& change = Entry(key);
+  change.value = absl::string_view{};
+  change.deleted = true;
+}
+
+void LevelDbWriteBuffer::AppendTo(leveldb::WriteBatch* batch) const {
+  for (const auto& entry : changes_) {
+    if (entry.second.deleted) {
+      batch->Delete(MakeSlice(entry.first));
+    } else {
+      batch->Put(MakeSlice(entry.first), MakeSlice(entry.second.value));
+    }
+  }
+}
+
+LevelDbWriteBuffer::Change& LevelDbWriteBuffer::Entry(absl::string_view key) {
+  auto found = changes_.lower_bound(key);
+  if (found != changes_.end() && found->first == key) {
+    return found->second;
+  }
+  return changes_.emplace_hint(found, Copy(key), Change{{}, false})->second;
+}
+
+absl::string_view LevelDbWriteBuffer::Copy(absl::string_view bytes) {
+  size_t size = bytes.size();
+  if (size == 0) {
+    return absl::string_view{};
+  }
+
+  char* result = arena_.Allocate(size, 1);
+  arena_bytes_ += size;
+  std::memcpy(result, bytes.data(), size);
+  return absl::string_view{result, size};
+}
+
+char* LevelDbWriteBuffer::Arena::Allocate(size_t size, size_t alignment) {
+  if (size > kBlockSize / 4) {
+    blocks_.emplace_back(new char[size]);
+    return blocks_.back().get();
+  }
+
+  size_t padding =
+      (alignment - reinterpret_cast<uintptr_t>(block_ptr_) % alignment) %
+      alignment;
+  if (padding + size > block_remaining_) {
+    blocks_.emplace_back(new char[kBlockSize]);
+    block_ptr_ = blocks_.back().get();
+    block_remaining_ = kBlockSize;
+    padding = 0;
+  }
+  char* result = block_ptr_ + padding;
+  block_ptr_ += padding + size;
+  block_remaining_ -= padding + size;
+  return result;
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
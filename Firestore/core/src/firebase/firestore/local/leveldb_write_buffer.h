@@ -0,0 +1,185 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_LOCAL_LEVELDB_WRITE_BUFFER_H_
+#define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_LOCAL_LEVELDB_WRITE_BUFFER_H_
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "leveldb/write_batch.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+/**
+ * The pending changes of a LevelDbTransaction: a sorted map from each changed
+ * key to either its new value or a tombstone marking it deleted, similar to
+ * LevelDB's own memtable.
+ *
+ * Keys, values and the map's own nodes are all allocated from an arena of
+ * large blocks rather than each being allocated separately, and nothing in
+ * the arena is freed until the buffer is destroyed. Entries are never removed
+ * either--deleting a key just marks it with a tombstone--and every Put copies
+ * its value into new space, so the keys and values returned by the buffer
+ * remain valid and unchanged for its lifetime, even after they're
+ * overwritten.
+ */
+class LevelDbWriteBuffer {
+ private:
+  /** Hands out memory from large blocks, all freed with the arena. */
+  class Arena {
+   public:
+    /** Returns `size` bytes aligned to `alignment`, a power of two. */
+    char* Allocate(size_t size, size_t alignment);
+
+   private:
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* block_ptr_ = nullptr;
+    size_t block_remaining_ = 0;
+  };
+
+  /**
+   * Allocates the map's nodes from the arena. Deallocation does nothing, since
+   * the buffer never removes entries and the arena outlives the map.
+   */
+  template <typename T>
+  class ArenaAllocator {
+   public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena* arena) : arena_{arena} {
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other)  // NOLINT(runtime/explicit)
+        : arena_{other.arena_} {
+    }
+
+    T* allocate(size_t n) {
+      return reinterpret_cast<T*>(
+          arena_->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) {
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+      return arena_ == other.arena_;
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const {
+      return arena_ != other.arena_;
+    }
+
+   private:
+    template <typename U>
+    friend class ArenaAllocator;
+
+    Arena* arena_;
+  };
+
+ public:
+  /** The pending change to a single key. */
+  struct Change {
+    /** The new value of the key, if it's not deleted. */
+    absl::string_view value;
+    /** True if the key is to be deleted. */
+    bool deleted;
+  };
+
+  using Changes =
+      std::map<absl::string_view,
+               Change,
+               std::less<absl::string_view>,
+               ArenaAllocator<std::pair<const absl::string_view, Change>>>;
+  using const_iterator = Changes::const_iterator;
+
+  LevelDbWriteBuffer() : changes_{Changes::allocator_type{&arena_}} {
+  }
+
+  LevelDbWriteBuffer(const LevelDbWriteBuffer&) = delete;
+  LevelDbWriteBuffer& operator=(const LevelDbWriteBuffer&) = delete;
+
+  /** Schedules `key` to be set to `value`. */
+  void Put(absl::string_view key, absl::string_view value);
+
+  /** Schedules `key` to be deleted. */
+  void Delete(absl::string_view key);
+
+  /** Returns the pending change to `key`, or end() if there is none. */
+  const_iterator find(absl::string_view key) const {
+    return changes_.find(key);
+  }
+
+  /**
+   * Returns the first pending change to a key not less than `key`, or end()
+   * if there is none.
+   */
+  const_iterator lower_bound(absl::string_view key) const {
+    return changes_.lower_bound(key);
+  }
+
+  const_iterator begin() const {
+    return changes_.begin();
+  }
+
+  const_iterator end() const {
+    return changes_.end();
+  }
+
+  /** Returns the number of keys with pending changes. */
+  size_t size() const {
+    return changes_.size();
+  }
+
+  /** Returns the number of bytes the buffer has copied keys and values into. */
+  size_t arena_bytes() const {
+    return arena_bytes_;
+  }
+
+  /** Adds all of the pending changes, in key order, to the given batch. */
+  void AppendTo(leveldb::WriteBatch* batch) const;
+
+ private:
+  /** Returns a copy of `bytes` in the arena. */
+  absl::string_view Copy(absl::string_view bytes);
+
+  /**
+   * Returns the entry for `key`, adding one with a copy of the key if there
+   * is none.
+   */
+  Change& Entry(absl::string_view key);
+
+  // The arena is declared first so that it outlives the map's nodes.
+  Arena arena_;
+  size_t arena_bytes_ = 0;
+  Changes changes_;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_LOCAL_LEVELDB_WRITE_BUFFER_H_
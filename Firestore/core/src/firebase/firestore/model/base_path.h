@@ -19,13 +19,17 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstddef>
 #include <initializer_list>
+#include <iterator>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "Firestore/core/src/firebase/firestore/model/shared_segments.h"
 #include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
 #include "Firestore/core/src/firebase/firestore/util/hashing.h"
+#include "absl/strings/string_view.h"
 
 namespace firebase {
 namespace firestore {
@@ -39,6 +43,13 @@ namespace impl {
  * BasePath is reassignable and movable. Apart from those, all other mutating
  * operations return new independent instances.
  *
+ * The last segment is stored inline, and the segments before it in a
+ * SharedSegments list that copies of the path share. A derived class whose
+ * paths often have the same parent (e.g. documents in a collection) can have
+ * paths built on the same thread share one list by returning true from
+ * SharesParents(); equal paths are then equal after comparing only their last
+ * segments. Every derived class must declare SharesParents().
+ *
  * ## Subclassing Notes
  *
  * BasePath is strictly meant as a base class for concrete implementations. It
@@ -53,37 +64,123 @@ class BasePath {
   using SegmentsT = std::vector<std::string>;
 
  public:
-  using const_iterator = SegmentsT::const_iterator;
+  /** A random-access iterator over the segments of a path. */
+  class const_iterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::string;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::string*;
+    using reference = const std::string&;
+
+    const_iterator() = default;
+
+    reference operator*() const {
+      return path_->segment(index_);
+    }
+    pointer operator->() const {
+      return &path_->segment(index_);
+    }
+    reference operator[](difference_type n) const {
+      return path_->segment(index_ + n);
+    }
+
+    const_iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator result = *this;
+      ++index_;
+      return result;
+    }
+    const_iterator& operator--() {
+      --index_;
+      return *this;
+    }
+    const_iterator operator--(int) {
+      const_iterator result = *this;
+      --index_;
+      return result;
+    }
+    const_iterator& operator+=(difference_type n) {
+      index_ += n;
+      return *this;
+    }
+    const_iterator& operator-=(difference_type n) {
+      index_ -= n;
+      return *this;
+    }
+    const_iterator operator+(difference_type n) const {
+      return const_iterator{path_, index_ + n};
+    }
+    const_iterator operator-(difference_type n) const {
+      return const_iterator{path_, index_ - n};
+    }
+    difference_type operator-(const const_iterator& rhs) const {
+      return static_cast<difference_type>(index_) -
+             static_cast<difference_type>(rhs.index_);
+    }
+
+    bool operator==(const const_iterator& rhs) const {
+      return index_ == rhs.index_;
+    }
+    bool operator!=(const const_iterator& rhs) const {
+      return index_ != rhs.index_;
+    }
+    bool operator<(const const_iterator& rhs) const {
+      return index_ < rhs.index_;
+    }
+    bool operator>(const const_iterator& rhs) const {
+      return index_ > rhs.index_;
+    }
+    bool operator<=(const const_iterator& rhs) const {
+      return index_ <= rhs.index_;
+    }
+    bool operator>=(const const_iterator& rhs) const {
+      return index_ >= rhs.index_;
+    }
+
+   private:
+    friend class BasePath;
+
+    const_iterator(const BasePath* path, size_t index)
+        : path_{path}, index_{index} {
+    }
+
+    const BasePath* path_ = nullptr;
+    size_t index_ = 0;
+  };
 
   /** Returns i-th segment of the path. */
   const std::string& operator[](const size_t i) const {
-    HARD_ASSERT(i < segments_.size(), "index %s out of range", i);
-    return segments_[i];
+    HARD_ASSERT(i < size_, "index %s out of range", i);
+    return segment(i);
   }
 
   /** Returns the first segment of the path. */
   const std::string& first_segment() const {
     HARD_ASSERT(!empty(), "Cannot call first_segment on empty path");
-    return segments_[0];
+    return segment(0);
   }
   /** Returns the last segment of the path. */
   const std::string& last_segment() const {
     HARD_ASSERT(!empty(), "Cannot call last_segment on empty path");
-    return segments_[size() - 1];
+    return last_;
   }
 
   size_t size() const {
-    return segments_.size();
+    return size_;
   }
   bool empty() const {
-    return segments_.empty();
+    return size_ == 0;
   }
 
   const_iterator begin() const {
-    return segments_.begin();
+    return const_iterator{this, 0};
   }
   const_iterator end() const {
-    return segments_.end();
+    return const_iterator{this, size_};
   }
 
   /**
@@ -91,14 +188,14 @@ class BasePath {
    * additional segment.
    */
   T Append(const std::string& segment) const {
-    auto appended = segments_;
-    appended.push_back(segment);
-    return T{std::move(appended)};
+    return Append(std::string{segment});
   }
   T Append(std::string&& segment) const {
-    auto appended = segments_;
-    appended.push_back(std::move(segment));
-    return T{std::move(appended)};
+    T result;
+    result.parent_ = MakeParent(begin(), end());
+    result.last_ = std::move(segment);
+    result.size_ = size_ + 1;
+    return result;
   }
 
   /**
@@ -106,7 +203,7 @@ class BasePath {
    * another path.
    */
   T Append(const T& path) const {
-    auto appended = segments_;
+    SegmentsT appended{begin(), end()};
     appended.insert(appended.end(), path.begin(), path.end());
     return T{std::move(appended)};
   }
@@ -149,37 +246,112 @@ class BasePath {
            std::equal(begin(), end(), potential_child.begin());
   }
 
+  /** Returns a hash of the segments that's consistent with operator==. */
+  size_t Hash() const {
+    return util::Hash(parent_.hash(), last_);
+  }
+
   bool operator==(const BasePath& rhs) const {
-    return segments_ == rhs.segments_;
+    if (size_ != rhs.size_ || last_ != rhs.last_) return false;
+    return parent_.SameAs(rhs.parent_) ||
+           std::equal(begin(), end() - 1, rhs.begin());
   }
   bool operator!=(const BasePath& rhs) const {
-    return segments_ != rhs.segments_;
+    return !(*this == rhs);
   }
   bool operator<(const BasePath& rhs) const {
-    return segments_ < rhs.segments_;
+    if (size_ == rhs.size_ && parent_.SameAs(rhs.parent_)) {
+      return last_ < rhs.last_;
+    }
+    return std::lexicographical_compare(begin(), end(), rhs.begin(),
+                                        rhs.end());
   }
   bool operator>(const BasePath& rhs) const {
-    return segments_ > rhs.segments_;
+    return rhs < *this;
   }
   bool operator<=(const BasePath& rhs) const {
-    return segments_ <= rhs.segments_;
+    return !(rhs < *this);
   }
   bool operator>=(const BasePath& rhs) const {
-    return segments_ >= rhs.segments_;
+    return !(*this < rhs);
   }
 
  protected:
   BasePath() = default;
+  BasePath(const BasePath& other) = default;
+  /** Leaves `other` empty, like a moved-from vector of segments. */
+  BasePath(BasePath&& other) noexcept
+      : parent_{std::move(other.parent_)},
+        last_{std::move(other.last_)},
+        size_{other.size_} {
+    other.size_ = 0;
+  }
+  BasePath& operator=(const BasePath& other) = default;
+  BasePath& operator=(BasePath&& other) noexcept {
+    parent_ = std::move(other.parent_);
+    last_ = std::move(other.last_);
+    size_ = other.size_;
+    other.size_ = 0;
+    return *this;
+  }
   template <typename IterT>
-  BasePath(const IterT begin, const IterT end) : segments_{begin, end} {
+  BasePath(const IterT begin, const IterT end) {
+    Assign(begin, end);
   }
-  BasePath(std::initializer_list<std::string> list) : segments_{list} {
+  BasePath(std::initializer_list<std::string> list) {
+    Assign(list.begin(), list.end());
   }
-  explicit BasePath(SegmentsT&& segments) : segments_{std::move(segments)} {
+  explicit BasePath(SegmentsT&& segments) {
+    if (segments.empty()) return;
+    parent_ = MakeParent(segments.begin(), segments.end() - 1);
+    last_ = std::move(segments.back());
+    size_ = segments.size();
+  }
+  /**
+   * Constructs the path from the segments before the last, in
+   * [parent_begin, parent_end), and the last segment.
+   */
+  template <typename IterT>
+  BasePath(const IterT parent_begin,
+           const IterT parent_end,
+           absl::string_view last_segment)
+      : parent_{MakeParent(parent_begin, parent_end)},
+        last_{last_segment.data(), last_segment.size()},
+        size_{parent_.size() + 1} {
   }
 
  private:
-  SegmentsT segments_;
+  const std::string& segment(size_t i) const {
+    return i + 1 < size_ ? parent_[i] : last_;
+  }
+
+  template <typename IterT>
+  static SharedSegments MakeParent(const IterT begin, const IterT end) {
+    return T::SharesParents() ? SharedSegments::Find(begin, end)
+                              : SharedSegments::Copy(begin, end);
+  }
+
+  /**
+   * Stores the segments in [begin, end). IterT must be at least a forward
+   * iterator, since the segments before the last are traversed again.
+   */
+  template <typename IterT>
+  void Assign(const IterT begin, const IterT end) {
+    if (begin == end) return;
+
+    IterT last = begin;
+    for (IterT next = std::next(begin); next != end; ++next) {
+      last = next;
+    }
+    parent_ = MakeParent(begin, last);
+    absl::string_view last_segment = *last;
+    last_.assign(last_segment.data(), last_segment.size());
+    size_ = parent_.size() + 1;
+  }
+
+  SharedSegments parent_;
+  std::string last_;
+  size_t size_ = 0;
 };
 
 }  // namespace impl
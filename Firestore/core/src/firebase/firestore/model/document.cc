@@ -19,6 +19,7 @@
 #include <utility>
 
 #include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
+#include "Firestore/core/src/firebase/firestore/util/hashing.h"
 
 namespace firebase {
 namespace firestore {
@@ -42,7 +43,20 @@ bool Document::Equals(const MaybeDocument& other) const {
   auto& other_doc = static_cast<const Document&>(other);
   return MaybeDocument::Equals(other) &&
          has_local_mutations_ == other_doc.has_local_mutations_ &&
-         data_ == other_doc.data_;
+         DataEquals(other_doc);
+}
+
+size_t Document::Hash() const {
+  const Timestamp& timestamp = version().timestamp();
+  return util::Hash(key().path(), timestamp.seconds(), timestamp.nanoseconds(),
+                    data_.Hash());
+}
+
+bool Document::DataEquals(const Document& other) const {
+  // Documents are often compared repeatedly, e.g. when diffing views, so it
+  // pays to compute and cache the hash of their data: afterwards a mismatch is
+  // rejected without walking the data.
+  return data_.Hash() == other.data_.Hash() && data_ == other.data_;
 }
 
 }  // namespace model
@@ -17,6 +17,8 @@
 #ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_MODEL_DOCUMENT_H_
 #define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_MODEL_DOCUMENT_H_
 
+#include <cstddef>
+
 #include "Firestore/core/src/firebase/firestore/model/field_path.h"
 #include "Firestore/core/src/firebase/firestore/model/field_value.h"
 #include "Firestore/core/src/firebase/firestore/model/maybe_document.h"
@@ -52,6 +54,18 @@ class Document : public MaybeDocument {
     return has_local_mutations_;
   }
 
+  /**
+   * Returns a hash of this document's key, version and data. The hash of the
+   * data is computed once and cached.
+   */
+  size_t Hash() const;
+
+  /**
+   * Returns true if this document's data equals the other's. This compares
+   * the cached hashes of the data first, rejecting most mismatches in O(1).
+   */
+  bool DataEquals(const Document& other) const;
+
  protected:
   bool Equals(const MaybeDocument& other) const override;
 
@@ -64,7 +78,7 @@ class Document : public MaybeDocument {
 inline bool operator==(const Document& lhs, const Document& rhs) {
   return lhs.version() == rhs.version() && lhs.key() == rhs.key() &&
          lhs.has_local_mutations() == rhs.has_local_mutations() &&
-         lhs.data() == rhs.data();
+         lhs.DataEquals(rhs);
 }
 
 inline bool operator!=(const Document& lhs, const Document& rhs) {
@@ -33,14 +33,27 @@ void AssertValidPath(const ResourcePath& path) {
 
 }  // namespace
 
+DocumentKey::Rep::Rep(ResourcePath&& resource_path)
+    : path{std::move(resource_path)}, hash{util::Hash(path)} {
+}
+
 DocumentKey::DocumentKey(const ResourcePath& path)
-    : path_{std::make_shared<ResourcePath>(path)} {
-  AssertValidPath(*path_);
+    : rep_{std::make_shared<Rep>(ResourcePath{path})} {
+  AssertValidPath(rep_->path);
 }
 
 DocumentKey::DocumentKey(ResourcePath&& path)
-    : path_{std::make_shared<ResourcePath>(std::move(path))} {
-  AssertValidPath(*path_);
+    : rep_{std::make_shared<Rep>(std::move(path))} {
+  AssertValidPath(rep_->path);
+}
+
+const std::string& DocumentKey::ToString() const {
+  if (!rep_) return Empty().ToString();
+
+  std::call_once(rep_->canonical_string_once, [this] {
+    rep_->canonical_string = rep_->path.CanonicalString();
+  });
+  return rep_->canonical_string;
 }
 
 const DocumentKey& DocumentKey::Empty() {
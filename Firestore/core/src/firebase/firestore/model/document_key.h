@@ -17,9 +17,11 @@
 #ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_MODEL_DOCUMENT_KEY_H_
 #define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_MODEL_DOCUMENT_KEY_H_
 
+#include <cstddef>
 #include <functional>
 #include <initializer_list>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <string>
 
 #if defined(__OBJC__)
@@ -41,7 +43,7 @@ namespace model {
 class DocumentKey {
  public:
   /** Creates a "blank" document key not associated with any document. */
-  DocumentKey() : path_{std::make_shared<ResourcePath>()} {
+  DocumentKey() : rep_{std::make_shared<Rep>(ResourcePath{})} {
   }
 
   /** Creates a new document key containing a copy of the given path. */
@@ -52,22 +54,25 @@ class DocumentKey {
 
 #if defined(__OBJC__)
   DocumentKey(FSTDocumentKey* key)  // NOLINT(runtime/explicit)
-      : path_(std::make_shared<ResourcePath>(key.path)) {
+      : rep_(std::make_shared<Rep>(ResourcePath{key.path})) {
   }
 
   operator FSTDocumentKey*() const {
     return [FSTDocumentKey keyWithDocumentKey:*this];
   }
-
-  NSUInteger Hash() const {
-    return util::Hash(ToString());
-  }
 #endif
 
-  std::string ToString() const {
-    return path().CanonicalString();
+  /** Returns the hash of the path, computed once when the key was created. */
+  size_t Hash() const {
+    return rep_ ? rep_->hash : Empty().Hash();
   }
 
+  /**
+   * Returns the canonical string of the path, computed the first time it's
+   * needed and then shared by all copies of this key.
+   */
+  const std::string& ToString() const;
+
   /**
    * Creates and returns a new document key using '/' to split the string into
    * segments.
@@ -91,20 +96,31 @@ class DocumentKey {
 
   /** The path to the document. */
   const ResourcePath& path() const {
-    return path_ ? *path_ : Empty().path();
+    return rep_ ? rep_->path : Empty().path();
   }
 
  private:
+  /** The path of a DocumentKey and the values derived from it. */
+  struct Rep {
+    explicit Rep(ResourcePath&& resource_path);
+
+    const ResourcePath path;
+    const size_t hash;
+
+    mutable std::once_flag canonical_string_once;
+    mutable std::string canonical_string;
+  };
+
   // This is an optimization to make passing DocumentKey around cheaper (it's
   // copied often).
-  std::shared_ptr<const ResourcePath> path_;
+  std::shared_ptr<const Rep> rep_;
 };
 
 inline bool operator==(const DocumentKey& lhs, const DocumentKey& rhs) {
-  return lhs.path() == rhs.path();
+  return lhs.Hash() == rhs.Hash() && lhs.path() == rhs.path();
 }
 inline bool operator!=(const DocumentKey& lhs, const DocumentKey& rhs) {
-  return lhs.path() != rhs.path();
+  return !(lhs == rhs);
 }
 inline bool operator<(const DocumentKey& lhs, const DocumentKey& rhs) {
   return lhs.path() < rhs.path();
@@ -121,7 +137,7 @@ inline bool operator>=(const DocumentKey& lhs, const DocumentKey& rhs) {
 
 struct DocumentKeyHash {
   size_t operator()(const DocumentKey& key) const {
-    return util::Hash(key.path());
+    return key.Hash();
   }
 };
 
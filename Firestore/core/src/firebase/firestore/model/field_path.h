@@ -67,6 +67,14 @@ class FieldPath : public impl::BasePath<FieldPath> {
   /** True if this FieldPath represents a document key. */
   bool IsKeyFieldPath() const;
 
+  /**
+   * Field paths are short and rarely built in bulk under one parent, so each
+   * keeps its own.
+   */
+  static constexpr bool SharesParents() {
+    return false;
+  }
+
   bool operator==(const FieldPath& rhs) const {
     return BasePath::operator==(rhs);
   }
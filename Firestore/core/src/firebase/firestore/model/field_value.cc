@@ -18,14 +18,15 @@
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "Firestore/core/src/firebase/firestore/util/comparison.h"
 #include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
-
-using firebase::firestore::util::Comparator;
+#include "Firestore/core/src/firebase/firestore/util/hashing.h"
 
 namespace firebase {
 namespace firestore {
@@ -36,17 +37,58 @@ using firebase::firestore::util::ComparisonResult;
 
 namespace {
 
-// Makes a copy excluding the specified child, which is expected to be assigned
-// different value afterwards.
-ObjectValue::Map CopyExcept(const ObjectValue::Map& object_map,
-                            const std::string exclude) {
-  ObjectValue::Map copy;
-  for (const auto& kv : object_map) {
-    if (kv.first != exclude) {
-      copy[kv.first] = kv.second;
+ComparisonResult CompareSizes(size_t lhs, size_t rhs) {
+  return util::Compare(lhs, rhs, std::less<size_t>());
+}
+
+ComparisonResult CompareStrings(const std::string& lhs,
+                                const std::string& rhs) {
+  int result = lhs.compare(rhs);
+  if (result < 0) {
+    return ComparisonResult::Ascending;
+  } else if (result > 0) {
+    return ComparisonResult::Descending;
+  } else {
+    return ComparisonResult::Same;
+  }
+}
+
+ComparisonResult CompareArrays(const std::vector<FieldValue>& lhs,
+                               const std::vector<FieldValue>& rhs) {
+  size_t common = std::min(lhs.size(), rhs.size());
+  for (size_t i = 0; i < common; i++) {
+    ComparisonResult result = lhs[i].CompareTo(rhs[i]);
+    if (result != ComparisonResult::Same) {
+      return result;
     }
   }
-  return copy;
+  return CompareSizes(lhs.size(), rhs.size());
+}
+
+/**
+ * Hashes a double consistently with Comparator<double> and CompareMixedNumber:
+ * doubles holding an integral value hash like the equivalent int64_t, so that
+ * -0.0, 0.0 and IntegerValue(0) all hash the same, and all NaNs hash the same.
+ */
+size_t HashDouble(double value) {
+  // The range of doubles that can be converted to int64_t without overflow.
+  // 2^63 is exactly representable as a double; int64_t max is not.
+  constexpr double kMinInt64 = -9223372036854775808.0;
+  constexpr double kMaxInt64Exclusive = 9223372036854775808.0;
+  if (value >= kMinInt64 && value < kMaxInt64Exclusive &&
+      std::trunc(value) == value) {
+    return util::Hash(static_cast<int64_t>(value));
+  }
+  return util::DoubleBitwiseHash(value);
+}
+
+bool ArraysEqual(const std::vector<FieldValue>& lhs,
+                 const std::vector<FieldValue>& rhs) {
+  return lhs.size() == rhs.size() &&
+         std::equal(lhs.begin(), lhs.end(), rhs.begin(),
+                    [](const FieldValue& left, const FieldValue& right) {
+                      return left.Equals(right);
+                    });
 }
 
 }  // namespace
@@ -86,64 +128,66 @@ FieldValue& FieldValue::operator=(const FieldValue& value) {
     case Type::String:
       string_value_ = value.string_value_;
       break;
-    case Type::Blob: {
-      // copy-and-swap
-      std::vector<uint8_t> tmp = value.blob_value_;
-      std::swap(blob_value_, tmp);
+    case Type::Blob:
+      // Blobs are immutable once created, so copies share the bytes.
+      blob_value_ = value.blob_value_;
       break;
-    }
     case Type::Reference:
       reference_value_ = value.reference_value_;
       break;
     case Type::GeoPoint:
       geo_point_value_ = value.geo_point_value_;
       break;
-    case Type::Array: {
-      // copy-and-swap
-      std::vector<FieldValue> tmp = value.array_value_;
-      std::swap(array_value_, tmp);
+    case Type::Array:
+      // Arrays are immutable once created, so copies share the elements.
+      array_value_ = value.array_value_;
       break;
-    }
-    case Type::Object: {
-      // copy-and-swap
-      ObjectValue::Map tmp = value.object_value_.internal_value;
-      std::swap(object_value_.internal_value, tmp);
+    case Type::Object:
+      // Copying an immutable map only shares its contents.
+      object_value_ = value.object_value_;
       break;
-    }
     default:
       HARD_FAIL("Unsupported type %s", value.type());
   }
+  hash_.store(value.hash_.load(std::memory_order_relaxed),
+              std::memory_order_relaxed);
   return *this;
 }
 
 FieldValue& FieldValue::operator=(FieldValue&& value) {
+  hash_.store(value.hash_.load(std::memory_order_relaxed),
+              std::memory_order_relaxed);
   switch (value.tag_) {
     case Type::String:
       SwitchTo(Type::String);
       string_value_.swap(value.string_value_);
-      return *this;
+      break;
     case Type::Blob:
       SwitchTo(Type::Blob);
       std::swap(blob_value_, value.blob_value_);
-      return *this;
+      break;
     case Type::Reference:
       SwitchTo(Type::Reference);
       std::swap(reference_value_.reference, value.reference_value_.reference);
       reference_value_.database_id = value.reference_value_.database_id;
-      return *this;
+      break;
     case Type::Array:
       SwitchTo(Type::Array);
       std::swap(array_value_, value.array_value_);
-      return *this;
+      break;
     case Type::Object:
       SwitchTo(Type::Object);
       std::swap(object_value_, value.object_value_);
-      return *this;
+      break;
     default:
       // We just copy over POD union types.
       *this = value;
       return *this;
   }
+  // The moved-from value now holds a different payload, so whatever hash it
+  // had cached no longer describes it.
+  value.hash_.store(0, std::memory_order_relaxed);
+  return *this;
 }
 
 bool FieldValue::Comparable(Type lhs, Type rhs) {
@@ -165,25 +209,22 @@ FieldValue FieldValue::Set(const FieldPath& field_path,
               "Cannot set field for non-object FieldValue");
   HARD_ASSERT(!field_path.empty(),
               "Cannot set field for empty path on FieldValue");
-  // Set the value by recursively calling on child object.
+  // Set the value by recursively calling on child object. Only the objects
+  // along the path are rebuilt; all other fields are shared with this value.
   const std::string& child_name = field_path.first_segment();
   const ObjectValue::Map& object_map = object_value_.internal_value;
   if (field_path.size() == 1) {
-    // TODO(zxu): Once immutable type is available, rewrite these.
-    ObjectValue::Map copy = CopyExcept(object_map, child_name);
-    copy[child_name] = std::move(value);
-    return FieldValue::ObjectValueFromMap(std::move(copy));
+    return FieldValue::ObjectValueFromMap(object_map.insert(child_name, value));
   } else {
-    ObjectValue::Map copy = CopyExcept(object_map, child_name);
+    FieldValue child;
     const auto iter = object_map.find(child_name);
     if (iter == object_map.end() || iter->second.type() != Type::Object) {
-      copy[child_name] = FieldValue::ObjectValueFromMap({}).Set(
-          field_path.PopFirst(), std::move(value));
+      child = FieldValue::ObjectValueFromMap(ObjectValue::Map{})
+                  .Set(field_path.PopFirst(), std::move(value));
     } else {
-      copy[child_name] =
-          iter->second.Set(field_path.PopFirst(), std::move(value));
+      child = iter->second.Set(field_path.PopFirst(), std::move(value));
     }
-    return FieldValue::ObjectValueFromMap(std::move(copy));
+    return FieldValue::ObjectValueFromMap(object_map.insert(child_name, child));
   }
 }
 
@@ -196,9 +237,7 @@ FieldValue FieldValue::Delete(const FieldPath& field_path) const {
   const std::string& child_name = field_path.first_segment();
   const ObjectValue::Map& object_map = object_value_.internal_value;
   if (field_path.size() == 1) {
-    // TODO(zxu): Once immutable type is available, rewrite these.
-    ObjectValue::Map copy = CopyExcept(object_map, child_name);
-    return FieldValue::ObjectValueFromMap(std::move(copy));
+    return FieldValue::ObjectValueFromMap(object_map.erase(child_name));
   } else {
     const auto iter = object_map.find(child_name);
     if (iter == object_map.end() || iter->second.type() != Type::Object) {
@@ -207,10 +246,8 @@ FieldValue FieldValue::Delete(const FieldPath& field_path) const {
       // an object for a delete.
       return *this;
     } else {
-      ObjectValue::Map copy = CopyExcept(object_map, child_name);
-      copy[child_name] =
-          object_map.at(child_name).Delete(field_path.PopFirst());
-      return FieldValue::ObjectValueFromMap(std::move(copy));
+      return FieldValue::ObjectValueFromMap(object_map.insert(
+          child_name, iter->second.Delete(field_path.PopFirst())));
     }
   }
 }
@@ -316,8 +353,8 @@ FieldValue FieldValue::StringValue(std::string&& value) {
 FieldValue FieldValue::BlobValue(const uint8_t* source, size_t size) {
   FieldValue result;
   result.SwitchTo(Type::Blob);
-  std::vector<uint8_t> copy(source, source + size);
-  std::swap(result.blob_value_, copy);
+  result.blob_value_ =
+      std::make_shared<const std::vector<uint8_t>>(source, source + size);
   return result;
 }
 
@@ -356,83 +393,236 @@ FieldValue FieldValue::ArrayValue(const std::vector<FieldValue>& value) {
 FieldValue FieldValue::ArrayValue(std::vector<FieldValue>&& value) {
   FieldValue result;
   result.SwitchTo(Type::Array);
-  std::swap(result.array_value_, value);
+  result.array_value_ =
+      std::make_shared<const std::vector<FieldValue>>(std::move(value));
   return result;
 }
 
 FieldValue FieldValue::ObjectValueFromMap(const ObjectValue::Map& value) {
-  ObjectValue::Map copy(value);
-  return ObjectValueFromMap(std::move(copy));
+  FieldValue result;
+  result.SwitchTo(Type::Object);
+  result.object_value_.internal_value = value;
+  return result;
 }
 
 FieldValue FieldValue::ObjectValueFromMap(ObjectValue::Map&& value) {
   FieldValue result;
   result.SwitchTo(Type::Object);
-  std::swap(result.object_value_.internal_value, value);
+  result.object_value_.internal_value = std::move(value);
   return result;
 }
 
-bool operator<(const FieldValue& lhs, const FieldValue& rhs) {
-  if (!FieldValue::Comparable(lhs.type(), rhs.type())) {
-    return lhs.type() < rhs.type();
+ComparisonResult FieldValue::CompareTo(const FieldValue& rhs) const {
+  if (!Comparable(type(), rhs.type())) {
+    return util::Compare(type(), rhs.type(), std::less<Type>());
   }
 
-  switch (lhs.type()) {
+  switch (type()) {
     case Type::Null:
-      return false;
+      return ComparisonResult::Same;
     case Type::Boolean:
-      return Comparator<bool>()(lhs.boolean_value_, rhs.boolean_value_);
+      return util::Compare<bool>(boolean_value_, rhs.boolean_value_);
     case Type::Integer:
       if (rhs.type() == Type::Integer) {
-        return Comparator<int64_t>()(lhs.integer_value_, rhs.integer_value_);
+        return util::Compare<int64_t>(integer_value_, rhs.integer_value_);
       } else {
-        return util::CompareMixedNumber(rhs.double_value_,
-                                        lhs.integer_value_) ==
-               ComparisonResult::Descending;
+        return util::ReverseOrder(
+            util::CompareMixedNumber(rhs.double_value_, integer_value_));
       }
     case Type::Double:
       if (rhs.type() == Type::Double) {
-        return Comparator<double>()(lhs.double_value_, rhs.double_value_);
+        return util::Compare<double>(double_value_, rhs.double_value_);
       } else {
-        return util::CompareMixedNumber(lhs.double_value_,
-                                        rhs.integer_value_) ==
-               ComparisonResult::Ascending;
+        return util::CompareMixedNumber(double_value_, rhs.integer_value_);
       }
     case Type::Timestamp:
       if (rhs.type() == Type::Timestamp) {
-        return lhs.timestamp_value_ < rhs.timestamp_value_;
+        return util::Compare(timestamp_value_, rhs.timestamp_value_,
+                             std::less<Timestamp>());
       } else {
-        return true;
+        return ComparisonResult::Ascending;
       }
     case Type::ServerTimestamp:
       if (rhs.type() == Type::ServerTimestamp) {
-        return lhs.server_timestamp_value_.local_write_time <
-               rhs.server_timestamp_value_.local_write_time;
+        return util::Compare(server_timestamp_value_.local_write_time,
+                             rhs.server_timestamp_value_.local_write_time,
+                             std::less<Timestamp>());
       } else {
-        return false;
+        return ComparisonResult::Descending;
       }
     case Type::String:
-      return lhs.string_value_.compare(rhs.string_value_) < 0;
+      return CompareStrings(string_value_, rhs.string_value_);
     case Type::Blob:
-      return lhs.blob_value_ < rhs.blob_value_;
-    case Type::Reference:
-      return *lhs.reference_value_.database_id <
-                 *rhs.reference_value_.database_id ||
-             (*lhs.reference_value_.database_id ==
-                  *rhs.reference_value_.database_id &&
-              lhs.reference_value_.reference < rhs.reference_value_.reference);
+      if (blob_value_ == rhs.blob_value_) {
+        return ComparisonResult::Same;
+      }
+      return util::Compare<std::vector<uint8_t>>(*blob_value_,
+                                                 *rhs.blob_value_);
+    case Type::Reference: {
+      ComparisonResult result = util::Compare(
+          *reference_value_.database_id, *rhs.reference_value_.database_id,
+          std::less<DatabaseId>());
+      if (result != ComparisonResult::Same) {
+        return result;
+      }
+      return util::Compare(reference_value_.reference,
+                           rhs.reference_value_.reference,
+                           std::less<DocumentKey>());
+    }
     case Type::GeoPoint:
-      return lhs.geo_point_value_ < rhs.geo_point_value_;
+      return util::Compare(geo_point_value_, rhs.geo_point_value_,
+                           std::less<GeoPoint>());
     case Type::Array:
-      return lhs.array_value_ < rhs.array_value_;
+      if (array_value_ == rhs.array_value_) {
+        return ComparisonResult::Same;
+      }
+      return CompareArrays(*array_value_, *rhs.array_value_);
     case Type::Object:
-      return lhs.object_value_ < rhs.object_value_;
+      return object_value_.CompareTo(rhs.object_value_);
     default:
-      HARD_FAIL("Unsupported type %s", lhs.type());
-      // return false if assertion does not abort the program. We will say
+      HARD_FAIL("Unsupported type %s", type());
+      // Return Same if assertion does not abort the program. We will say
       // each unsupported type takes only one value thus everything is equal.
+      return ComparisonResult::Same;
+  }
+}
+
+bool FieldValue::Equals(const FieldValue& rhs) const {
+  if (!Comparable(type(), rhs.type())) {
+    return false;
+  }
+
+  // Values whose hashes have already been computed can be rejected without
+  // examining their contents. Hashes aren't computed here though: doing so
+  // would cost as much as the comparison itself.
+  size_t lhs_hash = hash_.load(std::memory_order_relaxed);
+  size_t rhs_hash = rhs.hash_.load(std::memory_order_relaxed);
+  if (lhs_hash != 0 && rhs_hash != 0 && lhs_hash != rhs_hash) {
+    return false;
+  }
+
+  switch (type()) {
+    case Type::String:
+      return string_value_ == rhs.string_value_;
+    case Type::Blob:
+      return blob_value_ == rhs.blob_value_ ||
+             *blob_value_ == *rhs.blob_value_;
+    case Type::Array:
+      return array_value_ == rhs.array_value_ ||
+             ArraysEqual(*array_value_, *rhs.array_value_);
+    case Type::Object:
+      return object_value_.Equals(rhs.object_value_);
+    default:
+      return CompareTo(rhs) == ComparisonResult::Same;
+  }
+}
+
+size_t FieldValue::Hash() const {
+  size_t hash = hash_.load(std::memory_order_relaxed);
+  if (hash == 0) {
+    hash = ComputeHash();
+    if (hash == 0) {
+      // Zero marks an uncomputed hash, so remap it to some other value.
+      hash = 1;
+    }
+    hash_.store(hash, std::memory_order_relaxed);
+  }
+  return hash;
+}
+
+size_t FieldValue::ComputeHash() const {
+  // Integers and doubles are comparable and may be equal to each other, so
+  // they share a seed. All other types that can be equal share a Type.
+  Type seed = tag_ == Type::Double ? Type::Integer : tag_;
+  size_t result = util::Hash(static_cast<int>(seed));
+
+  switch (tag_) {
+    case Type::Null:
+      return result;
+    case Type::Boolean:
+      return util::Hash(result, boolean_value_);
+    case Type::Integer:
+      // Hashed the same way HashDouble hashes integral doubles.
+      return util::Hash(result, util::Hash(integer_value_));
+    case Type::Double:
+      return util::Hash(result, HashDouble(double_value_));
+    case Type::Timestamp:
+      return util::Hash(result, timestamp_value_.seconds(),
+                        timestamp_value_.nanoseconds());
+    case Type::ServerTimestamp:
+      // Only the local write time participates in comparisons.
+      return util::Hash(
+          result, server_timestamp_value_.local_write_time.seconds(),
+          server_timestamp_value_.local_write_time.nanoseconds());
+    case Type::String:
+      return util::Hash(result, string_value_);
+    case Type::Blob:
+      return util::Hash(result, *blob_value_);
+    case Type::Reference:
+      return util::Hash(result, reference_value_.database_id->project_id(),
+                        reference_value_.database_id->database_id(),
+                        reference_value_.reference.path());
+    case Type::GeoPoint:
+      return util::Hash(result, HashDouble(geo_point_value_.latitude()),
+                        HashDouble(geo_point_value_.longitude()));
+    case Type::Array:
+      for (const FieldValue& element : *array_value_) {
+        result = util::Hash(result, element.Hash());
+      }
+      return util::Hash(result, array_value_->size());
+    case Type::Object:
+      for (const auto& kv : object_value_.internal_value) {
+        result = util::Hash(result, kv.first, kv.second.Hash());
+      }
+      return util::Hash(result, object_value_.internal_value.size());
+    default:
+      HARD_FAIL("Unsupported type %s", tag_);
+      return result;
+  }
+}
+
+ComparisonResult ObjectValue::CompareTo(const ObjectValue& rhs) const {
+  auto lhs_iter = internal_value.begin();
+  auto lhs_end = internal_value.end();
+  auto rhs_iter = rhs.internal_value.begin();
+  auto rhs_end = rhs.internal_value.end();
+  for (; lhs_iter != lhs_end && rhs_iter != rhs_end; ++lhs_iter, ++rhs_iter) {
+    ComparisonResult result = CompareStrings(lhs_iter->first, rhs_iter->first);
+    if (result != ComparisonResult::Same) {
+      return result;
+    }
+    result = lhs_iter->second.CompareTo(rhs_iter->second);
+    if (result != ComparisonResult::Same) {
+      return result;
+    }
+  }
+  return CompareSizes(internal_value.size(), rhs.internal_value.size());
+}
+
+bool ObjectValue::Equals(const ObjectValue& rhs) const {
+  if (internal_value.size() != rhs.internal_value.size()) {
+    return false;
+  }
+  auto rhs_iter = rhs.internal_value.begin();
+  for (const auto& kv : internal_value) {
+    if (kv.first != rhs_iter->first || !kv.second.Equals(rhs_iter->second)) {
       return false;
+    }
+    ++rhs_iter;
   }
+  return true;
+}
+
+const FieldValue::BlobPointer& FieldValue::EmptyBlob() {
+  static const BlobPointer kEmptyBlob =
+      std::make_shared<const std::vector<uint8_t>>();
+  return kEmptyBlob;
+}
+
+const FieldValue::ArrayPointer& FieldValue::EmptyArray() {
+  static const ArrayPointer kEmptyArray =
+      std::make_shared<const std::vector<FieldValue>>();
+  return kEmptyArray;
 }
 
 void FieldValue::SwitchTo(const Type type) {
@@ -452,7 +642,7 @@ void FieldValue::SwitchTo(const Type type) {
       string_value_.~basic_string();
       break;
     case Type::Blob:
-      blob_value_.~vector();
+      blob_value_.~BlobPointer();
       break;
     case Type::Reference:
       reference_value_.~ReferenceValue();
@@ -461,10 +651,10 @@ void FieldValue::SwitchTo(const Type type) {
       geo_point_value_.~GeoPoint();
       break;
     case Type::Array:
-      array_value_.~vector();
+      array_value_.~ArrayPointer();
       break;
     case Type::Object:
-      object_value_.internal_value.~map();
+      object_value_.~ObjectValue();
       break;
     default: {}  // The other types where there is nothing to worry about.
   }
@@ -481,8 +671,8 @@ void FieldValue::SwitchTo(const Type type) {
       new (&string_value_) std::string();
       break;
     case Type::Blob:
-      // Do not even bother to allocate a new array of size 0.
-      new (&blob_value_) std::vector<uint8_t>();
+      // Share a single empty blob rather than allocating a new one.
+      new (&blob_value_) BlobPointer(EmptyBlob());
       break;
     case Type::Reference:
       // Qualified name to avoid conflict with the member function of same name.
@@ -492,7 +682,7 @@ void FieldValue::SwitchTo(const Type type) {
       new (&geo_point_value_) GeoPoint();
       break;
     case Type::Array:
-      new (&array_value_) std::vector<FieldValue>();
+      new (&array_value_) ArrayPointer(EmptyArray());
       break;
     case Type::Object:
       new (&object_value_) ObjectValue{};
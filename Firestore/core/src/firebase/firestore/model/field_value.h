@@ -17,17 +17,20 @@
 #ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_MODEL_FIELD_VALUE_H_
 #define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_MODEL_FIELD_VALUE_H_
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "Firestore/core/include/firebase/firestore/geo_point.h"
 #include "Firestore/core/include/firebase/firestore/timestamp.h"
+#include "Firestore/core/src/firebase/firestore/immutable/sorted_map.h"
 #include "Firestore/core/src/firebase/firestore/model/database_id.h"
 #include "Firestore/core/src/firebase/firestore/model/document_key.h"
 #include "Firestore/core/src/firebase/firestore/model/field_path.h"
+#include "Firestore/core/src/firebase/firestore/util/comparison.h"
 #include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
 #include "absl/types/optional.h"
 
@@ -55,8 +58,21 @@ struct ObjectValue {
   // TODO(rsgowman): These will eventually be private. We do want the serializer
   // to be able to directly access these (possibly implying 'friend' usage, or a
   // getInternalValue() like java has.)
-  using Map = std::map<std::string, FieldValue>;
+  //
+  // Fields are kept in an immutable SortedMap: small objects are a sorted
+  // contiguous array, larger ones a balanced tree, and modified copies share
+  // structure with the original.
+  using Map = immutable::SortedMap<std::string, FieldValue>;
   Map internal_value;
+
+  /**
+   * Performs a three-way comparison with another ObjectValue: fields are
+   * compared in key order, first by key and then by value.
+   */
+  util::ComparisonResult CompareTo(const ObjectValue& rhs) const;
+
+  /** Equivalent to CompareTo(rhs) == Same, but faster. */
+  bool Equals(const ObjectValue& rhs) const;
 };
 
 /**
@@ -196,17 +212,46 @@ class FieldValue {
   static FieldValue ObjectValueFromMap(const ObjectValue::Map& value);
   static FieldValue ObjectValueFromMap(ObjectValue::Map&& value);
 
-  friend bool operator<(const FieldValue& lhs, const FieldValue& rhs);
+  /**
+   * Performs a three-way comparison with another FieldValue according to the
+   * Firestore ordering of values. Values of types that are not Comparable()
+   * are ordered by their Type.
+   */
+  util::ComparisonResult CompareTo(const FieldValue& rhs) const;
+
+  /**
+   * Returns true if this value compares the same as rhs, i.e. equivalent to
+   * CompareTo(rhs) == Same. Values that cannot be equal because of their types
+   * or sizes are rejected without examining their contents.
+   */
+  bool Equals(const FieldValue& rhs) const;
+
+  /**
+   * Returns a hash of this value that is consistent with Equals(): values that
+   * compare the same, such as IntegerValue(1) and DoubleValue(1.0), have the
+   * same hash. The hash is computed on first use and then cached.
+   */
+  size_t Hash() const;
 
  private:
   explicit FieldValue(bool value) : tag_(Type::Boolean), boolean_value_(value) {
   }
 
+  // Blob and array contents are immutable once created, so they are shared
+  // between copies of a FieldValue rather than copied.
+  using BlobPointer = std::shared_ptr<const std::vector<uint8_t>>;
+  using ArrayPointer = std::shared_ptr<const std::vector<FieldValue>>;
+
+  static const BlobPointer& EmptyBlob();
+  static const ArrayPointer& EmptyArray();
+
   /**
    * Switch to the specified type, if different from the current type.
    */
   void SwitchTo(Type type);
 
+  size_t ComputeHash() const;
+
   Type tag_ = Type::Null;
   union {
     // There is no null type as tag_ alone is enough for Null FieldValue.
@@ -216,61 +261,67 @@ class FieldValue {
     Timestamp timestamp_value_;
     ServerTimestamp server_timestamp_value_;
     std::string string_value_;
-    std::vector<uint8_t> blob_value_;
+    BlobPointer blob_value_;
     // Qualified name to avoid conflict with the member function of same name.
     firebase::firestore::model::ReferenceValue reference_value_;
     GeoPoint geo_point_value_;
-    std::vector<FieldValue> array_value_;
+    ArrayPointer array_value_;
     ObjectValue object_value_;
   };
+
+  // The cached result of Hash(), or zero if it has not been computed yet.
+  // FieldValues may be shared between threads, hence the atomic.
+  mutable std::atomic<size_t> hash_{0};
 };
 
 /** Compares against another FieldValue. */
-bool operator<(const FieldValue& lhs, const FieldValue& rhs);
+inline bool operator<(const FieldValue& lhs, const FieldValue& rhs) {
+  return lhs.CompareTo(rhs) == util::ComparisonResult::Ascending;
+}
 
 inline bool operator>(const FieldValue& lhs, const FieldValue& rhs) {
-  return rhs < lhs;
+  return lhs.CompareTo(rhs) == util::ComparisonResult::Descending;
 }
 
 inline bool operator>=(const FieldValue& lhs, const FieldValue& rhs) {
-  return !(lhs < rhs);
+  return lhs.CompareTo(rhs) != util::ComparisonResult::Ascending;
 }
 
 inline bool operator<=(const FieldValue& lhs, const FieldValue& rhs) {
-  return !(lhs > rhs);
+  return lhs.CompareTo(rhs) != util::ComparisonResult::Descending;
 }
 
 inline bool operator!=(const FieldValue& lhs, const FieldValue& rhs) {
-  return lhs < rhs || lhs > rhs;
+  return !lhs.Equals(rhs);
 }
 
 inline bool operator==(const FieldValue& lhs, const FieldValue& rhs) {
-  return !(lhs != rhs);
+  return lhs.Equals(rhs);
 }
 
 /** Compares against another ObjectValue. */
 inline bool operator<(const ObjectValue& lhs, const ObjectValue& rhs) {
-  return lhs.internal_value < rhs.internal_value;
+  return lhs.CompareTo(rhs) == util::ComparisonResult::Ascending;
 }
 
 inline bool operator>(const ObjectValue& lhs, const ObjectValue& rhs) {
-  return rhs < lhs;
+  return lhs.CompareTo(rhs) == util::ComparisonResult::Descending;
 }
 
 inline bool operator>=(const ObjectValue& lhs, const ObjectValue& rhs) {
-  return !(lhs < rhs);
+  return lhs.CompareTo(rhs) != util::ComparisonResult::Ascending;
 }
 
 inline bool operator<=(const ObjectValue& lhs, const ObjectValue& rhs) {
-  return !(lhs > rhs);
+  return lhs.CompareTo(rhs) != util::ComparisonResult::Descending;
 }
 
 inline bool operator!=(const ObjectValue& lhs, const ObjectValue& rhs) {
-  return lhs < rhs || lhs > rhs;
+  return !lhs.Equals(rhs);
 }
 
 inline bool operator==(const ObjectValue& lhs, const ObjectValue& rhs) {
-  return !(lhs != rhs);
+  return lhs.Equals(rhs);
 }
 
 }  // namespace model
@@ -17,30 +17,118 @@
 #include "Firestore/core/src/firebase/firestore/model/resource_path.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
 #include <utility>
-#include <vector>
 
 #include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
 #include "absl/strings/str_join.h"
-#include "absl/strings/str_split.h"
 
 namespace firebase {
 namespace firestore {
 namespace model {
 
+namespace {
+
+/**
+ * Iterates over the non-empty, slash-separated segments of a path string
+ * without copying them.
+ */
+class SegmentIterator {
+ public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = absl::string_view;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const absl::string_view*;
+  using reference = const absl::string_view&;
+
+  /** Creates an iterator at the first segment of `path`. */
+  explicit SegmentIterator(absl::string_view path) : rest_{path} {
+    Next();
+  }
+
+  /** Creates an iterator past the last segment. */
+  SegmentIterator() = default;
+
+  reference operator*() const {
+    return segment_;
+  }
+
+  SegmentIterator& operator++() {
+    Next();
+    return *this;
+  }
+
+  bool operator==(const SegmentIterator& rhs) const {
+    return segment_.data() == rhs.segment_.data();
+  }
+  bool operator!=(const SegmentIterator& rhs) const {
+    return !(*this == rhs);
+  }
+
+ private:
+  void Next() {
+    // Skip empty segments; there may be one at the beginning or end if the
+    // path had a leading or trailing slash (which we allow).
+    while (!rest_.empty() && rest_.front() == '/') {
+      rest_.remove_prefix(1);
+    }
+    if (rest_.empty()) {
+      segment_ = {};
+      return;
+    }
+    size_t length = 1;
+    while (length < rest_.size() && rest_[length] != '/') {
+      length++;
+    }
+    segment_ = rest_.substr(0, length);
+    rest_.remove_prefix(length);
+  }
+
+  absl::string_view rest_;
+  absl::string_view segment_;
+};
+
+/**
+ * Returns true if `path` contains "//". This runs on every path parsed, and
+ * looking for single slashes with memchr is cheaper than a substring search.
+ */
+bool HasDoubleSlash(absl::string_view path) {
+  const char* end = path.data() + path.size();
+  for (const char* slash = path.data(); slash != end; ++slash) {
+    slash = static_cast<const char*>(
+        std::memchr(slash, '/', static_cast<size_t>(end - slash)));
+    if (!slash || slash + 1 == end) return false;
+    if (slash[1] == '/') return true;
+  }
+  return false;
+}
+
+}  // namespace
+
 ResourcePath ResourcePath::FromString(const absl::string_view path) {
   // NOTE: The client is ignorant of any path segments containing escape
   // sequences (e.g. __id123__) and just passes them through raw (they exist
   // for legacy reasons and should not be used frequently).
 
-  HARD_ASSERT(path.find("//") == std::string::npos,
+  HARD_ASSERT(!HasDoubleSlash(path),
               "Invalid path (%s). Paths must not contain // in them.", path);
 
-  // SkipEmpty because we may still have an empty segment at the beginning or
-  // end if they had a leading or trailing slash (which we allow).
-  std::vector<std::string> segments =
-      absl::StrSplit(path, '/', absl::SkipEmpty());
-  return ResourcePath{std::move(segments)};
+  // Split off the last segment, ignoring a trailing slash. The segments before
+  // it are split lazily while looking up the parent.
+  absl::string_view rest = path;
+  if (!rest.empty() && rest.back() == '/') {
+    rest.remove_suffix(1);
+  }
+  if (rest.empty()) return ResourcePath{};
+
+  size_t slash = rest.rfind('/');
+  if (slash == absl::string_view::npos) {
+    return ResourcePath{SegmentIterator{}, SegmentIterator{}, rest};
+  }
+  return ResourcePath{SegmentIterator{rest.substr(0, slash)}, SegmentIterator{},
+                      rest.substr(slash + 1)};
 }
 
 std::string ResourcePath::CanonicalString() const {
@@ -17,6 +17,7 @@
 #ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_MODEL_RESOURCE_PATH_H_
 #define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_MODEL_RESOURCE_PATH_H_
 
+#include <cstddef>
 #include <initializer_list>
 #include <string>
 #include <utility>
@@ -52,6 +53,14 @@ class ResourcePath : public impl::BasePath<ResourcePath> {
   /** Returns a standardized string representation of this path. */
   std::string CanonicalString() const;
 
+  /**
+   * Paths built on the same thread share their parents, since keys are
+   * usually built in bulk from one collection (e.g. query results).
+   */
+  static constexpr bool SharesParents() {
+    return true;
+  }
+
   bool operator==(const ResourcePath& rhs) const {
     return BasePath::operator==(rhs);
   }
@@ -70,6 +79,13 @@ class ResourcePath : public impl::BasePath<ResourcePath> {
   bool operator>=(const ResourcePath& rhs) const {
     return BasePath::operator>=(rhs);
   }
+ private:
+  template <typename IterT>
+  ResourcePath(const IterT parent_begin,
+               const IterT parent_end,
+               absl::string_view last_segment)
+      : BasePath{parent_begin, parent_end, last_segment} {
+  }
 };
 
 }  // namespace model
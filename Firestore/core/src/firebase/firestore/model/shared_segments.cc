@@ -0,0 +1,115 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/firebase/firestore/model/shared_segments.h"
+
+#include <algorithm>
+#include <type_traits>
+
+namespace firebase {
+namespace firestore {
+namespace model {
+namespace impl {
+
+constexpr size_t SharedSegments::kCacheWays;
+
+void SharedSegments::Destroy(Rep* rep) {
+  std::string* segments = rep->segments();
+  for (size_t i = 0; i < rep->size; ++i) {
+    segments[i].~basic_string();
+  }
+  rep->~Rep();
+  ::operator delete(rep);
+}
+
+#if ABSL_HAVE_THREAD_LOCAL
+
+namespace {
+
+constexpr size_t kCacheSets = 64;
+
+}  // namespace
+
+/**
+ * The lists cached by a thread. This is trivially destructible, so it remains
+ * usable throughout thread shutdown, even by the destructors of other
+ * thread_locals that build paths after CacheCleanup has run.
+ */
+struct SharedSegments::Cache {
+  Rep* sets[kCacheSets][kCacheWays];
+  bool cleanup_registered;
+  bool disabled;
+};
+
+/** Releases a thread's cached lists when the thread exits. */
+struct SharedSegments::CacheCleanup {
+  ~CacheCleanup() {
+    Cache& cache = GetCache();
+    for (auto& set : cache.sets) {
+      for (Rep*& slot : set) {
+        if (slot) Release(slot);
+        slot = nullptr;
+      }
+    }
+    // Paths built later in thread shutdown bypass the cache.
+    cache.disabled = true;
+  }
+};
+
+SharedSegments::Cache& SharedSegments::GetCache() {
+  static_assert(std::is_trivially_destructible<Cache>::value,
+                "Cache must outlive every other thread_local");
+
+  static thread_local Cache cache = {{}, false, false};
+  return cache;
+}
+
+SharedSegments::Rep** SharedSegments::CacheSet(size_t hash) {
+  Cache& cache = GetCache();
+  if (cache.disabled) return nullptr;
+  return cache.sets[hash % kCacheSets];
+}
+
+void SharedSegments::Remember(Rep** set, Rep* rep) {
+  Cache& cache = GetCache();
+  if (!cache.cleanup_registered) {
+    // Constructing the cleanup registers its destructor to run at thread
+    // exit, before the cache itself is released.
+    static thread_local CacheCleanup cleanup;
+    (void)cleanup;
+    cache.cleanup_registered = true;
+  }
+  Retain(rep);
+  if (set[kCacheWays - 1]) Release(set[kCacheWays - 1]);
+  std::move_backward(set, set + kCacheWays - 1, set + kCacheWays);
+  set[0] = rep;
+}
+
+#else   // !ABSL_HAVE_THREAD_LOCAL
+
+SharedSegments::Rep** SharedSegments::CacheSet(size_t /* hash */) {
+  return nullptr;
+}
+
+void SharedSegments::Remember(Rep** /* set */, Rep* /* rep */) {
+}
+
+#endif  // ABSL_HAVE_THREAD_LOCAL
+
+}  // namespace impl
+}  // namespace model
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_MODEL_SHARED_SEGMENTS_H_
+#define FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_MODEL_SHARED_SEGMENTS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <string>
+#include <utility>
+
+#include "absl/base/config.h"
+#include "absl/strings/string_view.h"
+
+namespace firebase {
+namespace firestore {
+namespace model {
+namespace impl {
+
+/**
+ * An immutable, reference-counted list of path segments, used by BasePath to
+ * hold every segment but the last one. Copies share the same list.
+ *
+ * Lists made by Find are also kept in a small per-thread cache keyed by their
+ * contents, so that building many paths under the same parent on one thread
+ * (e.g. the keys of documents read from one collection) makes one list rather
+ * than one per path. The cache is two-way set associative: each hash maps to
+ * a set of two lists, and a new list displaces the set's least recently used
+ * one. Lists made by Copy are never cached, and neither is anything when the
+ * platform lacks thread_local.
+ */
+class SharedSegments {
+ public:
+  /** Creates an empty list. */
+  SharedSegments() = default;
+
+  SharedSegments(const SharedSegments& other) : rep_{other.rep_} {
+    if (rep_) Retain(rep_);
+  }
+
+  SharedSegments(SharedSegments&& other) noexcept : rep_{other.rep_} {
+    other.rep_ = nullptr;
+  }
+
+  ~SharedSegments() {
+    if (rep_) Release(rep_);
+  }
+
+  SharedSegments& operator=(SharedSegments other) noexcept {
+    std::swap(rep_, other.rep_);
+    return *this;
+  }
+
+  /** Returns a new list holding copies of the segments in [begin, end). */
+  template <typename IterT>
+  static SharedSegments Copy(IterT begin, IterT end) {
+    return SharedSegments{NewRep(begin, end, Hash(begin, end))};
+  }
+
+  /**
+   * Returns a list holding the segments in [begin, end), reusing the list
+   * made by the last call to Find with the same segments on this thread when
+   * it's still cached.
+   */
+  template <typename IterT>
+  static SharedSegments Find(IterT begin, IterT end) {
+    if (begin == end) return SharedSegments{};
+
+    size_t hash = Hash(begin, end);
+    Rep** set = CacheSet(hash);
+    if (set) {
+      for (size_t i = 0; i < kCacheWays; ++i) {
+        Rep* rep = set[i];
+        if (rep && rep->hash == hash && Matches(rep, begin, end)) {
+          // Keep the most recently used list first.
+          std::swap(set[0], set[i]);
+          Retain(rep);
+          return SharedSegments{rep};
+        }
+      }
+    }
+
+    SharedSegments result{NewRep(begin, end, hash)};
+    if (set) Remember(set, result.rep_);
+    return result;
+  }
+
+  size_t size() const {
+    return rep_ ? rep_->size : 0;
+  }
+
+  /** Returns a hash of the segments, computed when the list was made. */
+  size_t hash() const {
+    return rep_ ? rep_->hash : 0;
+  }
+
+  /** Returns the i-th segment. The index isn't checked. */
+  const std::string& operator[](size_t i) const {
+    return rep_->segments()[i];
+  }
+
+  /**
+   * Returns true if both are the same list, in which case they're equal
+   * without comparing any segments.
+   */
+  bool SameAs(const SharedSegments& other) const {
+    return rep_ == other.rep_;
+  }
+
+ private:
+  /** The header of a block that holds `size` std::strings after it. */
+  struct Rep {
+    std::atomic<int> refs;
+    size_t size;
+    size_t hash;
+
+    std::string* segments() {
+      return reinterpret_cast<std::string*>(this + 1);
+    }
+  };
+
+  static_assert(sizeof(Rep) % alignof(std::string) == 0,
+                "segments must be aligned when they follow Rep");
+
+  explicit SharedSegments(Rep* rep) : rep_{rep} {
+  }
+
+  /**
+   * Hashes the segments eight bytes at a time, mixing in each segment's length
+   * so that {"ab"} and {"a", "b"} differ.
+   */
+  template <typename IterT>
+  static size_t Hash(IterT begin, IterT end) {
+    constexpr uint64_t kMultiplier = 0x9ddfea08eb382d69ULL;
+    uint64_t hash = 0;
+    for (; begin != end; ++begin) {
+      absl::string_view segment = *begin;
+      const char* data = segment.data();
+      size_t remaining = segment.size();
+      for (; remaining >= sizeof(uint64_t); remaining -= sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        hash = (hash ^ word) * kMultiplier;
+        data += sizeof(word);
+      }
+      uint64_t tail = 0;
+      if (remaining > 0) std::memcpy(&tail, data, remaining);
+      hash = (hash ^ tail ^ (uint64_t{segment.size()} << 56)) * kMultiplier;
+    }
+    // The multiplications only carry differences toward the high bits, so
+    // fold those back into the low bits that pick a cache set.
+    hash ^= hash >> 33;
+    hash *= kMultiplier;
+    hash ^= hash >> 29;
+    return static_cast<size_t>(hash);
+  }
+
+  template <typename IterT>
+  static bool Matches(Rep* rep, IterT begin, IterT end) {
+    size_t i = 0;
+    for (; begin != end; ++begin, ++i) {
+      if (i == rep->size || absl::string_view{*begin} != rep->segments()[i]) {
+        return false;
+      }
+    }
+    return i == rep->size;
+  }
+
+  template <typename IterT>
+  static Rep* NewRep(IterT begin, IterT end, size_t hash) {
+    auto size = static_cast<size_t>(std::distance(begin, end));
+    if (size == 0) return nullptr;
+
+    void* block = ::operator new(sizeof(Rep) + size * sizeof(std::string));
+    Rep* rep = new (block) Rep{};
+    rep->size = 0;
+    rep->hash = hash;
+    try {
+      for (std::string* segment = rep->segments(); begin != end; ++begin) {
+        absl::string_view value = *begin;
+        new (segment++) std::string(value.data(), value.size());
+        rep->size++;
+      }
+    } catch (...) {
+      Destroy(rep);
+      throw;
+    }
+    rep->refs.store(1, std::memory_order_relaxed);
+    return rep;
+  }
+
+  static void Retain(Rep* rep) {
+    rep->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static void Release(Rep* rep) {
+    if (rep->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      Destroy(rep);
+    }
+  }
+
+  static void Destroy(Rep* rep);
+
+  static constexpr size_t kCacheWays = 2;
+
+  /**
+   * Returns this thread's set of kCacheWays cached lists for the given hash,
+   * most recently used first, or null if there's no cache.
+   */
+  static Rep** CacheSet(size_t hash);
+
+  /**
+   * Stores the given list first in the set, releasing the least recently
+   * used one.
+   */
+  static void Remember(Rep** set, Rep* rep);
+
+#if ABSL_HAVE_THREAD_LOCAL
+  struct Cache;
+  struct CacheCleanup;
+  static Cache& GetCache();
+#endif  // ABSL_HAVE_THREAD_LOCAL
+
+  Rep* rep_ = nullptr;
+};
+
+}  // namespace impl
+}  // namespace model
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_FIREBASE_FIRESTORE_MODEL_SHARED_SEGMENTS_H_
@@ -116,20 +116,28 @@ int64_t Reader::ReadInteger() {
 }
 
 std::string Reader::ReadString() {
-  if (!status_.ok()) return "";
+  return std::string(ReadStringView());
+}
+
+absl::string_view Reader::ReadStringView() {
+  if (!status_.ok()) return {};
 
   pb_istream_t substream;
   if (!pb_make_string_substream(&stream_, &substream)) {
     status_ = Status(FirestoreErrorCode::DataLoss, PB_GET_ERROR(&stream_));
-    return "";
+    return {};
   }
 
-  std::string result(substream.bytes_left, '\0');
-  if (!pb_read(&substream, reinterpret_cast<pb_byte_t*>(&result[0]),
-               substream.bytes_left)) {
+  // Readers are only ever created by Wrap(), so the stream state is a pointer
+  // to the next unread byte of the underlying buffer. Take a view over the
+  // string's bytes and then skip them (a null destination makes pb_read()
+  // advance the stream without copying).
+  absl::string_view result{static_cast<const char*>(substream.state),
+                           substream.bytes_left};
+  if (!pb_read(&substream, nullptr, substream.bytes_left)) {
     status_ = Status(FirestoreErrorCode::DataLoss, PB_GET_ERROR(&substream));
     pb_close_string_substream(&stream_, &substream);
-    return "";
+    return {};
   }
 
   // NB: future versions of nanopb read the remaining characters out of the
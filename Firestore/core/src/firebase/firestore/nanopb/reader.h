@@ -28,6 +28,7 @@
 #include "Firestore/core/src/firebase/firestore/nanopb/tag.h"
 #include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
 #include "Firestore/core/src/firebase/firestore/util/status.h"
+#include "absl/strings/string_view.h"
 
 namespace firebase {
 namespace firestore {
@@ -82,6 +83,15 @@ class Reader {
 
   std::string ReadString();
 
+  /**
+   * Reads a string (or bytes) field without copying it.
+   *
+   * The returned view refers directly to the bytes this Reader was created
+   * over, so it is only valid for as long as those bytes are. Callers that
+   * need the value beyond that should copy it (or use ReadString()).
+   */
+  absl::string_view ReadStringView();
+
   /**
    * Reads a message and its length.
    *
@@ -16,6 +16,9 @@
 
 #include "Firestore/core/src/firebase/firestore/nanopb/writer.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "Firestore/Protos/nanopb/google/firestore/v1beta1/document.nanopb.h"
 
 namespace firebase {
@@ -27,6 +30,8 @@ using std::int64_t;
 using std::int8_t;
 using std::uint64_t;
 
+constexpr size_t Writer::kMaxPrefixSize;
+
 Writer Writer::Wrap(std::vector<uint8_t>* out_bytes) {
   // TODO(rsgowman): find a better home for this constant.
   // A document is defined to have a max size of 1MiB - 4 bytes.
@@ -51,7 +56,9 @@ Writer Writer::Wrap(std::vector<uint8_t>* out_bytes) {
       /*max_size=*/kMaxDocumentSize,
       /*bytes_written=*/0,
       /*errmsg=*/nullptr};
-  return Writer(raw_stream);
+  Writer writer(raw_stream);
+  writer.out_bytes_ = out_bytes;
+  return writer;
 }
 
 void Writer::WriteTag(Tag tag) {
@@ -109,6 +116,11 @@ void Writer::WriteNestedMessage(
     const std::function<void(Writer*)>& write_message_fn) {
   if (!status_.ok()) return;
 
+  if (out_bytes_ != nullptr) {
+    WriteNestedMessageInPlace(write_message_fn);
+    return;
+  }
+
   // First calculate the message size using a non-writing substream.
   Writer sizer = Writer::Sizing();
   write_message_fn(&sizer);
@@ -158,6 +170,105 @@ void Writer::WriteNestedMessage(
   }
 }
 
+void Writer::WriteNestedMessageInPlace(
+    const std::function<void(Writer*)>& write_message_fn) {
+  // The length of a nested message precedes it, but isn't known until the
+  // message has been written. Reserve room for the longest length this
+  // supports, and leave the gaps for the outermost nested message to close in
+  // a single pass once everything within it has been written. (Widening or
+  // narrowing each prefix as it's written would instead move the rest of its
+  // enclosing message once per level of nesting.)
+  if (stream_.bytes_written >= stream_.max_size) {
+    HARD_FAIL(
+        "Insufficient space in the output stream to write the given message");
+  }
+
+  std::vector<PendingPrefix> outermost_prefixes;
+  bool outermost = pending_prefixes_ == nullptr;
+  std::vector<PendingPrefix>* pending =
+      outermost ? &outermost_prefixes : pending_prefixes_;
+
+  size_t prefix_offset = out_bytes_->size();
+  out_bytes_->resize(prefix_offset + kMaxPrefixSize);
+
+  // Write the message itself through a substream that shares the output
+  // vector, so that any messages nested within it are handled the same way.
+  // bytes_written counts bytes as they'll be once the gaps are closed.
+  Writer writer({stream_.callback, stream_.state,
+                 /*max_size=*/stream_.max_size - stream_.bytes_written - 1,
+                 /*bytes_written=*/0,
+                 /*errmsg=*/nullptr});
+  writer.out_bytes_ = out_bytes_;
+  writer.pending_prefixes_ = pending;
+  write_message_fn(&writer);
+  status_ = writer.status();
+  if (!status_.ok()) {
+    // Drop the partial message, placeholders and all, so that a failed write
+    // doesn't leave bytes behind that aren't a valid encoding.
+    out_bytes_->resize(prefix_offset);
+    pending->erase(std::remove_if(pending->begin(), pending->end(),
+                                  [prefix_offset](const PendingPrefix& prefix) {
+                                    return prefix.offset >= prefix_offset;
+                                  }),
+                   pending->end());
+    return;
+  }
+  size_t size = writer.bytes_written();
+
+  size_t prefix_size = VarintSize(size);
+  if (prefix_size > kMaxPrefixSize ||
+      stream_.bytes_written + prefix_size + size > stream_.max_size) {
+    HARD_FAIL(
+        "Insufficient space in the output stream to write the given message");
+  }
+  stream_.bytes_written += prefix_size + size;
+
+  pending->push_back({prefix_offset, size});
+  if (outermost) {
+    ClosePrefixGaps(out_bytes_, pending);
+  }
+}
+
+size_t Writer::VarintSize(uint64_t value) {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+void Writer::ClosePrefixGaps(std::vector<uint8_t>* out_bytes,
+                             std::vector<PendingPrefix>* prefixes) {
+  // Prefixes are recorded as their messages finish, so inner ones come first.
+  std::sort(prefixes->begin(), prefixes->end(),
+            [](const PendingPrefix& lhs, const PendingPrefix& rhs) {
+              return lhs.offset < rhs.offset;
+            });
+
+  // Slide everything after the first prefix down over the gaps, encoding
+  // each length as it's reached.
+  uint8_t* data = out_bytes->data();
+  size_t read = prefixes->front().offset;
+  size_t write = read;
+  for (const PendingPrefix& prefix : *prefixes) {
+    size_t count = prefix.offset - read;
+    std::memmove(data + write, data + read, count);
+    write += count;
+
+    pb_ostream_t prefix_stream =
+        pb_ostream_from_buffer(data + write, kMaxPrefixSize);
+    if (!pb_encode_varint(&prefix_stream, prefix.size)) {
+      HARD_FAIL(PB_GET_ERROR(&prefix_stream));
+    }
+    write += prefix_stream.bytes_written;
+    read = prefix.offset + kMaxPrefixSize;
+  }
+  size_t count = out_bytes->size() - read;
+  std::memmove(data + write, data + read, count);
+  out_bytes->resize(write + count);
+}
+
 }  // namespace nanopb
 }  // namespace firestore
 }  // namespace firebase
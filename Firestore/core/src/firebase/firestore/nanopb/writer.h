@@ -89,8 +89,18 @@ class Writer {
    * serialization.
    *
    * Call this method when writing a nested message. Provide a function to
-   * write the message itself. This method will calculate the size of the
-   * written message (using the provided function with a non-writing sizing
+   * write the message itself.
+   *
+   * If this Writer was created by Wrap(), the message is serialized directly
+   * into the output vector after a placeholder for its length. Once the
+   * outermost nested message is done, one pass over it fills in every length
+   * and closes up the unused parts of the placeholders. The provided function
+   * is called exactly once, so encoding a value nested N levels deep remains
+   * linear in its size. If the function leaves its Writer with a non-ok
+   * status, the partial message is removed from the output vector.
+   *
+   * Otherwise (e.g. for sizing streams), this method will calculate the size of
+   * the written message (using the provided function with a non-writing sizing
    * stream), write out the size (and perform sanity checks), and then serialize
    * the message by calling the provided function a second time.
    */
@@ -104,6 +114,10 @@ class Writer {
     return status_;
   }
 
+  void set_status(util::Status status) {
+    status_ = status;
+  }
+
  private:
   util::Status status_ = util::Status::OK();
 
@@ -130,7 +144,50 @@ class Writer {
    */
   void WriteVarint(std::uint64_t value);
 
+  /**
+   * The space reserved for the length of a nested message written in place:
+   * enough for a varint of up to 35 bits.
+   */
+  static constexpr size_t kMaxPrefixSize = 5;
+
+  /** A reserved length placeholder in the output vector. */
+  struct PendingPrefix {
+    /** The offset of the placeholder in the vector. */
+    size_t offset;
+    /** The length of the message that follows it. */
+    size_t size;
+  };
+
+  /**
+   * Implements WriteNestedMessage() for Writers that append to a vector by
+   * writing the message once, after a placeholder for its length prefix.
+   */
+  void WriteNestedMessageInPlace(
+      const std::function<void(Writer*)>& write_message_fn);
+
+  /** Returns the number of bytes in the varint encoding of `value`. */
+  static size_t VarintSize(std::uint64_t value);
+
+  /**
+   * Encodes each of the given lengths into its placeholder and moves the
+   * bytes that follow down to close the space left over, all in one pass.
+   */
+  static void ClosePrefixGaps(std::vector<std::uint8_t>* out_bytes,
+                              std::vector<PendingPrefix>* prefixes);
+
   pb_ostream_t stream_;
+
+  /**
+   * The vector that stream_ appends to, if this Writer was created by Wrap().
+   * Otherwise nullptr.
+   */
+  std::vector<std::uint8_t>* out_bytes_ = nullptr;
+
+  /**
+   * While writing nested messages in place, the placeholders written so far
+   * within the outermost one, which owns the vector. Otherwise nullptr.
+   */
+  std::vector<PendingPrefix>* pending_prefixes_ = nullptr;
 };
 
 }  // namespace nanopb
@@ -19,10 +19,13 @@
 #include <pb_decode.h>
 #include <pb_encode.h>
 
+#include <algorithm>
 #include <functional>
+#include <iterator>
 #include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "Firestore/Protos/nanopb/google/firestore/v1beta1/document.nanopb.h"
 #include "Firestore/Protos/nanopb/google/firestore/v1beta1/firestore.nanopb.h"
@@ -36,8 +39,11 @@
 #include "Firestore/core/src/firebase/firestore/nanopb/tag.h"
 #include "Firestore/core/src/firebase/firestore/nanopb/writer.h"
 #include "Firestore/core/src/firebase/firestore/timestamp_internal.h"
+#include "Firestore/core/src/firebase/firestore/util/comparison.h"
 #include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
 
 namespace firebase {
 namespace firestore {
@@ -73,9 +79,16 @@ void EncodeTimestamp(Writer* writer, const Timestamp& timestamp_value) {
                              &timestamp_proto);
 }
 
-ObjectValue::Map::value_type DecodeFieldsEntry(Reader* reader,
-                                               uint32_t key_tag,
-                                               uint32_t value_tag) {
+/**
+ * A decoded entry of a map. The entry is returned by value so that neither the
+ * key nor the (possibly large) value is copied on its way out of the nested
+ * message.
+ */
+using FieldsEntry = std::pair<std::string, FieldValue>;
+
+FieldsEntry DecodeFieldsEntry(Reader* reader,
+                              uint32_t key_tag,
+                              uint32_t value_tag) {
   if (!reader->status().ok()) return {};
 
   Tag tag = reader->ReadTag();
@@ -97,28 +110,57 @@ ObjectValue::Map::value_type DecodeFieldsEntry(Reader* reader,
         return Serializer::DecodeFieldValue(reader);
       });
 
-  return ObjectValue::Map::value_type{key, value};
+  return FieldsEntry{std::move(key), std::move(value)};
 }
 
-ObjectValue::Map::value_type DecodeMapValueFieldsEntry(Reader* reader) {
+FieldsEntry DecodeMapValueFieldsEntry(Reader* reader) {
   return DecodeFieldsEntry(
       reader, google_firestore_v1beta1_MapValue_FieldsEntry_key_tag,
       google_firestore_v1beta1_MapValue_FieldsEntry_value_tag);
 }
 
-ObjectValue::Map::value_type DecodeDocumentFieldsEntry(Reader* reader) {
+FieldsEntry DecodeDocumentFieldsEntry(Reader* reader) {
   return DecodeFieldsEntry(
       reader, google_firestore_v1beta1_Document_FieldsEntry_key_tag,
       google_firestore_v1beta1_Document_FieldsEntry_value_tag);
 }
 
+/**
+ * Builds a map from the decoded entries of a MapValue or Document, moving the
+ * keys and values into place. If a key appears more than once, the last entry
+ * for it wins.
+ */
+ObjectValue::Map MapFromEntries(std::vector<FieldsEntry> entries) {
+  util::Comparator<std::string> key_less;
+  std::stable_sort(entries.begin(), entries.end(),
+                   [&key_less](const FieldsEntry& lhs, const FieldsEntry& rhs) {
+                     return key_less(lhs.first, rhs.first);
+                   });
+
+  // Keep only the last of each run of equal keys.
+  auto kept = entries.begin();
+  for (auto iter = entries.begin(); iter != entries.end(); ++iter) {
+    auto next = std::next(iter);
+    if (next != entries.end() && next->first == iter->first) continue;
+    if (kept != iter) *kept = std::move(*iter);
+    ++kept;
+  }
+  entries.erase(kept, entries.end());
+
+  return ObjectValue::Map::FromSortedRange(
+      std::make_move_iterator(entries.begin()),
+      std::make_move_iterator(entries.end()));
+}
+
 ObjectValue::Map DecodeMapValue(Reader* reader) {
-  ObjectValue::Map result;
-  if (!reader->status().ok()) return result;
+  if (!reader->status().ok()) return {};
 
+  // Entries arrive in whatever order the encoder wrote them, so collect them
+  // and build the map in one pass.
+  std::vector<FieldsEntry> result;
   while (reader->bytes_left()) {
     Tag tag = reader->ReadTag();
-    if (!reader->status().ok()) return result;
+    if (!reader->status().ok()) return MapFromEntries(std::move(result));
     // The MapValue message only has a single valid tag.
     // TODO(rsgowman): figure out error handling: We can do better than a
     // failed assertion.
@@ -126,11 +168,10 @@ ObjectValue::Map DecodeMapValue(Reader* reader) {
                 google_firestore_v1beta1_MapValue_fields_tag);
     HARD_ASSERT(tag.wire_type == PB_WT_STRING);
 
-    ObjectValue::Map::value_type fv =
-        reader->ReadNestedMessage<ObjectValue::Map::value_type>(
-            DecodeMapValueFieldsEntry);
+    FieldsEntry fv =
+        reader->ReadNestedMessage<FieldsEntry>(DecodeMapValueFieldsEntry);
 
-    if (!reader->status().ok()) return result;
+    if (!reader->status().ok()) return MapFromEntries(std::move(result));
 
     // Assumption: If we parse two entries for the map that have the same key,
     // then the latter should overwrite the former. This does not appear to be
@@ -142,9 +183,9 @@ ObjectValue::Map DecodeMapValue(Reader* reader) {
     // https://developers.google.com/protocol-buffers/docs/encoding#optional
 
     // Add this key,fieldvalue to the results map.
-    result[fv.first] = fv.second;
+    result.push_back(std::move(fv));
   }
-  return result;
+  return MapFromEntries(std::move(result));
 }
 
 /**
@@ -169,39 +210,40 @@ std::string EncodeResourceName(const DatabaseId& database_id,
 }
 
 /**
- * Validates that a path has a prefix that looks like a valid encoded
- * databaseId.
+ * Splits a fully qualified resource name into its segments and validates that
+ * there is a project and database encoded in the path. There are no guarantees
+ * that a local path is also encoded in this resource name.
+ *
+ * The segments are views into `encoded`, so nothing is copied.
  */
-bool IsValidResourceName(const ResourcePath& path) {
+std::vector<absl::string_view> DecodeResourceName(absl::string_view encoded) {
+  HARD_ASSERT(encoded.find("//") == absl::string_view::npos,
+              "Invalid path (%s). Paths must not contain // in them.", encoded);
+
+  // SkipEmpty because we may still have an empty segment at the beginning or
+  // end if they had a leading or trailing slash (which we allow).
+  std::vector<absl::string_view> resource =
+      absl::StrSplit(encoded, '/', absl::SkipEmpty());
+
   // Resource names have at least 4 components (project ID, database ID)
   // and commonly the (root) resource type, e.g. documents
-  return path.size() >= 4 && path[0] == "projects" && path[2] == "databases";
-}
-
-/**
- * Decodes a fully qualified resource name into a resource path and validates
- * that there is a project and database encoded in the path. There are no
- * guarantees that a local path is also encoded in this resource name.
- */
-ResourcePath DecodeResourceName(absl::string_view encoded) {
-  ResourcePath resource = ResourcePath::FromString(encoded);
-  HARD_ASSERT(IsValidResourceName(resource),
-              "Tried to deserialize invalid key %s",
-              resource.CanonicalString());
+  HARD_ASSERT(resource.size() >= 4 && resource[0] == "projects" &&
+                  resource[2] == "databases",
+              "Tried to deserialize invalid key %s", encoded);
   return resource;
 }
 
 /**
- * Decodes a fully qualified resource name into a resource path and validates
- * that there is a project and database encoded in the path along with a local
- * path.
+ * Extracts the local path from the segments of a fully qualified resource
+ * name, validating that there is a local path encoded in the name. Only the
+ * segments of the local path are copied.
  */
 ResourcePath ExtractLocalPathFromResourceName(
-    const ResourcePath& resource_name) {
+    const std::vector<absl::string_view>& resource_name) {
   HARD_ASSERT(resource_name.size() > 4 && resource_name[4] == "documents",
               "Tried to deserialize invalid key %s",
-              resource_name.CanonicalString());
-  return resource_name.PopFirst(5);
+              absl::StrJoin(resource_name, "/"));
+  return ResourcePath{resource_name.begin() + 5, resource_name.end()};
 }
 
 }  // namespace
@@ -357,7 +399,7 @@ std::string Serializer::EncodeKey(const DocumentKey& key) const {
 }
 
 DocumentKey Serializer::DecodeKey(absl::string_view name) const {
-  ResourcePath resource = DecodeResourceName(name);
+  std::vector<absl::string_view> resource = DecodeResourceName(name);
   HARD_ASSERT(resource[1] == database_id_.project_id(),
               "Tried to deserialize key from different project.");
   HARD_ASSERT(resource[3] == database_id_.database_id(),
@@ -411,7 +453,8 @@ std::unique_ptr<MaybeDocument> Serializer::DecodeBatchGetDocumentsResponse(
 
   // Initialize BatchGetDocumentsResponse fields to their default values
   std::unique_ptr<MaybeDocument> found;
-  std::string missing;
+  // Refers to the bytes being decoded, which outlive this call.
+  absl::string_view missing;
   // We explicitly ignore the 'transaction' field
   SnapshotVersion read_time = SnapshotVersion::None();
 
@@ -425,7 +468,7 @@ std::unique_ptr<MaybeDocument> Serializer::DecodeBatchGetDocumentsResponse(
         if (!reader->RequireWireType(PB_WT_STRING, tag)) return nullptr;
         // 'found' and 'missing' are part of a oneof. The proto docs claim that
         // if both are set on the wire, the last one wins.
-        missing = "";
+        missing = {};
 
         // TODO(rsgowman): If multiple 'found' values are found, we should merge
         // them (rather than using the last one.)
@@ -441,7 +484,7 @@ std::unique_ptr<MaybeDocument> Serializer::DecodeBatchGetDocumentsResponse(
         // if both are set on the wire, the last one wins.
         found = nullptr;
 
-        missing = reader->ReadString();
+        missing = reader->ReadStringView();
         break;
 
       case google_firestore_v1beta1_BatchGetDocumentsResponse_read_time_tag:
@@ -474,8 +517,9 @@ std::unique_ptr<MaybeDocument> Serializer::DecodeBatchGetDocumentsResponse(
 std::unique_ptr<Document> Serializer::DecodeDocument(Reader* reader) const {
   if (!reader->status().ok()) return nullptr;
 
-  std::string name;
-  ObjectValue::Map fields_internal;
+  // Refers to the bytes being decoded, which outlive this call.
+  absl::string_view name;
+  std::vector<FieldsEntry> fields_internal;
   SnapshotVersion version = SnapshotVersion::None();
 
   while (reader->bytes_left()) {
@@ -484,12 +528,11 @@ std::unique_ptr<Document> Serializer::DecodeDocument(Reader* reader) const {
     HARD_ASSERT(tag.wire_type == PB_WT_STRING);
     switch (tag.field_number) {
       case google_firestore_v1beta1_Document_name_tag:
-        name = reader->ReadString();
+        name = reader->ReadStringView();
         break;
       case google_firestore_v1beta1_Document_fields_tag: {
-        ObjectValue::Map::value_type fv =
-            reader->ReadNestedMessage<ObjectValue::Map::value_type>(
-                DecodeDocumentFieldsEntry);
+        FieldsEntry fv =
+            reader->ReadNestedMessage<FieldsEntry>(DecodeDocumentFieldsEntry);
 
         if (!reader->status().ok()) return nullptr;
 
@@ -497,7 +540,7 @@ std::unique_ptr<Document> Serializer::DecodeDocument(Reader* reader) const {
         // comment on writing object map for details (DecodeMapValue).
 
         // Add fieldvalue to the results map.
-        fields_internal[fv.first] = fv.second;
+        fields_internal.push_back(std::move(fv));
         break;
       }
       case google_firestore_v1beta1_Document_create_time_tag:
@@ -521,8 +564,9 @@ std::unique_ptr<Document> Serializer::DecodeDocument(Reader* reader) const {
   }
 
   return absl::make_unique<Document>(
-      FieldValue::ObjectValueFromMap(fields_internal), DecodeKey(name), version,
-      /*has_local_modifications=*/false);
+      FieldValue::ObjectValueFromMap(
+          MapFromEntries(std::move(fields_internal))),
+      DecodeKey(name), version, /*has_local_modifications=*/false);
 }
 
 void Serializer::EncodeMapValue(Writer* writer,
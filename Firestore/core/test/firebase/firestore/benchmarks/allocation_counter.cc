@@ -0,0 +1,87 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/test/firebase/firestore/benchmarks/allocation_counter.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace firebase {
+namespace firestore {
+namespace {
+
+std::atomic<size_t> allocation_count{0};
+std::atomic<size_t> live_bytes{0};
+
+/**
+ * Each block starts with a header recording its size, so that deallocation
+ * can subtract it from live_bytes. The header is as large as the strictest
+ * fundamental alignment, so the memory after it stays suitably aligned.
+ */
+union Header {
+  size_t size;
+  std::max_align_t align;
+};
+
+void* CountedAllocate(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void* block = std::malloc(sizeof(Header) + size);
+  if (block == nullptr) {
+    throw std::bad_alloc();
+  }
+  live_bytes.fetch_add(size, std::memory_order_relaxed);
+  auto header = static_cast<Header*>(block);
+  header->size = size;
+  return header + 1;
+}
+
+void CountedFree(void* ptr) {
+  if (ptr == nullptr) return;
+  Header* header = static_cast<Header*>(ptr) - 1;
+  live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+  std::free(header);
+}
+
+}  // namespace
+
+size_t AllocationCount() {
+  return allocation_count.load(std::memory_order_relaxed);
+}
+
+size_t LiveBytes() {
+  return live_bytes.load(std::memory_order_relaxed);
+}
+
+}  // namespace firestore
+}  // namespace firebase
+
+void* operator new(size_t size) {
+  return firebase::firestore::CountedAllocate(size);
+}
+
+void* operator new[](size_t size) {
+  return firebase::firestore::CountedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+  firebase::firestore::CountedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  firebase::firestore::CountedFree(ptr);
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_TEST_FIREBASE_FIRESTORE_BENCHMARKS_ALLOCATION_COUNTER_H_
+#define FIRESTORE_CORE_TEST_FIREBASE_FIRESTORE_BENCHMARKS_ALLOCATION_COUNTER_H_
+
+#include <cstddef>
+
+namespace firebase {
+namespace firestore {
+
+/**
+ * Returns the number of times the global operator new has been called by this
+ * process so far. Benchmarks can compare the values before and after an
+ * operation to report how many heap allocations it made.
+ *
+ * This works by replacing the global allocation functions, so it's only
+ * available in the benchmark executable.
+ */
+size_t AllocationCount();
+
+/**
+ * Returns the number of bytes requested from the global operator new that
+ * haven't been freed yet. Comparing the values before and after building a
+ * structure gives the heap memory the structure holds on to.
+ */
+size_t LiveBytes();
+
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_TEST_FIREBASE_FIRESTORE_BENCHMARKS_ALLOCATION_COUNTER_H_
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Firestore/core/src/firebase/firestore/model/document_key.h"
+#include "Firestore/core/src/firebase/firestore/model/document_key_set.h"
+#include "Firestore/core/src/firebase/firestore/util/autoid.h"
+#include "Firestore/core/test/firebase/firestore/benchmarks/allocation_counter.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace model {
+
+namespace {
+
+/**
+ * Returns the paths of `count` documents spread over ten "messages"
+ * subcollections, in random order.
+ */
+std::vector<std::string> DocumentPaths(int64_t count) {
+  std::vector<std::string> result;
+  result.reserve(static_cast<size_t>(count));
+  for (int64_t i = 0; i < count; i++) {
+    result.push_back(absl::StrCat("rooms/room", i % 10, "/messages/",
+                                  util::CreateAutoId()));
+  }
+  return result;
+}
+
+std::vector<DocumentKey> DocumentKeys(int64_t count) {
+  std::vector<DocumentKey> result;
+  for (const std::string& path : DocumentPaths(count)) {
+    result.push_back(DocumentKey::FromPathString(path));
+  }
+  return result;
+}
+
+/**
+ * Creates two DocumentKeySets of `count` keys each, half of which they have
+ * in common.
+ */
+std::pair<DocumentKeySet, DocumentKeySet> OverlappingSets(int64_t count) {
+  std::vector<DocumentKey> keys = DocumentKeys(count + count / 2);
+  auto middle = keys.begin() + static_cast<std::ptrdiff_t>(count / 2);
+  auto end = keys.begin() + static_cast<std::ptrdiff_t>(count);
+  DocumentKeySet lhs = DocumentKeySet{}.insert_all(
+      std::vector<DocumentKey>(keys.begin(), end));
+  DocumentKeySet rhs =
+      DocumentKeySet{}.insert_all(std::vector<DocumentKey>(middle, keys.end()));
+  return {lhs, rhs};
+}
+
+/** Set sizes from 1k to 1M keys. */
+void SetSizes(benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+}
+
+}  // namespace
+
+static void BM_DocumentKeyFromPathString(benchmark::State& state) {
+  std::vector<std::string> paths = DocumentPaths(state.range(0));
+  for (auto _ : state) {
+    for (const std::string& path : paths) {
+      benchmark::DoNotOptimize(DocumentKey::FromPathString(path));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DocumentKeyFromPathString)->Range(1000, 100000);
+
+/** Reports the heap memory held by each key built from a path string. */
+static void BM_DocumentKeyMemory(benchmark::State& state) {
+  std::vector<std::string> paths = DocumentPaths(state.range(0));
+  size_t bytes = 0;
+  for (auto _ : state) {
+    std::vector<DocumentKey> keys;
+    keys.reserve(paths.size());
+
+    size_t before = LiveBytes();
+    for (const std::string& path : paths) {
+      keys.push_back(DocumentKey::FromPathString(path));
+    }
+    bytes += LiveBytes() - before;
+    benchmark::DoNotOptimize(keys.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  if (state.iterations() > 0) {
+    state.counters["bytes_per_key"] = static_cast<double>(bytes) /
+                                      state.iterations() / state.range(0);
+  }
+}
+BENCHMARK(BM_DocumentKeyMemory)->Range(1000, 100000);
+
+static void BM_DocumentKeySort(benchmark::State& state) {
+  std::vector<DocumentKey> keys = DocumentKeys(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<DocumentKey> sorted = keys;
+    state.ResumeTiming();
+
+    std::sort(sorted.begin(), sorted.end());
+    benchmark::DoNotOptimize(sorted.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DocumentKeySort)->Range(1000, 100000);
+
+static void BM_DocumentKeySetInsert(benchmark::State& state) {
+  std::vector<DocumentKey> keys = DocumentKeys(state.range(0));
+  for (auto _ : state) {
+    DocumentKeySet set;
+    for (const DocumentKey& key : keys) {
+      set = set.insert(key);
+    }
+    benchmark::DoNotOptimize(set);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DocumentKeySetInsert)->Range(1000, 100000);
+
+static void BM_DocumentKeySetUnion(benchmark::State& state) {
+  auto sets = OverlappingSets(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sets.first.set_union(sets.second));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+BENCHMARK(BM_DocumentKeySetUnion)->Apply(SetSizes);
+
+static void BM_DocumentKeySetIntersection(benchmark::State& state) {
+  auto sets = OverlappingSets(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sets.first.set_intersection(sets.second));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+BENCHMARK(BM_DocumentKeySetIntersection)->Apply(SetSizes);
+
+static void BM_DocumentKeySetDifference(benchmark::State& state) {
+  auto sets = OverlappingSets(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sets.first.set_difference(sets.second));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+BENCHMARK(BM_DocumentKeySetDifference)->Apply(SetSizes);
+
+/** The element-by-element equivalent of BM_DocumentKeySetDifference. */
+static void BM_DocumentKeySetDifferenceOneAtATime(benchmark::State& state) {
+  auto sets = OverlappingSets(state.range(0));
+  for (auto _ : state) {
+    DocumentKeySet result = sets.first;
+    for (const DocumentKey& key : sets.second) {
+      result = result.erase(key);
+    }
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+BENCHMARK(BM_DocumentKeySetDifferenceOneAtATime)->Apply(SetSizes);
+
+static void BM_DocumentKeySetSymmetricDifference(benchmark::State& state) {
+  auto sets = OverlappingSets(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sets.first.set_symmetric_difference(sets.second));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+BENCHMARK(BM_DocumentKeySetSymmetricDifference)->Apply(SetSizes);
+
+static void BM_DocumentKeyUnorderedMapLookup(benchmark::State& state) {
+  std::vector<DocumentKey> keys = DocumentKeys(state.range(0));
+  std::unordered_map<DocumentKey, int64_t, DocumentKeyHash> map;
+  for (size_t i = 0; i < keys.size(); i++) {
+    map[keys[i]] = static_cast<int64_t>(i);
+  }
+
+  for (auto _ : state) {
+    for (const DocumentKey& key : keys) {
+      benchmark::DoNotOptimize(map.find(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DocumentKeyUnorderedMapLookup)->Range(1000, 100000);
+
+static void BM_DocumentKeyToString(benchmark::State& state) {
+  std::vector<DocumentKey> keys = DocumentKeys(state.range(0));
+  for (auto _ : state) {
+    for (const DocumentKey& key : keys) {
+      benchmark::DoNotOptimize(key.ToString().size());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DocumentKeyToString)->Range(1000, 100000);
+
+}  // namespace model
+}  // namespace firestore
+}  // namespace firebase
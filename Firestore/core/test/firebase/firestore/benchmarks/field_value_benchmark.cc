@@ -0,0 +1,182 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Firestore/core/src/firebase/firestore/model/field_path.h"
+#include "Firestore/core/src/firebase/firestore/model/field_value.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace model {
+
+namespace {
+
+/** Creates an object with `size` fields, each holding a small nested map. */
+FieldValue ObjectWithFields(int64_t size) {
+  ObjectValue::Map fields;
+  for (int64_t i = 0; i < size; i++) {
+    fields = fields.insert(
+        absl::StrCat("field", i),
+        FieldValue::ObjectValueFromMap({
+            {"count", FieldValue::IntegerValue(i)},
+            {"name", FieldValue::StringValue(absl::StrCat("value ", i))},
+        }));
+  }
+  return FieldValue::ObjectValueFromMap(std::move(fields));
+}
+
+}  // namespace
+
+static void BM_FieldValueCompareEqualObjects(benchmark::State& state) {
+  FieldValue lhs = ObjectWithFields(state.range(0));
+  FieldValue rhs = ObjectWithFields(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lhs == rhs);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FieldValueCompareEqualObjects)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000)
+    ->Complexity();
+
+static void BM_FieldValueCompareLessThan(benchmark::State& state) {
+  FieldValue lhs = ObjectWithFields(state.range(0));
+  FieldValue rhs = lhs.Set(FieldPath::FromServerFormat("zzz"),
+                           FieldValue::IntegerValue(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lhs < rhs);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FieldValueCompareLessThan)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000)
+    ->Complexity();
+
+static void BM_FieldValueCompareUnequalHashed(benchmark::State& state) {
+  FieldValue lhs = ObjectWithFields(state.range(0));
+  FieldValue rhs = lhs.Set(FieldPath::FromServerFormat("field0.count"),
+                           FieldValue::IntegerValue(-1));
+  // Once both hashes are cached, unequal values are rejected in O(1).
+  lhs.Hash();
+  rhs.Hash();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lhs == rhs);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FieldValueCompareUnequalHashed)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000)
+    ->Complexity();
+
+static void BM_FieldValueHash(benchmark::State& state) {
+  FieldValue value = ObjectWithFields(state.range(0));
+  for (auto _ : state) {
+    // Hash a fresh copy of the top-level object each time. Nested values keep
+    // the hashes cached in the shared map, as they would in a document.
+    FieldValue copy = FieldValue::ObjectValueFromMap(
+        value.object_value().internal_value);
+    benchmark::DoNotOptimize(copy.Hash());
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FieldValueHash)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000)
+    ->Complexity();
+
+static void BM_FieldValueCopy(benchmark::State& state) {
+  FieldValue value = ObjectWithFields(state.range(0));
+  for (auto _ : state) {
+    FieldValue copy = value;
+    benchmark::DoNotOptimize(copy);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FieldValueCopy)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000)
+    ->Complexity();
+
+static void BM_FieldValueCopyArray(benchmark::State& state) {
+  std::vector<FieldValue> elements;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    elements.push_back(FieldValue::StringValue(absl::StrCat("element ", i)));
+  }
+  FieldValue value = FieldValue::ArrayValue(std::move(elements));
+  for (auto _ : state) {
+    FieldValue copy = value;
+    benchmark::DoNotOptimize(copy);
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FieldValueCopyArray)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000)
+    ->Complexity();
+
+static void BM_FieldValueSet(benchmark::State& state) {
+  FieldValue value = ObjectWithFields(state.range(0));
+  FieldPath path = FieldPath::FromServerFormat("field0.count");
+  FieldValue new_value = FieldValue::IntegerValue(42);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(value.Set(path, new_value));
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FieldValueSet)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000)
+    ->Complexity();
+
+static void BM_FieldValueDelete(benchmark::State& state) {
+  FieldValue value = ObjectWithFields(state.range(0));
+  FieldPath path = FieldPath::FromServerFormat(
+      absl::StrCat("field", state.range(0) / 2, ".name"));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(value.Delete(path));
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FieldValueDelete)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000)
+    ->Complexity();
+
+static void BM_FieldValueGet(benchmark::State& state) {
+  FieldValue value = ObjectWithFields(state.range(0));
+  FieldPath path = FieldPath::FromServerFormat(
+      absl::StrCat("field", state.range(0) / 2, ".count"));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(value.Get(path));
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FieldValueGet)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000)
+    ->Complexity();
+
+}  // namespace model
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+
+#include "Firestore/core/src/firebase/firestore/local/leveldb_key.h"
+#include "Firestore/core/src/firebase/firestore/model/document_key.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+using model::DocumentKey;
+
+namespace {
+
+const DocumentKey& BenchmarkKey() {
+  static const DocumentKey key =
+      DocumentKey::FromPathString("rooms/firestore/messages/abcdefghijklmnop");
+  return key;
+}
+
+}  // namespace
+
+static void BM_RemoteDocumentKeyEncode(benchmark::State& state) {
+  const DocumentKey& key = BenchmarkKey();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LevelDbRemoteDocumentKey::Key(key));
+  }
+}
+BENCHMARK(BM_RemoteDocumentKeyEncode);
+
+static void BM_RemoteDocumentKeyDecode(benchmark::State& state) {
+  std::string encoded = LevelDbRemoteDocumentKey::Key(BenchmarkKey());
+  LevelDbRemoteDocumentKey decoder;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decoder.Decode(encoded));
+  }
+}
+BENCHMARK(BM_RemoteDocumentKeyDecode);
+
+static void BM_TargetDocumentKeyEncode(benchmark::State& state) {
+  const DocumentKey& key = BenchmarkKey();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LevelDbTargetDocumentKey::Key(42, key));
+  }
+}
+BENCHMARK(BM_TargetDocumentKeyEncode);
+
+static void BM_TargetDocumentKeyDecode(benchmark::State& state) {
+  std::string encoded = LevelDbTargetDocumentKey::Key(42, BenchmarkKey());
+  LevelDbTargetDocumentKey decoder;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decoder.Decode(encoded));
+  }
+}
+BENCHMARK(BM_TargetDocumentKeyDecode);
+
+static void BM_DocumentTargetKeyEncode(benchmark::State& state) {
+  const DocumentKey& key = BenchmarkKey();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LevelDbDocumentTargetKey::Key(key, 42));
+  }
+}
+BENCHMARK(BM_DocumentTargetKeyEncode);
+
+static void BM_DocumentTargetKeyDecode(benchmark::State& state) {
+  std::string encoded = LevelDbDocumentTargetKey::Key(BenchmarkKey(), 42);
+  LevelDbDocumentTargetKey decoder;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decoder.Decode(encoded));
+  }
+}
+BENCHMARK(BM_DocumentTargetKeyDecode);
+
+static void BM_DescribeKey(benchmark::State& state) {
+  std::string encoded = LevelDbRemoteDocumentKey::Key(BenchmarkKey());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Describe(encoded));
+  }
+}
+BENCHMARK(BM_DescribeKey);
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Firestore/core/include/firebase/firestore/timestamp.h"
+#include "Firestore/core/src/firebase/firestore/local/leveldb_remote_document_cache.h"
+#include "Firestore/core/src/firebase/firestore/local/leveldb_transaction.h"
+#include "Firestore/core/src/firebase/firestore/local/local_serializer.h"
+#include "Firestore/core/src/firebase/firestore/model/database_id.h"
+#include "Firestore/core/src/firebase/firestore/model/document.h"
+#include "Firestore/core/src/firebase/firestore/model/document_key.h"
+#include "Firestore/core/src/firebase/firestore/model/field_value.h"
+#include "Firestore/core/src/firebase/firestore/model/resource_path.h"
+#include "Firestore/core/src/firebase/firestore/model/snapshot_version.h"
+#include "Firestore/core/src/firebase/firestore/remote/serializer.h"
+#include "Firestore/core/test/firebase/firestore/benchmarks/scratch_leveldb.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+using model::DatabaseId;
+using model::Document;
+using model::DocumentKey;
+using model::FieldValue;
+using model::ResourcePath;
+using model::SnapshotVersion;
+
+namespace {
+
+/** Returns a zero-padded id, so that numeric and key orders agree. */
+std::string Id(int64_t i) {
+  std::string id = std::to_string(i);
+  id.insert(0, 8 - id.size(), '0');
+  return id;
+}
+
+/** A document with a couple of fields, like a small chat message. */
+Document Message(const ResourcePath& path) {
+  FieldValue data = FieldValue::ObjectValueFromMap(
+      {{"text", FieldValue::StringValue(std::string(200, 't'))},
+       {"sent", FieldValue::IntegerValue(1234567890)}});
+  return Document{std::move(data), DocumentKey{path},
+                  SnapshotVersion{Timestamp{1, 0}},
+                  /* has_local_mutations= */ false};
+}
+
+}  // namespace
+
+/**
+ * Reads every document of a collection of `docs` documents, each of which has
+ * `children` documents of its own in a subcollection, as a query over the
+ * remote document cache does.
+ */
+static void BM_LevelDbRemoteDocumentCacheGetCollection(
+    benchmark::State& state) {
+  ScratchLevelDb db("BM_LevelDbRemoteDocumentCacheGetCollection");
+  remote::Serializer remote_serializer{DatabaseId{"p", "d"}};
+  LocalSerializer serializer{remote_serializer};
+  int64_t docs = state.range(0);
+  int64_t children = state.range(1);
+  {
+    LevelDbTransaction txn(db.get(), "Populate");
+    LevelDbRemoteDocumentCache cache(&txn, &serializer);
+    for (int64_t i = 0; i < docs; i++) {
+      ResourcePath room{"rooms", Id(i)};
+      cache.Add(Message(room));
+      for (int64_t j = 0; j < children; j++) {
+        cache.Add(Message(room.Append("messages").Append(Id(j))));
+      }
+    }
+    txn.Commit();
+  }
+
+  ResourcePath rooms{"rooms"};
+  for (auto _ : state) {
+    LevelDbTransaction txn(db.get(),
+                           "BM_LevelDbRemoteDocumentCacheGetCollection");
+    LevelDbRemoteDocumentCache cache(&txn, &serializer);
+    std::vector<std::unique_ptr<Document>> result = cache.GetCollection(rooms);
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.SetItemsProcessed(state.iterations() * docs);
+}
+BENCHMARK(BM_LevelDbRemoteDocumentCacheGetCollection)
+    ->ArgNames({"docs", "children"})
+    ->Args({1 << 10, 0})
+    ->Args({1 << 10, 16});
+
+/**
+ * Walks the keys of a collection of 1024 documents without decoding any of
+ * them, as a caller that can reject documents by key alone would.
+ */
+static void BM_LevelDbRemoteDocumentCacheScanKeys(benchmark::State& state) {
+  ScratchLevelDb db("BM_LevelDbRemoteDocumentCacheScanKeys");
+  remote::Serializer remote_serializer{DatabaseId{"p", "d"}};
+  LocalSerializer serializer{remote_serializer};
+  const int64_t docs = 1 << 10;
+  {
+    LevelDbTransaction txn(db.get(), "Populate");
+    LevelDbRemoteDocumentCache cache(&txn, &serializer);
+    for (int64_t i = 0; i < docs; i++) {
+      cache.Add(Message(ResourcePath{"rooms", Id(i)}));
+    }
+    txn.Commit();
+  }
+
+  ResourcePath rooms{"rooms"};
+  for (auto _ : state) {
+    LevelDbTransaction txn(db.get(), "BM_LevelDbRemoteDocumentCacheScanKeys");
+    LevelDbRemoteDocumentCache cache(&txn, &serializer);
+    for (auto scan = cache.ScanCollection(rooms); scan.Valid(); scan.Next()) {
+      benchmark::DoNotOptimize(&scan.key());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * docs);
+}
+BENCHMARK(BM_LevelDbRemoteDocumentCacheScanKeys);
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,288 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+
+#include "Firestore/core/src/firebase/firestore/local/leveldb_key.h"
+#include "Firestore/core/src/firebase/firestore/local/leveldb_options.h"
+#include "Firestore/core/src/firebase/firestore/local/leveldb_transaction.h"
+#include "Firestore/core/src/firebase/firestore/model/document_key.h"
+#include "Firestore/core/test/firebase/firestore/benchmarks/scratch_leveldb.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "leveldb/db.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+using model::DocumentKey;
+
+namespace {
+
+/** Returns the remote document key of the i'th benchmark document. */
+std::string DocumentRowKey(int64_t i) {
+  // Zero-pad so that numeric and lexicographic orders agree.
+  std::string id = std::to_string(i);
+  id.insert(0, 8 - id.size(), '0');
+  return LevelDbRemoteDocumentKey::Key(
+      DocumentKey::FromSegments({"rooms", "firestore", "messages", id}));
+}
+
+/** A value roughly the size of a small encoded document. */
+const std::string& DocumentRowValue() {
+  static const std::string value(256, 'v');
+  return value;
+}
+
+/** Commits `count` documents rows to the given database. */
+void Populate(leveldb::DB* db, int64_t count) {
+  LevelDbTransaction txn(db, "Populate");
+  for (int64_t i = 0; i < count; i++) {
+    txn.Put(DocumentRowKey(i), DocumentRowValue());
+  }
+  txn.Commit();
+}
+
+}  // namespace
+
+static void BM_LevelDbTransactionPut(benchmark::State& state) {
+  ScratchLevelDb db("BM_LevelDbTransactionPut");
+  int64_t count = state.range(0);
+  for (auto _ : state) {
+    LevelDbTransaction txn(db.get(), "BM_LevelDbTransactionPut");
+    for (int64_t i = 0; i < count; i++) {
+      txn.Put(DocumentRowKey(i), DocumentRowValue());
+    }
+    benchmark::DoNotOptimize(txn.changed_keys());
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_LevelDbTransactionPut)->Range(8, 8 << 10);
+
+static void BM_LevelDbTransactionCommit(benchmark::State& state) {
+  ScratchLevelDb db("BM_LevelDbTransactionCommit");
+  int64_t count = state.range(0);
+  for (auto _ : state) {
+    LevelDbTransaction txn(db.get(), "BM_LevelDbTransactionCommit");
+    for (int64_t i = 0; i < count; i++) {
+      txn.Put(DocumentRowKey(i), DocumentRowValue());
+    }
+    txn.Commit();
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_LevelDbTransactionCommit)->Range(8, 8 << 10);
+
+/**
+ * Reads every row through a transaction in which every other row has a
+ * pending mutation and every fourth row a pending deletion.
+ */
+static void BM_LevelDbTransactionGet(benchmark::State& state) {
+  ScratchLevelDb db("BM_LevelDbTransactionGet");
+  int64_t count = state.range(0);
+  Populate(db.get(), count);
+
+  LevelDbTransaction txn(db.get(), "BM_LevelDbTransactionGet");
+  for (int64_t i = 0; i < count; i += 2) {
+    txn.Put(DocumentRowKey(i), DocumentRowValue());
+  }
+  for (int64_t i = 1; i < count; i += 4) {
+    txn.Delete(DocumentRowKey(i));
+  }
+
+  std::string value;
+  for (auto _ : state) {
+    for (int64_t i = 0; i < count; i++) {
+      benchmark::DoNotOptimize(txn.Get(DocumentRowKey(i), &value));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_LevelDbTransactionGet)->Range(8, 8 << 10);
+
+/**
+ * Scans committed rows merged with pending mutations and deletions, in the
+ * same proportions as BM_LevelDbTransactionGet. With changes=0 this measures a
+ * scan over committed data only.
+ */
+static void BM_LevelDbTransactionIterate(benchmark::State& state) {
+  ScratchLevelDb db("BM_LevelDbTransactionIterate");
+  int64_t count = state.range(0);
+  bool with_changes = state.range(1) != 0;
+  Populate(db.get(), count);
+
+  LevelDbTransaction txn(db.get(), "BM_LevelDbTransactionIterate");
+  if (with_changes) {
+    for (int64_t i = 0; i < count; i += 2) {
+      txn.Put(DocumentRowKey(i), DocumentRowValue());
+    }
+    for (int64_t i = 1; i < count; i += 4) {
+      txn.Delete(DocumentRowKey(i));
+    }
+  }
+
+  std::string prefix = LevelDbRemoteDocumentKey::KeyPrefix();
+  for (auto _ : state) {
+    size_t bytes = 0;
+    std::unique_ptr<LevelDbTransaction::Iterator> it = txn.NewIterator();
+    for (it->Seek(prefix); it->Valid(); it->Next()) {
+      bytes += it->value().size();
+    }
+    benchmark::DoNotOptimize(bytes);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_LevelDbTransactionIterate)
+    ->ArgNames({"rows", "changes"})
+    ->Args({64, 0})
+    ->Args({64, 1})
+    ->Args({8 << 10, 0})
+    ->Args({8 << 10, 1});
+
+/**
+ * Scans a collection of committed documents of the given size through a
+ * transaction with no pending changes, as a query over the remote document
+ * cache does, reporting the throughput in document bytes.
+ */
+static void BM_LevelDbTransactionScan(benchmark::State& state) {
+  ScratchLevelDb db("BM_LevelDbTransactionScan");
+  int64_t count = state.range(0);
+  std::string document(static_cast<size_t>(state.range(1)), 'd');
+  {
+    LevelDbTransaction txn(db.get(), "Populate");
+    for (int64_t i = 0; i < count; i++) {
+      txn.Put(DocumentRowKey(i), document);
+    }
+    txn.Commit();
+  }
+
+  std::string prefix = LevelDbRemoteDocumentKey::KeyPrefix();
+  size_t bytes = 0;
+  for (auto _ : state) {
+    LevelDbTransaction txn(db.get(), "BM_LevelDbTransactionScan");
+    std::unique_ptr<LevelDbTransaction::Iterator> it = txn.NewIterator();
+    for (it->Seek(prefix); it->Valid(); it->Next()) {
+      absl::string_view value = it->value();
+      benchmark::DoNotOptimize(value.data());
+      bytes += value.size();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+  state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_LevelDbTransactionScan)
+    ->ArgNames({"rows", "bytes"})
+    ->Args({1 << 10, 256})
+    ->Args({1 << 10, 4 << 10})
+    ->Args({8 << 10, 256})
+    ->Args({8 << 10, 4 << 10});
+
+/**
+ * Looks up rows in random order in a database of 32k rows of 256 bytes each,
+ * flushed to tables, that was opened with the given block cache capacity (0
+ * for LevelDB's built-in 8MB) and bloom filter bits per key. With present=0
+ * every lookup is for a key between the rows that exist, as when checking the
+ * cache for a document it has never seen. Reports the number of table reads
+ * per lookup as "block_reads".
+ */
+static void BM_LevelDbTunedGet(benchmark::State& state) {
+  LevelDbOptions tuning;
+  tuning.block_cache_bytes = static_cast<size_t>(state.range(0)) << 20;
+  tuning.bloom_filter_bits_per_key = static_cast<int>(state.range(1));
+  bool present = state.range(2) != 0;
+  LevelDbConfig config{tuning};
+  ScratchLevelDb db("BM_LevelDbTunedGet", config.open_options());
+
+  // Rows exist only for the even-numbered keys.
+  const int64_t count = 64 << 10;
+  {
+    LevelDbTransaction txn(db.get(), "Populate", config);
+    for (int64_t i = 0; i < count; i += 2) {
+      txn.Put(DocumentRowKey(i), DocumentRowValue());
+    }
+    txn.Commit();
+  }
+  db.get()->CompactRange(nullptr, nullptr);
+
+  std::string value;
+  int64_t step = 0;
+  int64_t block_reads = config.stats().block_reads.load();
+  for (auto _ : state) {
+    // An odd stride visits every key once per pass, in a scattered order.
+    int64_t i = (step++ * 7919) % count;
+    i = present ? (i & ~1) : (i | 1);
+    benchmark::DoNotOptimize(
+        db.get()->Get(config.read_options(), DocumentRowKey(i), &value));
+  }
+  block_reads = config.stats().block_reads.load() - block_reads;
+  state.counters["block_reads"] = benchmark::Counter(
+      static_cast<double>(block_reads), benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LevelDbTunedGet)
+    ->ArgNames({"cache_mb", "bloom_bits", "present"})
+    ->Args({0, 0, 1})
+    ->Args({32, 0, 1})
+    ->Args({0, 0, 0})
+    ->Args({0, 10, 0})
+    ->Args({32, 10, 0});
+
+/**
+ * Scans 32k rows of 1KB each, flushed to tables, through a transaction using
+ * the given checksum verification policy (as a ChecksumVerification value)
+ * and choice of whether scans fill the block cache.
+ */
+static void BM_LevelDbTunedScan(benchmark::State& state) {
+  LevelDbOptions tuning;
+  tuning.verify_checksums = static_cast<ChecksumVerification>(state.range(0));
+  tuning.fill_cache_on_scans = state.range(1) != 0;
+  LevelDbConfig config{tuning};
+  ScratchLevelDb db("BM_LevelDbTunedScan", config.open_options());
+
+  const int64_t count = 32 << 10;
+  std::string document(1 << 10, 'd');
+  {
+    LevelDbTransaction txn(db.get(), "Populate", config);
+    for (int64_t i = 0; i < count; i++) {
+      txn.Put(DocumentRowKey(i), document);
+    }
+    txn.Commit();
+  }
+  db.get()->CompactRange(nullptr, nullptr);
+
+  std::string prefix = LevelDbRemoteDocumentKey::KeyPrefix();
+  size_t bytes = 0;
+  for (auto _ : state) {
+    LevelDbTransaction txn(db.get(), "BM_LevelDbTunedScan", config);
+    std::unique_ptr<LevelDbTransaction::Iterator> it = txn.NewIterator();
+    for (it->Seek(prefix); it->Valid(); it->Next()) {
+      bytes += it->value().size();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+  state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_LevelDbTunedScan)
+    ->ArgNames({"verify", "fill_cache"})
+    ->Args({static_cast<int>(ChecksumVerification::kAll), 1})
+    ->Args({static_cast<int>(ChecksumVerification::kPointReads), 1})
+    ->Args({static_cast<int>(ChecksumVerification::kPointReads), 0});
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <string>
+
+#include "Firestore/core/src/firebase/firestore/util/ordered_code.h"
+#include "absl/strings/string_view.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+
+static void BM_OrderedCodeWriteString(benchmark::State& state) {
+  std::string value(static_cast<size_t>(state.range(0)), 'a');
+  // Make sure the escaping paths are exercised too.
+  value[0] = '\0';
+  value[value.size() - 1] = '\xff';
+
+  std::string dest;
+  for (auto _ : state) {
+    dest.clear();
+    OrderedCode::WriteString(&dest, value);
+    benchmark::DoNotOptimize(dest.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OrderedCodeWriteString)->Range(8, 4096);
+
+static void BM_OrderedCodeReadString(benchmark::State& state) {
+  std::string value(static_cast<size_t>(state.range(0)), 'a');
+  value[0] = '\0';
+  value[value.size() - 1] = '\xff';
+
+  std::string encoded;
+  OrderedCode::WriteString(&encoded, value);
+
+  std::string result;
+  for (auto _ : state) {
+    absl::string_view src = encoded;
+    benchmark::DoNotOptimize(OrderedCode::ReadString(&src, &result));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OrderedCodeReadString)->Range(8, 4096);
+
+static void BM_OrderedCodeWriteSignedNumIncreasing(benchmark::State& state) {
+  std::string dest;
+  int64_t num = 0;
+  for (auto _ : state) {
+    dest.clear();
+    OrderedCode::WriteSignedNumIncreasing(&dest, num);
+    benchmark::DoNotOptimize(dest.data());
+    num = num * 3 + 7;
+  }
+}
+BENCHMARK(BM_OrderedCodeWriteSignedNumIncreasing);
+
+static void BM_OrderedCodeReadSignedNumIncreasing(benchmark::State& state) {
+  std::string encoded;
+  OrderedCode::WriteSignedNumIncreasing(&encoded, int64_t{-1234567890123});
+
+  int64_t result = 0;
+  for (auto _ : state) {
+    absl::string_view src = encoded;
+    benchmark::DoNotOptimize(
+        OrderedCode::ReadSignedNumIncreasing(&src, &result));
+  }
+}
+BENCHMARK(BM_OrderedCodeReadSignedNumIncreasing);
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Firestore/core/src/firebase/firestore/core/filter.h"
+#include "Firestore/core/src/firebase/firestore/core/query.h"
+#include "Firestore/core/src/firebase/firestore/model/document.h"
+#include "Firestore/core/src/firebase/firestore/model/document_key.h"
+#include "Firestore/core/src/firebase/firestore/model/field_path.h"
+#include "Firestore/core/src/firebase/firestore/model/field_value.h"
+#include "Firestore/core/src/firebase/firestore/model/resource_path.h"
+#include "Firestore/core/src/firebase/firestore/model/snapshot_version.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace core {
+
+using model::Document;
+using model::DocumentKey;
+using model::FieldPath;
+using model::FieldValue;
+using model::ObjectValue;
+using model::ResourcePath;
+using model::SnapshotVersion;
+
+namespace {
+
+/** The number of fields in the "stats" map of each document. */
+constexpr int64_t kStatsFields = 50;
+
+/** Builds a "stats" map. Each call returns an equal but unshared map. */
+FieldValue Stats() {
+  ObjectValue::Map stats;
+  for (int64_t i = 0; i < kStatsFields; i++) {
+    stats = stats.insert(absl::StrCat("stat", i), FieldValue::IntegerValue(i));
+  }
+  return FieldValue::ObjectValueFromMap(std::move(stats));
+}
+
+/**
+ * Creates `count` documents in the "rooms" collection. Each has a "sort"
+ * number, a "name" string and a "stats" map.
+ */
+std::vector<Document> Documents(int64_t count) {
+  std::vector<Document> result;
+  result.reserve(static_cast<size_t>(count));
+  for (int64_t i = 0; i < count; i++) {
+    FieldValue data = FieldValue::ObjectValueFromMap({
+        {"sort", FieldValue::IntegerValue(i)},
+        {"name", FieldValue::StringValue(absl::StrCat("room ", i % 10))},
+        {"stats", Stats()},
+    });
+    result.emplace_back(std::move(data),
+                        DocumentKey::FromSegments({"rooms", std::to_string(i)}),
+                        SnapshotVersion::None(),
+                        /*has_local_mutations=*/false);
+  }
+  return result;
+}
+
+/** Runs the given query over `state.range(0)` documents. */
+void MatchDocuments(benchmark::State& state, const Query& query) {
+  std::vector<Document> documents = Documents(state.range(0));
+  for (auto _ : state) {
+    int64_t matches = 0;
+    for (const Document& doc : documents) {
+      if (query.Matches(doc)) {
+        matches++;
+      }
+    }
+    benchmark::DoNotOptimize(matches);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+Query RoomsQuery() {
+  return Query::AtPath(ResourcePath{"rooms"});
+}
+
+}  // namespace
+
+static void BM_QueryMatchesInequality(benchmark::State& state) {
+  Query query = RoomsQuery().Filter(
+      Filter::Create(FieldPath{"sort"}, Filter::Operator::LessThanOrEqual,
+                     FieldValue::IntegerValue(state.range(0) / 2)));
+  MatchDocuments(state, query);
+}
+BENCHMARK(BM_QueryMatchesInequality)->RangeMultiplier(10)->Range(100, 10000);
+
+static void BM_QueryMatchesStringEquality(benchmark::State& state) {
+  Query query = RoomsQuery().Filter(Filter::Create(
+      FieldPath{"name"}, Filter::Operator::Equal,
+      FieldValue::StringValue("room 3")));
+  MatchDocuments(state, query);
+}
+BENCHMARK(BM_QueryMatchesStringEquality)
+    ->RangeMultiplier(10)
+    ->Range(100, 10000);
+
+static void BM_QueryMatchesObjectEquality(benchmark::State& state) {
+  // Every document's stats map is equal to, but not shared with, this one, so
+  // each match must compare all of the fields.
+  Query query = RoomsQuery().Filter(
+      Filter::Create(FieldPath{"stats"}, Filter::Operator::Equal, Stats()));
+  MatchDocuments(state, query);
+}
+BENCHMARK(BM_QueryMatchesObjectEquality)
+    ->RangeMultiplier(10)
+    ->Range(100, 10000);
+
+}  // namespace core
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_TEST_FIREBASE_FIRESTORE_BENCHMARKS_SCRATCH_LEVELDB_H_
+#define FIRESTORE_CORE_TEST_FIREBASE_FIRESTORE_BENCHMARKS_SCRATCH_LEVELDB_H_
+
+#include <memory>
+#include <string>
+
+#include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
+#include "absl/strings/string_view.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+/**
+ * An empty LevelDB database in the LevelDB test directory, destroyed again
+ * when this object goes out of scope.
+ */
+class ScratchLevelDb {
+ public:
+  explicit ScratchLevelDb(absl::string_view name,
+                          leveldb::Options options = leveldb::Options{}) {
+    std::string test_dir;
+    leveldb::Status status =
+        leveldb::Env::Default()->GetTestDirectory(&test_dir);
+    HARD_ASSERT(status.ok(), "Failed to find test directory: %s",
+                status.ToString());
+    path_ = test_dir + "/" + std::string{name};
+
+    leveldb::DestroyDB(path_, options);
+
+    options.create_if_missing = true;
+    leveldb::DB* db = nullptr;
+    status = leveldb::DB::Open(options, path_, &db);
+    HARD_ASSERT(status.ok(), "Failed to open %s: %s", path_,
+                status.ToString());
+    db_.reset(db);
+  }
+
+  ~ScratchLevelDb() {
+    db_.reset();
+    leveldb::DestroyDB(path_, leveldb::Options{});
+  }
+
+  ScratchLevelDb(const ScratchLevelDb&) = delete;
+  ScratchLevelDb& operator=(const ScratchLevelDb&) = delete;
+
+  leveldb::DB* get() const {
+    return db_.get();
+  }
+
+ private:
+  std::string path_;
+  std::unique_ptr<leveldb::DB> db_;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_TEST_FIREBASE_FIRESTORE_BENCHMARKS_SCRATCH_LEVELDB_H_
@@ -0,0 +1,328 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Firestore/Protos/nanopb/google/firestore/v1beta1/firestore.nanopb.h"
+#include "Firestore/core/include/firebase/firestore/timestamp.h"
+#include "Firestore/core/src/firebase/firestore/model/database_id.h"
+#include "Firestore/core/src/firebase/firestore/model/document_key.h"
+#include "Firestore/core/src/firebase/firestore/model/field_value.h"
+#include "Firestore/core/src/firebase/firestore/model/maybe_document.h"
+#include "Firestore/core/src/firebase/firestore/nanopb/reader.h"
+#include "Firestore/core/src/firebase/firestore/nanopb/writer.h"
+#include "Firestore/core/src/firebase/firestore/remote/serializer.h"
+#include "Firestore/core/src/firebase/firestore/util/hard_assert.h"
+#include "Firestore/core/src/firebase/firestore/util/status.h"
+#include "Firestore/core/src/firebase/firestore/util/statusor.h"
+#include "Firestore/core/test/firebase/firestore/benchmarks/allocation_counter.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+using model::DatabaseId;
+using model::DocumentKey;
+using model::FieldValue;
+using model::MaybeDocument;
+using model::ObjectValue;
+using nanopb::Reader;
+using nanopb::Writer;
+
+namespace {
+
+/**
+ * Creates an object nested `depth` maps deep, where each level has a few
+ * scalar fields alongside the nested map.
+ */
+FieldValue NestedObject(int depth) {
+  FieldValue result = FieldValue::ObjectValueFromMap({
+      {"leaf", FieldValue::StringValue("leaf value")},
+  });
+  for (int i = 0; i < depth; i++) {
+    result = FieldValue::ObjectValueFromMap({
+        {"count", FieldValue::IntegerValue(i)},
+        {"enabled", FieldValue::TrueValue()},
+        {"name", FieldValue::StringValue("level " + std::to_string(i))},
+        {"nested", result},
+    });
+  }
+  return result;
+}
+
+/**
+ * Creates the contents of a typical chat message document: a few dozen
+ * scalar fields plus a couple of small nested maps.
+ */
+ObjectValue::Map RealisticDocumentData() {
+  ObjectValue::Map data{
+      {"author", FieldValue::ObjectValueFromMap({
+                     {"display_name", FieldValue::StringValue("Jane Doe")},
+                     {"uid", FieldValue::StringValue("8fJ3kL0pQzXw2vB7nR1s")},
+                     {"verified", FieldValue::TrueValue()},
+                 })},
+      {"created", FieldValue::TimestampValue(Timestamp{1530000000, 123000})},
+      {"edited", FieldValue::FalseValue()},
+      {"reactions", FieldValue::ObjectValueFromMap({
+                        {"heart", FieldValue::IntegerValue(12)},
+                        {"laugh", FieldValue::IntegerValue(3)},
+                        {"thumbs_up", FieldValue::IntegerValue(27)},
+                    })},
+      {"text", FieldValue::StringValue(std::string(280, 'x'))},
+  };
+  for (int i = 0; i < 20; i++) {
+    data = data.insert("attribute_" + std::to_string(i),
+                       FieldValue::StringValue("value " + std::to_string(i)));
+  }
+  return data;
+}
+
+/**
+ * Encodes a BatchGetDocumentsResponse containing a realistic document, as
+ * consumed by Serializer::DecodeMaybeDocument().
+ */
+std::vector<uint8_t> EncodeRealisticResponse(const Serializer& serializer) {
+  std::vector<uint8_t> document_bytes;
+  util::Status status = serializer.EncodeDocument(
+      DocumentKey::FromPathString("rooms/firestore/messages/abcdefghij"),
+      FieldValue::ObjectValueFromMap(RealisticDocumentData()).object_value(),
+      &document_bytes);
+  HARD_ASSERT(status.ok(), "Failed to encode document: %s", status.ToString());
+
+  std::vector<uint8_t> bytes;
+  Writer writer = Writer::Wrap(&bytes);
+  writer.WriteTag(
+      {PB_WT_STRING,
+       google_firestore_v1beta1_BatchGetDocumentsResponse_found_tag});
+  writer.WriteSize(document_bytes.size());
+  bytes.insert(bytes.end(), document_bytes.begin(), document_bytes.end());
+  return bytes;
+}
+
+/**
+ * Encodes a BatchGetDocumentsResponse containing a large document: 100 string
+ * fields of `string_size` bytes each, at the end of a long document name.
+ */
+std::vector<uint8_t> EncodeLargeResponse(const Serializer& serializer,
+                                         size_t string_size) {
+  ObjectValue::Map data;
+  for (int i = 0; i < 100; i++) {
+    data = data.insert("field_" + std::to_string(i),
+                       FieldValue::StringValue(std::string(string_size, 'x')));
+  }
+
+  std::vector<uint8_t> document_bytes;
+  util::Status status = serializer.EncodeDocument(
+      DocumentKey::FromPathString(
+          "users/8fJ3kL0pQzXw2vB7nR1s/projects/kL0pQzXw2vB7nR1s8fJ3/"
+          "snapshots/pQzXw2vB7nR1s8fJ3kL0"),
+      FieldValue::ObjectValueFromMap(std::move(data)).object_value(),
+      &document_bytes);
+  HARD_ASSERT(status.ok(), "Failed to encode document: %s", status.ToString());
+
+  std::vector<uint8_t> bytes;
+  Writer writer = Writer::Wrap(&bytes);
+  writer.WriteTag(
+      {PB_WT_STRING,
+       google_firestore_v1beta1_BatchGetDocumentsResponse_found_tag});
+  writer.WriteSize(document_bytes.size());
+  bytes.insert(bytes.end(), document_bytes.begin(), document_bytes.end());
+  return bytes;
+}
+
+/**
+ * Reports the average number of heap allocations made per iteration, given
+ * the total made over all iterations.
+ */
+void ReportAllocations(benchmark::State& state, size_t allocations) {
+  if (state.iterations() > 0) {
+    state.counters["allocations"] =
+        static_cast<double>(allocations) / state.iterations();
+  }
+}
+
+}  // namespace
+
+static void BM_EncodeNestedObject(benchmark::State& state) {
+  DatabaseId database_id{"p", "d"};
+  Serializer serializer{database_id};
+  int depth = static_cast<int>(state.range(0));
+  FieldValue value = NestedObject(depth);
+
+  std::vector<uint8_t> bytes;
+  for (auto _ : state) {
+    bytes.clear();
+    util::Status status = serializer.EncodeFieldValue(value, &bytes);
+    if (!status.ok()) {
+      state.SkipWithError(status.error_message().c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(bytes.data());
+  }
+
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(bytes.size()));
+  state.SetComplexityN(depth);
+}
+BENCHMARK(BM_EncodeNestedObject)->DenseRange(1, 16)->Complexity();
+
+/**
+ * Decodes objects nested `depth` levels deep. Each level holds the same few
+ * fields, so the allocations reported should grow linearly with depth; faster
+ * growth means decoding copies values it has already built.
+ */
+static void BM_DecodeNestedObject(benchmark::State& state) {
+  DatabaseId database_id{"p", "d"};
+  Serializer serializer{database_id};
+  int depth = static_cast<int>(state.range(0));
+
+  std::vector<uint8_t> bytes;
+  util::Status status =
+      serializer.EncodeFieldValue(NestedObject(depth), &bytes);
+  HARD_ASSERT(status.ok(), "Failed to encode value: %s", status.ToString());
+
+  size_t allocations = 0;
+  for (auto _ : state) {
+    size_t before = AllocationCount();
+    util::StatusOr<FieldValue> value = serializer.DecodeFieldValue(bytes);
+    allocations += AllocationCount() - before;
+    if (!value.ok()) {
+      state.SkipWithError(value.status().error_message().c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(value.ValueOrDie());
+  }
+
+  ReportAllocations(state, allocations);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(bytes.size()));
+  state.SetComplexityN(depth);
+}
+BENCHMARK(BM_DecodeNestedObject)->DenseRange(1, 16)->Complexity();
+
+static void BM_EncodeDocument(benchmark::State& state) {
+  DatabaseId database_id{"p", "d"};
+  Serializer serializer{database_id};
+  DocumentKey key =
+      DocumentKey::FromPathString("rooms/firestore/messages/abcdefghij");
+  FieldValue value = FieldValue::ObjectValueFromMap(RealisticDocumentData());
+  ObjectValue object_value = value.object_value();
+
+  std::vector<uint8_t> bytes;
+  for (auto _ : state) {
+    bytes.clear();
+    util::Status status = serializer.EncodeDocument(key, object_value, &bytes);
+    if (!status.ok()) {
+      state.SkipWithError(status.error_message().c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(bytes.data());
+  }
+
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(bytes.size()));
+}
+BENCHMARK(BM_EncodeDocument);
+
+/**
+ * Decodes a typical document, reporting the heap allocations made for each
+ * one: the per-document cost of decoding a query result.
+ */
+static void BM_DecodeMaybeDocument(benchmark::State& state) {
+  DatabaseId database_id{"p", "d"};
+  Serializer serializer{database_id};
+  std::vector<uint8_t> bytes = EncodeRealisticResponse(serializer);
+
+  size_t allocations = 0;
+  for (auto _ : state) {
+    size_t before = AllocationCount();
+    util::StatusOr<std::unique_ptr<MaybeDocument>> maybe_doc =
+        serializer.DecodeMaybeDocument(bytes);
+    allocations += AllocationCount() - before;
+    if (!maybe_doc.ok()) {
+      state.SkipWithError(maybe_doc.status().error_message().c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(maybe_doc.ValueOrDie().get());
+  }
+
+  ReportAllocations(state, allocations);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(bytes.size()));
+}
+BENCHMARK(BM_DecodeMaybeDocument);
+
+static void BM_DecodeLargeDocument(benchmark::State& state) {
+  DatabaseId database_id{"p", "d"};
+  Serializer serializer{database_id};
+  std::vector<uint8_t> bytes =
+      EncodeLargeResponse(serializer, static_cast<size_t>(state.range(0)));
+
+  size_t allocations = 0;
+  for (auto _ : state) {
+    size_t before = AllocationCount();
+    util::StatusOr<std::unique_ptr<MaybeDocument>> maybe_doc =
+        serializer.DecodeMaybeDocument(bytes.data(), bytes.size());
+    allocations += AllocationCount() - before;
+    if (!maybe_doc.ok()) {
+      state.SkipWithError(maybe_doc.status().error_message().c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(maybe_doc.ValueOrDie().get());
+  }
+
+  ReportAllocations(state, allocations);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(bytes.size()));
+}
+BENCHMARK(BM_DecodeLargeDocument)->RangeMultiplier(8)->Range(8, 8 << 12);
+
+static void BM_ReadString(benchmark::State& state) {
+  std::vector<uint8_t> bytes = EncodeLargeResponse(
+      Serializer{DatabaseId{"p", "d"}}, static_cast<size_t>(state.range(0)));
+
+  for (auto _ : state) {
+    Reader reader = Reader::Wrap(bytes.data(), bytes.size());
+    reader.ReadTag();
+    benchmark::DoNotOptimize(reader.ReadString());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(bytes.size()));
+}
+BENCHMARK(BM_ReadString)->RangeMultiplier(8)->Range(8, 8 << 12);
+
+static void BM_ReadStringView(benchmark::State& state) {
+  std::vector<uint8_t> bytes = EncodeLargeResponse(
+      Serializer{DatabaseId{"p", "d"}}, static_cast<size_t>(state.range(0)));
+
+  for (auto _ : state) {
+    Reader reader = Reader::Wrap(bytes.data(), bytes.size());
+    reader.ReadTag();
+    benchmark::DoNotOptimize(reader.ReadStringView());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(bytes.size()));
+}
+BENCHMARK(BM_ReadStringView)->RangeMultiplier(8)->Range(8, 8 << 12);
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
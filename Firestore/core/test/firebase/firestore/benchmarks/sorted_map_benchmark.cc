@@ -0,0 +1,304 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Firestore/core/src/firebase/firestore/immutable/array_sorted_map.h"
+#include "Firestore/core/src/firebase/firestore/immutable/sorted_map.h"
+#include "Firestore/core/src/firebase/firestore/immutable/sorted_map_base.h"
+#include "Firestore/core/src/firebase/firestore/immutable/tree_sorted_map.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace immutable {
+
+using IntMap = SortedMap<int, int>;
+
+namespace {
+
+constexpr int kFixedSize = static_cast<int>(impl::SortedMapBase::kFixedSize);
+constexpr int kMaxTreeSize =
+    static_cast<int>(impl::SortedMapBase::kMaxTreeSize);
+
+/**
+ * Map sizes straddling the switches from the array to the tree representation
+ * at kFixedSize and from the tree to the B-tree at kMaxTreeSize, plus a few
+ * larger sizes.
+ */
+void MapSizes(benchmark::internal::Benchmark* b) {
+  for (int size : {1, 8, kFixedSize - 1, kFixedSize, kFixedSize + 1,
+                   kFixedSize * 2, kMaxTreeSize, kMaxTreeSize + 1, 10000,
+                   100000}) {
+    b->Arg(size);
+  }
+}
+
+/**
+ * Small map sizes, covering each of the array's capacity classes and the
+ * switch to the tree.
+ */
+void SmallMapSizes(benchmark::internal::Benchmark* b) {
+  for (int size : {0, 1, 2, 3, 4, 6, 8, 12, 16, 20, kFixedSize, kFixedSize + 1,
+                   kFixedSize * 2, 100}) {
+    b->Arg(size);
+  }
+}
+
+/** Creates a map containing the even numbers in [0, 2 * size). */
+IntMap EvenMap(int size) {
+  IntMap map;
+  for (int i = 0; i < size; i++) {
+    map = map.insert(i * 2, i);
+  }
+  return map;
+}
+
+/**
+ * Reports the memory used by a map of the given size, not counting the
+ * entries' contents: maps up to kFixedSize are a single array of the smallest
+ * capacity that fits, and maps up to kMaxTreeSize allocate one tree node per
+ * entry. Empty maps share one array and B-tree nodes are shared by a varying
+ * number of entries, so those sizes report nothing.
+ */
+void SetBytesPerEntry(benchmark::State& state, int size) {
+  double bytes;
+  if (size == 0 || size > kMaxTreeSize) {
+    return;
+  } else if (size <= kFixedSize) {
+    using array_type = impl::ArraySortedMap<int, int>::array_type;
+    auto capacity = array_type::CapacityFor(static_cast<size_t>(size));
+    bytes = sizeof(array_type) +
+            capacity * sizeof(impl::ArraySortedMap<int, int>::value_type);
+  } else {
+    bytes = static_cast<double>(size) *
+            impl::TreeSortedMap<int, int>::node_type::node_size();
+  }
+  state.counters["bytes_per_entry"] = bytes / size;
+}
+
+}  // namespace
+
+static void BM_SortedMapInsert(benchmark::State& state) {
+  int size = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    IntMap map;
+    for (int i = 0; i < size; i++) {
+      map = map.insert(i, i);
+    }
+    benchmark::DoNotOptimize(map);
+  }
+  state.SetItemsProcessed(state.iterations() * size);
+  SetBytesPerEntry(state, size);
+}
+BENCHMARK(BM_SortedMapInsert)->Apply(MapSizes);
+
+/**
+ * Builds a small map by successive inserts and then looks up each of its keys,
+ * reporting the memory the finished map uses per entry.
+ */
+static void BM_SortedMapSmall(benchmark::State& state) {
+  int size = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    IntMap map;
+    for (int i = 0; i < size; i++) {
+      map = map.insert(i, i);
+    }
+    for (int i = 0; i < size; i++) {
+      benchmark::DoNotOptimize(map.find(i));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * size);
+  SetBytesPerEntry(state, size);
+}
+BENCHMARK(BM_SortedMapSmall)->Apply(SmallMapSizes);
+
+static void BM_SortedMapTransientInsert(benchmark::State& state) {
+  int size = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    IntMap::Transient transient = IntMap{}.transient();
+    for (int i = 0; i < size; i++) {
+      transient.insert(i, i);
+    }
+    benchmark::DoNotOptimize(std::move(transient).persistent());
+  }
+  state.SetItemsProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_SortedMapTransientInsert)->Apply(MapSizes);
+
+static void BM_SortedMapFromSortedRange(benchmark::State& state) {
+  int size = static_cast<int>(state.range(0));
+  std::vector<std::pair<int, int>> entries;
+  for (int i = 0; i < size; i++) {
+    entries.emplace_back(i, i);
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        IntMap::FromSortedRange(entries.begin(), entries.end()));
+  }
+  state.SetItemsProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_SortedMapFromSortedRange)->Apply(MapSizes);
+
+/**
+ * Inserts `state.range(0)` odd keys into a map of as many even keys, either
+ * one at a time or with insert_all.
+ */
+void InsertBatch(benchmark::State& state, bool use_insert_all) {
+  int size = static_cast<int>(state.range(0));
+  IntMap map = EvenMap(size);
+  std::vector<std::pair<int, int>> batch;
+  for (int i = 0; i < size; i++) {
+    batch.emplace_back(i * 2 + 1, i);
+  }
+
+  for (auto _ : state) {
+    if (use_insert_all) {
+      benchmark::DoNotOptimize(map.insert_all(batch));
+    } else {
+      IntMap result = map;
+      for (const auto& entry : batch) {
+        result = result.insert(entry.first, entry.second);
+      }
+      benchmark::DoNotOptimize(result);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_SortedMapInsertBatchOneAtATime(benchmark::State& state) {
+  InsertBatch(state, /*use_insert_all=*/false);
+}
+BENCHMARK(BM_SortedMapInsertBatchOneAtATime)->Apply(MapSizes);
+
+static void BM_SortedMapInsertAll(benchmark::State& state) {
+  InsertBatch(state, /*use_insert_all=*/true);
+}
+BENCHMARK(BM_SortedMapInsertAll)->Apply(MapSizes);
+
+static void BM_SortedMapEraseAll(benchmark::State& state) {
+  int size = static_cast<int>(state.range(0));
+  IntMap map = EvenMap(size);
+  std::vector<int> keys;
+  for (int i = 0; i < size; i += 2) {
+    keys.push_back(i * 2);
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.erase_all(keys));
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_SortedMapEraseAll)->Apply(MapSizes);
+
+static void BM_SortedMapInsertIntoExisting(benchmark::State& state) {
+  int size = static_cast<int>(state.range(0));
+  IntMap map = EvenMap(size);
+  int key = size | 1;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.insert(key, key));
+  }
+}
+BENCHMARK(BM_SortedMapInsertIntoExisting)->Apply(MapSizes);
+
+static void BM_SortedMapErase(benchmark::State& state) {
+  int size = static_cast<int>(state.range(0));
+  IntMap map = EvenMap(size);
+  int key = size & ~1;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.erase(key));
+  }
+}
+BENCHMARK(BM_SortedMapErase)->Apply(MapSizes);
+
+static void BM_SortedMapEraseRange(benchmark::State& state) {
+  int size = static_cast<int>(state.range(0));
+  IntMap map = EvenMap(size);
+  // Erases the middle half of the map.
+  int start = size / 2;
+  int end = size + size / 2;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.erase_range(start, end));
+  }
+}
+BENCHMARK(BM_SortedMapEraseRange)->Apply(MapSizes);
+
+static void BM_SortedMapFind(benchmark::State& state) {
+  int size = static_cast<int>(state.range(0));
+  IntMap map = EvenMap(size);
+  int key = size & ~1;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(key));
+  }
+}
+BENCHMARK(BM_SortedMapFind)->Apply(MapSizes);
+
+static void BM_SortedMapAt(benchmark::State& state) {
+  int size = static_cast<int>(state.range(0));
+  IntMap map = EvenMap(size);
+  IntMap::size_type index = map.size() / 2;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.at(index));
+  }
+}
+BENCHMARK(BM_SortedMapAt)->Apply(MapSizes);
+
+static void BM_SortedMapIterate(benchmark::State& state) {
+  int size = static_cast<int>(state.range(0));
+  IntMap map = EvenMap(size);
+  for (auto _ : state) {
+    int sum = 0;
+    for (const auto& entry : map) {
+      sum += entry.second;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_SortedMapIterate)->Apply(MapSizes);
+
+/**
+ * Diffs a map against a version of it with ten keys inserted, as when
+ * computing what changed between two snapshots.
+ */
+static void BM_SortedMapDiff(benchmark::State& state) {
+  int size = static_cast<int>(state.range(0));
+  IntMap old_map = EvenMap(size);
+  IntMap new_map = old_map;
+  for (int i = 0; i < 10; i++) {
+    int key = static_cast<int>(static_cast<int64_t>(size) * 2 * i / 10 + 1);
+    new_map = new_map.insert(key, key);
+  }
+
+  for (auto _ : state) {
+    int changes = 0;
+    auto on_entry = [&changes](const std::pair<int, int>&) { changes++; };
+    IntMap::Diff(
+        old_map, new_map, on_entry, on_entry,
+        [&changes](const std::pair<int, int>&, const std::pair<int, int>&) {
+          changes++;
+        });
+    benchmark::DoNotOptimize(changes);
+  }
+}
+BENCHMARK(BM_SortedMapDiff)->Apply(MapSizes);
+
+}  // namespace immutable
+}  // namespace firestore
+}  // namespace firebase
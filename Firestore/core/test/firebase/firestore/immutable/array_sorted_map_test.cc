@@ -18,6 +18,7 @@
 
 #include <numeric>
 #include <random>
+#include <string>
 
 #include "Firestore/core/src/firebase/firestore/util/secure_random.h"
 
@@ -43,6 +44,37 @@ TEST(ArraySortedMap, ChecksSize) {
   ASSERT_ANY_THROW(map.insert(next, next));
 }
 
+TEST(ArraySortedMap, InitializerListSortsEntries) {
+  IntMap map{{3, 30}, {1, 10}, {2, 20}, {1, 11}};
+
+  std::vector<std::pair<int, int>> expected{{1, 11}, {2, 20}, {3, 30}};
+  ASSERT_EQ(expected, Collect(map));
+}
+
+TEST(ArraySortedMap, GrowsAndShrinksThroughCapacities) {
+  using StringMap = ArraySortedMap<int, std::string>;
+  StringMap map;
+  std::vector<StringMap> maps{map};
+  for (int i = 0; i < static_cast<int>(kFixedSize); i++) {
+    map = map.insert(i, std::to_string(i));
+    maps.push_back(map);
+    ASSERT_LE(map.size(), StringMap::array_type::CapacityFor(map.size()));
+  }
+
+  for (int i = 0; i < static_cast<int>(kFixedSize); i++) {
+    map = map.erase(i);
+    ASSERT_EQ(kFixedSize - i - 1, map.size());
+  }
+
+  // Earlier versions are unaffected by later ones.
+  for (size_t size = 0; size < maps.size(); size++) {
+    ASSERT_EQ(size, maps[size].size());
+    for (int i = 0; i < static_cast<int>(size); i++) {
+      ASSERT_EQ(std::to_string(i), maps[size].find(i)->second);
+    }
+  }
+}
+
 }  // namespace impl
 }  // namespace immutable
 }  // namespace firestore
@@ -0,0 +1,310 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/firebase/firestore/immutable/btree_sorted_map.h"
+
+#include <iterator>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Firestore/core/test/firebase/firestore/immutable/testing.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace immutable {
+namespace impl {
+
+using IntMap = BTreeSortedMap<int, int>;
+using Node = IntMap::node_type;
+
+/**
+ * Checks the invariants of the B-tree rooted at `node`, returning its height,
+ * or -1 if the invariants don't hold.
+ */
+int Height(const Node& node, bool is_root = true) {
+  SortedMapBase::size_type count = node.count();
+  if (count == 0 || count > Node::kMaxCount) return -1;
+  if (!is_root && count < Node::kMinCount) return -1;
+  if (is_root && !node.leaf() && count < 2) return -1;
+
+  if (node.leaf()) {
+    if (node.size() != count) return -1;
+    for (SortedMapBase::size_type i = 1; i < count; i++) {
+      if (node.entry(i - 1).first >= node.entry(i).first) return -1;
+    }
+    return 0;
+  }
+
+  SortedMapBase::size_type size = 0;
+  int height = -1;
+  for (SortedMapBase::size_type i = 0; i < count; i++) {
+    const Node::Child& child = node.child(i);
+    if (child.size != child.node->size()) return -1;
+    if (child.min_key != child.node->min_key()) return -1;
+    if (i > 0 && node.child(i - 1).min_key >= child.min_key) return -1;
+
+    int child_height = Height(*child.node, false);
+    if (child_height < 0) return -1;
+    if (height >= 0 && child_height != height) return -1;
+    height = child_height;
+    size += child.size;
+  }
+  if (node.size() != size) return -1;
+  if (node.height() != static_cast<SortedMapBase::size_type>(height + 1)) {
+    return -1;
+  }
+  return height + 1;
+}
+
+int Height(const IntMap& map) {
+  return map.empty() ? 0 : Height(*map.root());
+}
+
+TEST(BTreeSortedMap, EmptySize) {
+  IntMap map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(0u, map.size());
+  EXPECT_EQ(nullptr, map.root());
+  EXPECT_TRUE(map.begin() == map.end());
+  EXPECT_TRUE(map.max() == map.end());
+}
+
+TEST(BTreeSortedMap, SplitsAndMergesNodes) {
+  IntMap map;
+  int size = static_cast<int>(Node::kMaxCount * Node::kMaxCount * 2);
+  for (int i = 0; i < size; i++) {
+    map = map.insert(i, i);
+    ASSERT_LE(0, Height(map)) << "inserting " << i;
+  }
+  ASSERT_EQ(2, Height(map));
+  ASSERT_EQ(Pairs(Sequence(size)), Collect(map));
+
+  for (int i = 0; i < size; i++) {
+    map = map.erase(i);
+    ASSERT_LE(0, Height(map)) << "erasing " << i;
+  }
+  ASSERT_TRUE(map.empty());
+}
+
+TEST(BTreeSortedMap, RandomUpdatesMatchStdMap) {
+  std::mt19937 rand;
+  std::uniform_int_distribution<int> dist(0, 4999);
+
+  IntMap map;
+  std::map<int, int> expected;
+  for (int i = 0; i < 20000; i++) {
+    int key = dist(rand);
+    if (rand() % 3 == 0) {
+      map = map.erase(key);
+      expected.erase(key);
+    } else {
+      map = map.insert(key, i);
+      expected[key] = i;
+    }
+    ASSERT_EQ(expected.size(), map.size());
+  }
+  ASSERT_LE(0, Height(map));
+
+  std::vector<std::pair<int, int>> entries{expected.begin(), expected.end()};
+  ASSERT_EQ(entries, Collect(map));
+  for (int key = 0; key < 5000; key++) {
+    auto found = expected.find(key);
+    if (found == expected.end()) {
+      ASSERT_TRUE(NotFound(map, key));
+      ASSERT_EQ(IntMap::npos, map.find_index(key));
+    } else {
+      ASSERT_TRUE(Found(map, key, found->second));
+      ASSERT_EQ(std::distance(expected.begin(), found),
+                static_cast<std::ptrdiff_t>(map.find_index(key)));
+    }
+  }
+}
+
+TEST(BTreeSortedMap, UpdatesAreImmutable) {
+  IntMap original = ToMap<IntMap>(Sequence(0, 2000, 2));
+  std::vector<std::pair<int, int>> original_entries = Collect(original);
+
+  IntMap modified = original;
+  for (int key : Shuffled(Sequence(2000))) {
+    modified = modified.insert(key, -key);
+  }
+  for (int key : Shuffled(Sequence(0, 2000, 3))) {
+    modified = modified.erase(key);
+  }
+  ASSERT_LE(0, Height(modified));
+
+  ASSERT_EQ(original_entries, Collect(original));
+  ASSERT_LE(0, Height(original));
+}
+
+TEST(BTreeSortedMap, EraseMissingKeySharesRoot) {
+  IntMap map = ToMap<IntMap>(Sequence(0, 200, 2));
+  ASSERT_EQ(map.root(), map.erase(1).root());
+  ASSERT_EQ(map.root(), map.erase(1000).root());
+}
+
+TEST(BTreeSortedMap, FromSortedRangeIsBalanced) {
+  for (int size : {0, 1, 31, 32, 33, 100, 512, 1023, 1024, 1025, 5000}) {
+    std::vector<std::pair<int, int>> entries = Pairs(Sequence(size));
+    IntMap map = IntMap::FromSortedRange(
+        entries.begin(), static_cast<SortedMapBase::size_type>(size), {});
+
+    ASSERT_EQ(static_cast<size_t>(size), map.size());
+    ASSERT_EQ(entries, Collect(map));
+    ASSERT_LE(0, Height(map)) << "size " << size;
+
+    // The result must remain a valid tree through further modification.
+    IntMap modified = map.insert(size, size).erase(0).erase(size / 2);
+    ASSERT_LE(0, Height(modified)) << "size " << size;
+  }
+}
+
+TEST(BTreeSortedMap, EraseRangeIsBalanced) {
+  std::mt19937 rand;
+  for (int size : {1, 32, 33, 1000, 40000}) {
+    IntMap map = ToMap<IntMap>(Sequence(0, size * 2, 2));
+    std::uniform_int_distribution<int> dist(-2, size * 2 + 2);
+    for (int i = 0; i < 50; i++) {
+      int start = dist(rand);
+      int end = dist(rand);
+
+      std::vector<int> expected;
+      for (int key : Sequence(0, size * 2, 2)) {
+        if (key < start || key >= end) expected.push_back(key);
+      }
+
+      IntMap erased = map.erase_range(start, end);
+      ASSERT_EQ(Pairs(expected), Collect(erased))
+          << "erasing [" << start << ", " << end << ") from " << size;
+      ASSERT_LE(0, Height(erased))
+          << "erasing [" << start << ", " << end << ") from " << size;
+      if (expected.size() == static_cast<size_t>(size)) {
+        ASSERT_EQ(map.root(), erased.root());
+      }
+    }
+  }
+}
+
+namespace {
+
+int comparisons = 0;
+
+/** Compares ints, counting how many comparisons have been made. */
+struct CountingComparator {
+  bool operator()(int lhs, int rhs) const {
+    comparisons++;
+    return lhs < rhs;
+  }
+};
+
+}  // namespace
+
+TEST(BTreeSortedMap, DiffSkipsSharedSubtrees) {
+  using CountingMap = BTreeSortedMap<int, int, CountingComparator>;
+  CountingMap old_map = ToMap<CountingMap>(Sequence(0, 200000, 2));
+  CountingMap new_map =
+      old_map.insert(1001, 1001).erase(50000).insert(150000, -1);
+
+  std::vector<int> removed;
+  std::vector<int> added;
+  std::vector<int> changed;
+  comparisons = 0;
+  CountingMap::Diff(
+      old_map, new_map,
+      [&](const std::pair<int, int>& entry) { removed.push_back(entry.first); },
+      [&](const std::pair<int, int>& entry) { added.push_back(entry.first); },
+      [&](const std::pair<int, int>& entry, const std::pair<int, int>&) {
+        changed.push_back(entry.first);
+      });
+
+  ASSERT_EQ(std::vector<int>{50000}, removed);
+  ASSERT_EQ(std::vector<int>{1001}, added);
+  ASSERT_EQ(std::vector<int>{150000}, changed);
+
+  // Only the copied paths are compared, not all 100,000 entries.
+  ASSERT_LT(comparisons, 1000);
+}
+
+TEST(BTreeSortedMap, LowerBoundAndMax) {
+  IntMap map = ToMap<IntMap>(Sequence(0, 4000, 2));
+  for (int key = -1; key < 4000; key++) {
+    auto found = map.lower_bound(key);
+    int expected = key < 0 ? 0 : key + key % 2;
+    if (expected >= 4000) {
+      ASSERT_TRUE(found == map.end());
+    } else {
+      ASSERT_EQ(expected, found->first) << "key " << key;
+    }
+  }
+  ASSERT_TRUE(map.lower_bound(4000) == map.end());
+  ASSERT_EQ(3998, map.max()->first);
+  ASSERT_EQ(0, map.min()->first);
+
+  ASSERT_EQ(Sequence(100, 200, 2), Collect(map.keys_in(100, 200)));
+}
+
+TEST(BTreeSortedMap, InPlaceUpdatesMatchCopies) {
+  std::vector<int> keys = Shuffled(Sequence(5000));
+  IntMap original = ToMap<IntMap>(Sequence(0, 10000, 2));
+  std::vector<std::pair<int, int>> original_entries = Collect(original);
+
+  IntMap expected = original;
+  IntMap actual = original;
+  for (int key : keys) {
+    expected = expected.insert(key, -key);
+    actual.InsertInPlace(key, -key);
+  }
+  ASSERT_LE(0, Height(actual));
+  ASSERT_EQ(Collect(expected), Collect(actual));
+
+  for (int key : keys) {
+    expected = expected.erase(key * 2);
+    actual.EraseInPlace(key * 2);
+    actual.EraseInPlace(key * 2 + 10001);
+  }
+  ASSERT_LE(0, Height(actual));
+  ASSERT_EQ(Collect(expected), Collect(actual));
+
+  // None of the nodes shared with the original may have been modified.
+  ASSERT_EQ(original_entries, Collect(original));
+  ASSERT_LE(0, Height(original));
+}
+
+TEST(BTreeSortedMap, InPlaceUpdatesReuseUnsharedNodes) {
+  IntMap map = ToMap<IntMap>(Sequence(1000));
+  map.InsertInPlace(0, 1);
+  const Node* root = map.root();
+
+  // The root is now unshared, so updates that don't split or merge it keep it.
+  map.InsertInPlace(500, 1);
+  map.InsertInPlace(1000, 1);
+  map.EraseInPlace(999);
+  ASSERT_EQ(root, map.root());
+  ASSERT_LE(0, Height(map));
+
+  // Erasing a missing key leaves even a shared root alone.
+  IntMap copy = map;
+  copy.EraseInPlace(5000);
+  ASSERT_EQ(root, copy.root());
+}
+
+}  // namespace impl
+}  // namespace immutable
+}  // namespace firestore
+}  // namespace firebase
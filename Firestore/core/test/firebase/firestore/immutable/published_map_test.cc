@@ -0,0 +1,116 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/firebase/firestore/immutable/published_map.h"
+
+#include <atomic>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "Firestore/core/src/firebase/firestore/immutable/sorted_map.h"
+#include "Firestore/core/test/firebase/firestore/immutable/testing.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace immutable {
+
+using IntMap = SortedMap<int, int>;
+
+/** Creates a map of `size` keys, all with the given value. */
+IntMap Version(int size, int value) {
+  std::vector<std::pair<int, int>> entries;
+  for (int i = 0; i < size; i++) {
+    entries.emplace_back(i, value);
+  }
+  return IntMap::FromSortedRange(entries.begin(), entries.end());
+}
+
+TEST(PublishedMap, ReadersSeeTheVersionTheyStartedWith) {
+  PublishedMap<IntMap> published;
+  EXPECT_TRUE(published.Read()->empty());
+
+  published.Publish(ToMap<IntMap>(Sequence(10)));
+  auto reader = published.Read();
+  published.Publish(ToMap<IntMap>(Sequence(20)));
+
+  EXPECT_EQ(Pairs(Sequence(10)), Collect(*reader));
+  EXPECT_EQ(Pairs(Sequence(20)), Collect(*published.Read()));
+  EXPECT_EQ(Pairs(Sequence(20)), Collect(published.Snapshot()));
+}
+
+TEST(PublishedMap, ReclaimsVersionsOnceUnread) {
+  PublishedMap<IntMap> published;
+  published.Publish(Version(100, 1));
+  EXPECT_EQ(0u, published.retired_count());
+
+  {
+    auto reader = published.Read();
+    published.Publish(Version(100, 2));
+    published.Publish(Version(100, 3));
+
+    // The version being read, and any published after it started, are kept.
+    EXPECT_LT(0u, published.retired_count());
+    EXPECT_EQ(1, reader->at(0).second);
+  }
+
+  published.Publish(Version(100, 4));
+  EXPECT_EQ(0u, published.retired_count());
+}
+
+TEST(PublishedMap, ConcurrentReadersSeeWholeVersions) {
+  constexpr int kSize = 200;
+  constexpr int kVersions = 2000;
+  PublishedMap<IntMap> published{Version(kSize, 0)};
+
+  std::atomic<bool> done{false};
+  std::atomic<int> torn_reads{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&] {
+      int last_seen = 0;
+      while (!done) {
+        auto reader = published.Read();
+        int value = reader->begin()->second;
+        if (reader->size() != kSize || value < last_seen) {
+          torn_reads++;
+        }
+        for (const auto& entry : *reader) {
+          if (entry.second != value) {
+            torn_reads++;
+          }
+        }
+        last_seen = value;
+      }
+    });
+  }
+
+  for (int i = 1; i <= kVersions; i++) {
+    published.Publish(Version(kSize, i));
+  }
+  done = true;
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(0, torn_reads.load());
+  EXPECT_EQ(kVersions, published.Read()->begin()->second);
+}
+
+}  // namespace immutable
+}  // namespace firestore
+}  // namespace firebase
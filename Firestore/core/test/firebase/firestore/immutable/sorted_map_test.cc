@@ -23,13 +23,17 @@
 
 #include "Firestore/core/src/firebase/firestore/immutable/sorted_map.h"
 
+#include <algorithm>
+#include <map>
 #include <numeric>
 #include <random>
 #include <type_traits>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/firebase/firestore/immutable/array_sorted_map.h"
+#include "Firestore/core/src/firebase/firestore/immutable/btree_sorted_map.h"
 #include "Firestore/core/src/firebase/firestore/immutable/tree_sorted_map.h"
 #include "Firestore/core/src/firebase/firestore/util/secure_random.h"
 
@@ -55,6 +59,12 @@ struct TestPolicy<impl::ArraySortedMap<int, int>> {
   static const SizeType kLargeSize = SortedMapBase::kFixedSize;
 };
 
+template <>
+struct TestPolicy<impl::BTreeSortedMap<int, int>> {
+  // Large enough for a BTreeSortedMap to need several levels
+  static const SizeType kLargeSize = 2000;
+};
+
 template <typename IntMap>
 class SortedMapTest : public ::testing::Test {
  public:
@@ -70,7 +80,8 @@ class SortedMapTest : public ::testing::Test {
 // NOLINTNEXTLINE: must be a typedef for the gtest macros
 typedef ::testing::Types<SortedMap<int, int>,
                          impl::ArraySortedMap<int, int>,
-                         impl::TreeSortedMap<int, int>>
+                         impl::TreeSortedMap<int, int>,
+                         impl::BTreeSortedMap<int, int>>
     TestedTypes;
 TYPED_TEST_CASE(SortedMapTest, TestedTypes);
 
@@ -270,6 +281,25 @@ TYPED_TEST(SortedMapTest, FindIndex) {
   ASSERT_EQ(5u, map.find_index(50));
 }
 
+TYPED_TEST(SortedMapTest, RankAndIteratorAt) {
+  TypeParam empty;
+  ASSERT_EQ(0u, empty.rank(1));
+  ASSERT_TRUE(empty.iterator_at(0) == empty.end());
+
+  // Odd numbers, so every even number falls between two keys.
+  int n = this->large_number();
+  TypeParam map = ToMap<TypeParam>(Shuffled(Sequence(1, n * 2, 2)));
+  for (int i = 0; i < n; i++) {
+    SizeType index = static_cast<SizeType>(i);
+    ASSERT_EQ(i * 2 + 1, map.iterator_at(index)->first);
+    ASSERT_EQ(index, map.rank(i * 2));
+    ASSERT_EQ(index, map.rank(i * 2 + 1));
+  }
+  ASSERT_EQ(map.size(), map.rank(n * 2));
+  ASSERT_TRUE(map.iterator_at(map.size()) == map.end());
+  ASSERT_TRUE(map.iterator_at(map.size() + 10) == map.end());
+}
+
 TYPED_TEST(SortedMapTest, MinMax) {
   TypeParam empty;
   auto min = empty.min();
@@ -474,6 +504,266 @@ TYPED_TEST(SortedMapTest, KeysIn) {
   ASSERT_SEQ_EQ(Seq(8, 14), map.keys_in(7, 13));   // in between to in between
 }
 
+TEST(SortedMap, FromSortedRange) {
+  using IntMap = SortedMap<int, int>;
+  for (int size : {0, 1, 24, 25, 26, 100, 1000}) {
+    std::vector<std::pair<int, int>> entries = Pairs(Sequence(size));
+    IntMap map = IntMap::FromSortedRange(entries.begin(), entries.end());
+    ASSERT_EQ(entries, Collect(map));
+    ASSERT_TRUE(Found(map, size / 2, size / 2) || size == 0);
+  }
+}
+
+TEST(SortedMap, FromSortedRangeRejectsUnsortedInput) {
+  using IntMap = SortedMap<int, int>;
+  std::vector<std::pair<int, int>> unsorted = Pairs({1, 3, 2});
+  ASSERT_ANY_THROW(IntMap::FromSortedRange(unsorted.begin(), unsorted.end()));
+
+  std::vector<std::pair<int, int>> duplicates = Pairs({1, 2, 2});
+  ASSERT_ANY_THROW(
+      IntMap::FromSortedRange(duplicates.begin(), duplicates.end()));
+}
+
+TEST(SortedMap, CrossesIntoBTree) {
+  using IntMap = SortedMap<int, int>;
+  // Large enough for the B-tree to need several levels.
+  int size = 5000;
+  std::vector<int> keys = Shuffled(Sequence(size));
+
+  IntMap map;
+  for (int key : keys) {
+    map = map.insert(key, key);
+  }
+  ASSERT_EQ(Pairs(Sequence(size)), Collect(map));
+  ASSERT_EQ(Sequence(0, 100), Collect(map.keys_in(0, 100)));
+  for (int key : {0, size / 2, size - 1}) {
+    ASSERT_TRUE(Found(map, key, key));
+    ASSERT_EQ(static_cast<SizeType>(key), map.find_index(key));
+  }
+  ASSERT_EQ(size - 1, map.max()->first);
+
+  for (int key : keys) {
+    map = map.erase(key);
+    ASSERT_TRUE(NotFound(map, key));
+  }
+  ASSERT_TRUE(map.empty());
+}
+
+TEST(SortedMap, RangeAndEraseRange) {
+  using IntMap = SortedMap<int, int>;
+  // Spans the array, tree, and B-tree representations.
+  for (int size : {0, 10, 25, 26, 64, 65, 1000, 5000}) {
+    IntMap map = ToMap<IntMap>(Sequence(0, size * 2, 2));
+    for (int start : {-1, 0, 1, size / 2, size, size * 2 - 2, size * 2}) {
+      for (int end : {-1, 0, 3, size, size + 1, size * 2 - 1, size * 3}) {
+        std::vector<int> in_range;
+        std::vector<int> remaining;
+        for (int key : Sequence(0, size * 2, 2)) {
+          bool inside = key >= start && key < end;
+          (inside ? in_range : remaining).push_back(key);
+        }
+
+        ASSERT_EQ(Pairs(in_range), Collect(map.range(start, end)))
+            << "[" << start << ", " << end << ") of " << size;
+        IntMap erased = map.erase_range(start, end);
+        ASSERT_EQ(Pairs(remaining), Collect(erased))
+            << "[" << start << ", " << end << ") of " << size;
+        for (int key : remaining) {
+          ASSERT_TRUE(Found(erased, key, key));
+        }
+      }
+    }
+  }
+}
+
+TEST(SortedMap, AtAndSlice) {
+  using IntMap = SortedMap<int, int>;
+  // Spans the array, tree, and B-tree representations.
+  for (int size : {0, 10, 25, 26, 64, 65, 1000, 5000}) {
+    IntMap map = ToMap<IntMap>(Shuffled(Sequence(size)));
+    for (int i = 0; i < size; i++) {
+      ASSERT_EQ(std::make_pair(i, i), map.at(static_cast<SizeType>(i)));
+    }
+
+    for (int begin : {0, 1, size / 2, size, size + 1}) {
+      for (int end : {0, 1, size / 2, size, size + 5}) {
+        std::vector<int> expected;
+        for (int i = begin; i < std::min(end, size); i++) {
+          expected.push_back(i);
+        }
+        auto slice = map.slice(static_cast<SizeType>(begin),
+                               static_cast<SizeType>(end));
+        ASSERT_EQ(Pairs(expected), Collect(slice))
+            << "[" << begin << ", " << end << ") of " << size;
+      }
+    }
+  }
+}
+
+TEST(SortedMap, InsertAllMatchesInsert) {
+  using IntMap = SortedMap<int, int>;
+  for (int existing : {0, 10, 25, 100, 1000}) {
+    for (int batch : {0, 1, 10, 100, 2000}) {
+      IntMap map = ToMap<IntMap>(Sequence(0, existing * 2, 2));
+      std::vector<int> added = Shuffled(Sequence(0, batch * 3, 3));
+
+      IntMap expected = map;
+      std::vector<std::pair<int, int>> entries;
+      for (int value : added) {
+        expected = expected.insert(value, -value);
+        entries.emplace_back(value, -value);
+      }
+
+      IntMap actual = map.insert_all(entries);
+      ASSERT_EQ(Collect(expected), Collect(actual))
+          << existing << " existing, " << batch << " added";
+    }
+  }
+}
+
+TEST(SortedMap, InsertAllLastValueWins) {
+  using IntMap = SortedMap<int, int>;
+  IntMap map = IntMap{}.insert_all(
+      std::vector<std::pair<int, int>>{{1, 1}, {2, 2}, {1, 3}, {1, 4}});
+  ASSERT_EQ((std::vector<std::pair<int, int>>{{1, 4}, {2, 2}}), Collect(map));
+}
+
+TEST(SortedMap, EraseAllMatchesErase) {
+  using IntMap = SortedMap<int, int>;
+  for (int existing : {0, 10, 25, 100, 1000}) {
+    for (int batch : {0, 1, 10, 100, 2000}) {
+      IntMap map = ToMap<IntMap>(Sequence(existing));
+      std::vector<int> removed = Shuffled(Sequence(0, batch * 3, 3));
+
+      IntMap expected = map;
+      for (int value : removed) {
+        expected = expected.erase(value);
+      }
+
+      IntMap actual = map.erase_all(removed);
+      ASSERT_EQ(Collect(expected), Collect(actual))
+          << existing << " existing, " << batch << " removed";
+    }
+  }
+}
+
+TEST(SortedMap, TransientMatchesPersistentUpdates) {
+  using IntMap = SortedMap<int, int>;
+  for (int existing : {0, 10, 25, 100, 1000}) {
+    IntMap map = ToMap<IntMap>(Sequence(0, existing * 2, 2));
+    std::vector<std::pair<int, int>> before = Collect(map);
+    std::vector<int> keys = Shuffled(Sequence(existing));
+
+    IntMap expected = map;
+    IntMap::Transient transient = map.transient();
+    for (int key : keys) {
+      expected = expected.insert(key, -key);
+      transient.insert(key, -key);
+    }
+    for (int key : keys) {
+      expected = expected.erase(key * 2);
+      transient.erase(key * 2);
+    }
+    ASSERT_EQ(expected.size(), transient.size());
+
+    IntMap actual = std::move(transient).persistent();
+    ASSERT_EQ(Collect(expected), Collect(actual)) << existing << " existing";
+
+    // The map the transient started from is unaffected.
+    ASSERT_EQ(before, Collect(map));
+  }
+}
+
+TEST(SortedMap, TransientEraseToEmpty) {
+  using IntMap = SortedMap<int, int>;
+  IntMap::Transient transient = ToMap<IntMap>(Sequence(100)).transient();
+  for (int key : Shuffled(Sequence(100))) {
+    ASSERT_TRUE(transient.contains(key));
+    transient.erase(key);
+  }
+  ASSERT_TRUE(transient.empty());
+
+  // Once empty, the map grows from the array representation again.
+  transient.insert(1, 1);
+  IntMap map = std::move(transient).persistent();
+  ASSERT_EQ(Pairs({1}), Collect(map));
+}
+
+TEST(SortedMap, DiffMatchesStdMap) {
+  using IntMap = SortedMap<int, int>;
+  using Entry = std::pair<int, int>;
+  std::mt19937 rand;
+  for (int existing : {0, 10, 25, 60, 100, 5000}) {
+    for (int updates : {0, 1, 10, 500}) {
+      IntMap old_map = ToMap<IntMap>(Sequence(0, existing * 2, 2));
+      std::map<int, int> old_entries{old_map.begin(), old_map.end()};
+
+      IntMap new_map = old_map;
+      std::map<int, int> new_entries = old_entries;
+      std::uniform_int_distribution<int> dist(-1, existing * 2 + 1);
+      for (int i = 0; i < updates; i++) {
+        int key = dist(rand);
+        if (rand() % 3 == 0) {
+          new_map = new_map.erase(key);
+          new_entries.erase(key);
+        } else {
+          // Some of these inserts leave the value as it was.
+          int value = static_cast<int>(rand() % 2) * key;
+          new_map = new_map.insert(key, value);
+          new_entries[key] = value;
+        }
+      }
+
+      std::vector<Entry> expected_removed;
+      std::vector<Entry> expected_added;
+      std::vector<std::pair<Entry, Entry>> expected_changed;
+      for (const auto& entry : old_entries) {
+        auto found = new_entries.find(entry.first);
+        if (found == new_entries.end()) {
+          expected_removed.push_back(entry);
+        } else if (found->second != entry.second) {
+          expected_changed.emplace_back(entry, *found);
+        }
+      }
+      for (const auto& entry : new_entries) {
+        if (old_entries.find(entry.first) == old_entries.end()) {
+          expected_added.push_back(entry);
+        }
+      }
+
+      std::vector<Entry> removed;
+      std::vector<Entry> added;
+      std::vector<std::pair<Entry, Entry>> changed;
+      IntMap::Diff(
+          old_map, new_map,
+          [&](const Entry& entry) { removed.push_back(entry); },
+          [&](const Entry& entry) { added.push_back(entry); },
+          [&](const Entry& old_entry, const Entry& new_entry) {
+            changed.emplace_back(old_entry, new_entry);
+          });
+
+      ASSERT_EQ(expected_removed, removed) << existing << ", " << updates;
+      ASSERT_EQ(expected_added, added) << existing << ", " << updates;
+      ASSERT_EQ(expected_changed, changed) << existing << ", " << updates;
+      ASSERT_EQ(old_entries == new_entries, old_map == new_map);
+    }
+  }
+}
+
+TEST(SortedMap, EqualityAcrossRepresentations) {
+  using IntMap = SortedMap<int, int>;
+  for (int size : {0, 10, 100, 1000}) {
+    IntMap built = ToMap<IntMap>(Sequence(size));
+    std::vector<std::pair<int, int>> entries = Pairs(Sequence(size));
+    IntMap from_range = IntMap::FromSortedRange(entries.begin(), entries.end());
+
+    ASSERT_TRUE(built == from_range) << size;
+    ASSERT_FALSE(built != from_range) << size;
+    ASSERT_FALSE(built == from_range.insert(size, size)) << size;
+    ASSERT_FALSE(built == built.insert(0, -1)) << size;
+  }
+}
+
 }  // namespace immutable
 }  // namespace firestore
 }  // namespace firebase
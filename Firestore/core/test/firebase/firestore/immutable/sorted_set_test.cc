@@ -16,8 +16,11 @@
 
 #include "Firestore/core/src/firebase/firestore/immutable/sorted_set.h"
 
+#include <algorithm>
+#include <iterator>
 #include <random>
 #include <unordered_set>
+#include <vector>
 
 #include "Firestore/core/test/firebase/firestore/immutable/testing.h"
 
@@ -110,6 +113,26 @@ TEST(SortedSetTest, CanBeConstructedFromSortedMap) {
   ASSERT_TRUE(NotFound(map, 2));
 }
 
+TEST(SortedSetTest, FromSortedRange) {
+  std::vector<int> all = Sequence(kLargeNumber);
+  SortedSet<int> set = SortedSet<int>::FromSortedRange(all.begin(), all.end());
+  ASSERT_SEQ_EQ(all, set);
+}
+
+TEST(SortedSetTest, InsertAllAndEraseAll) {
+  std::vector<int> evens = Sequence(0, kLargeNumber, 2);
+  std::vector<int> odds = Sequence(1, kLargeNumber, 2);
+
+  SortedSet<int> set = SortedSet<int>{}.insert_all(Shuffled(evens));
+  ASSERT_SEQ_EQ(evens, set);
+
+  set = set.insert_all(Shuffled(odds));
+  ASSERT_SEQ_EQ(Sequence(kLargeNumber), set);
+
+  set = set.erase_all(Shuffled(evens));
+  ASSERT_SEQ_EQ(odds, set);
+}
+
 TEST(SortedSetTest, Iterator) {
   std::vector<int> all = Sequence(kLargeNumber);
   SortedSet<int> set = ToSet(Shuffled(all));
@@ -170,6 +193,71 @@ TEST(SortedSetTest, ValuesIn) {
   ASSERT_SEQ_EQ(Seq(8, 14), set.values_in(7, 13));   // in between to in between
 }
 
+TEST(SortedSetTest, SetOperationsMatchStdAlgorithms) {
+  // Covers both sets small, one much larger than the other, and both large.
+  for (int lhs_size : {0, 5, 30, 2000}) {
+    for (int rhs_size : {0, 5, 30, 2000}) {
+      std::vector<int> lhs_values = Sequence(0, lhs_size * 2, 2);
+      std::vector<int> rhs_values = Sequence(0, rhs_size * 3, 3);
+      SortedSet<int> lhs = ToSet(Shuffled(lhs_values));
+      SortedSet<int> rhs = ToSet(Shuffled(rhs_values));
+
+      std::vector<int> expected;
+      std::set_union(lhs_values.begin(), lhs_values.end(), rhs_values.begin(),
+                     rhs_values.end(), std::back_inserter(expected));
+      ASSERT_SEQ_EQ(expected, lhs.set_union(rhs));
+
+      expected.clear();
+      std::set_intersection(lhs_values.begin(), lhs_values.end(),
+                            rhs_values.begin(), rhs_values.end(),
+                            std::back_inserter(expected));
+      ASSERT_SEQ_EQ(expected, lhs.set_intersection(rhs));
+
+      expected.clear();
+      std::set_difference(lhs_values.begin(), lhs_values.end(),
+                          rhs_values.begin(), rhs_values.end(),
+                          std::back_inserter(expected));
+      ASSERT_SEQ_EQ(expected, lhs.set_difference(rhs));
+
+      expected.clear();
+      std::set_symmetric_difference(lhs_values.begin(), lhs_values.end(),
+                                    rhs_values.begin(), rhs_values.end(),
+                                    std::back_inserter(expected));
+      ASSERT_SEQ_EQ(expected, lhs.set_symmetric_difference(rhs));
+    }
+  }
+}
+
+TEST(SortedSetTest, SetOperationsShareUnchangedSets) {
+  SortedSet<int> large = ToSet(Sequence(1000));
+  SortedSet<int> subset = ToSet(Sequence(100, 200));
+  SortedSet<int> disjoint = ToSet(Sequence(2000, 2100));
+
+  // When the result equals an input, that input is returned as is, so its
+  // iterators compare equal.
+  ASSERT_TRUE(large.set_union(subset).begin() == large.begin());
+  ASSERT_TRUE(subset.set_union(large).begin() == large.begin());
+  ASSERT_TRUE(large.set_intersection(subset).begin() == subset.begin());
+  ASSERT_TRUE(large.set_difference(disjoint).begin() == large.begin());
+  ASSERT_TRUE(subset.set_difference(disjoint).begin() == subset.begin());
+}
+
+TEST(SortedSetTest, Diff) {
+  SortedSet<int> old_set = ToSet(Sequence(1000));
+  SortedSet<int> new_set = old_set.erase(10).insert(1000).insert(-1).erase(5);
+
+  std::vector<int> removed;
+  std::vector<int> added;
+  SortedSet<int>::Diff(
+      old_set, new_set, [&](int key) { removed.push_back(key); },
+      [&](int key) { added.push_back(key); });
+  ASSERT_EQ((std::vector<int>{5, 10}), removed);
+  ASSERT_EQ((std::vector<int>{-1, 1000}), added);
+
+  ASSERT_FALSE(old_set == new_set);
+  ASSERT_TRUE(old_set == ToSet(Sequence(1000)));
+}
+
 TEST(SortedSetTest, HashesStdHashable) {
   SortedSet<int> set;
 
@@ -16,8 +16,13 @@
 
 #include "Firestore/core/src/firebase/firestore/immutable/tree_sorted_map.h"
 
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
 #include "Firestore/core/src/firebase/firestore/util/secure_random.h"
 #include "Firestore/core/test/firebase/firestore/immutable/testing.h"
+#include "absl/base/config.h"
 #include "gtest/gtest.h"
 
 namespace firebase {
@@ -27,6 +32,23 @@ namespace impl {
 
 using IntMap = TreeSortedMap<int, int>;
 
+/**
+ * Checks the invariants of a left-leaning red-black tree rooted at `node`,
+ * returning its black height, or -1 if the invariants don't hold.
+ */
+int BlackHeight(const IntMap::node_type& node) {
+  if (node.empty()) return 0;
+
+  if (node.right().red()) return -1;
+  if (node.red() && node.left().red()) return -1;
+  if (node.size() != node.left().size() + 1 + node.right().size()) return -1;
+
+  int left = BlackHeight(node.left());
+  int right = BlackHeight(node.right());
+  if (left < 0 || left != right) return -1;
+  return left + (node.red() ? 0 : 1);
+}
+
 TEST(TreeSortedMap, EmptySize) {
   IntMap map;
   EXPECT_TRUE(map.empty());
@@ -221,6 +243,81 @@ TEST(TreeSortedMap, InsertIsImmutable) {
   EXPECT_TRUE(original.root().right().empty());
 }
 
+TEST(TreeSortedMap, SharedNodesOutliveTheirTree) {
+  IntMap modified;
+  {
+    IntMap original = ToMap<IntMap>(Sequence(100));
+    modified = original.insert(100, 100).erase(50);
+  }
+  std::vector<int> expected = Sequence(101);
+  expected.erase(expected.begin() + 50);
+  ASSERT_EQ(Pairs(expected), Collect(modified));
+  ASSERT_LE(0, BlackHeight(modified.root()));
+}
+
+#if ABSL_HAVE_THREAD_LOCAL
+void UpdateThreadLocalMap() {
+  // This is constructed before the thread first returns a node to its pool,
+  // so it's destroyed after the pool's blocks are freed, and releases its own
+  // nodes during thread shutdown.
+  static thread_local IntMap map;
+  map = ToMap<IntMap>(Sequence(100));
+  map = map.erase(50);
+}
+
+TEST(TreeSortedMap, NodesReleasedDuringThreadShutdown) {
+  std::thread thread{UpdateThreadLocalMap};
+  thread.join();
+
+  // This thread's pool is unaffected.
+  IntMap map = ToMap<IntMap>(Sequence(100)).erase(50);
+  ASSERT_EQ(99u, map.size());
+}
+#endif  // ABSL_HAVE_THREAD_LOCAL
+
+TEST(TreeSortedMap, FromSortedRangeIsBalanced) {
+  for (int size = 0; size <= 300; size++) {
+    std::vector<std::pair<int, int>> entries = Pairs(Sequence(size));
+    IntMap map = IntMap::FromSortedRange(
+        entries.begin(), static_cast<SortedMapBase::size_type>(size), {});
+
+    ASSERT_EQ(static_cast<size_t>(size), map.size());
+    ASSERT_EQ(entries, Collect(map));
+    ASSERT_FALSE(map.root().red());
+    ASSERT_LE(0, BlackHeight(map.root())) << "size " << size;
+
+    // The result must remain a valid tree through further modification.
+    IntMap modified = map.insert(size, size).erase(0).erase(size / 2);
+    ASSERT_LE(0, BlackHeight(modified.root())) << "size " << size;
+  }
+}
+
+TEST(TreeSortedMap, InPlaceUpdatesMatchCopies) {
+  std::vector<int> keys = Shuffled(Sequence(500));
+  IntMap original = ToMap<IntMap>(Sequence(0, 1000, 2));
+  std::vector<std::pair<int, int>> original_entries = Collect(original);
+
+  IntMap expected = original;
+  IntMap actual = original;
+  for (int key : keys) {
+    expected = expected.insert(key, -key);
+    actual.InsertInPlace(key, -key);
+    ASSERT_LE(0, BlackHeight(actual.root())) << "inserting " << key;
+  }
+  ASSERT_EQ(Collect(expected), Collect(actual));
+
+  for (int key : keys) {
+    expected = expected.erase(key * 2);
+    actual.EraseInPlace(key * 2);
+    ASSERT_LE(0, BlackHeight(actual.root())) << "erasing " << key * 2;
+  }
+  ASSERT_EQ(Collect(expected), Collect(actual));
+
+  // None of the nodes shared with the original may have been modified.
+  ASSERT_EQ(original_entries, Collect(original));
+  ASSERT_LE(0, BlackHeight(original.root()));
+}
+
 }  // namespace impl
 }  // namespace immutable
 }  // namespace firestore
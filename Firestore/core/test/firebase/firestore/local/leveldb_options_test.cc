@@ -0,0 +1,144 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/firebase/firestore/local/leveldb_options.h"
+
+#include <memory>
+#include <string>
+
+#include "Firestore/core/src/firebase/firestore/local/leveldb_transaction.h"
+#include "gtest/gtest.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+TEST(LevelDbOptionsTest, Defaults) {
+  LevelDbConfig config;
+  const leveldb::Options& options = config.open_options();
+  leveldb::Options defaults;
+
+  EXPECT_TRUE(options.create_if_missing);
+  EXPECT_EQ(nullptr, options.block_cache);
+  EXPECT_NE(nullptr, options.filter_policy);
+  EXPECT_NE(nullptr, options.env);
+  EXPECT_EQ(defaults.write_buffer_size, options.write_buffer_size);
+  EXPECT_EQ(defaults.max_open_files, options.max_open_files);
+  EXPECT_EQ(defaults.compression, options.compression);
+
+  EXPECT_TRUE(config.read_options().verify_checksums);
+  EXPECT_TRUE(config.scan_options().verify_checksums);
+  EXPECT_TRUE(config.scan_options().fill_cache);
+}
+
+TEST(LevelDbOptionsTest, AppliesTuning) {
+  LevelDbOptions tuning;
+  tuning.block_cache_bytes = 32 * 1024 * 1024;
+  tuning.bloom_filter_bits_per_key = 0;
+  tuning.write_buffer_bytes = 1024 * 1024;
+  tuning.max_open_files = 100;
+  tuning.compression = false;
+  tuning.fill_cache_on_scans = false;
+
+  LevelDbConfig config{tuning};
+  const leveldb::Options& options = config.open_options();
+  EXPECT_NE(nullptr, options.block_cache);
+  EXPECT_EQ(nullptr, options.filter_policy);
+  EXPECT_EQ(1024u * 1024u, options.write_buffer_size);
+  EXPECT_EQ(100, options.max_open_files);
+  EXPECT_EQ(leveldb::kNoCompression, options.compression);
+
+  EXPECT_TRUE(config.read_options().fill_cache);
+  EXPECT_FALSE(config.scan_options().fill_cache);
+}
+
+TEST(LevelDbOptionsTest, VerifiesChecksumsPerPolicy) {
+  LevelDbOptions tuning;
+
+  tuning.verify_checksums = ChecksumVerification::kNone;
+  LevelDbConfig none{tuning};
+  EXPECT_FALSE(none.read_options().verify_checksums);
+  EXPECT_FALSE(none.scan_options().verify_checksums);
+
+  tuning.verify_checksums = ChecksumVerification::kPointReads;
+  LevelDbConfig point_reads{tuning};
+  EXPECT_TRUE(point_reads.read_options().verify_checksums);
+  EXPECT_FALSE(point_reads.scan_options().verify_checksums);
+
+  tuning.verify_checksums = ChecksumVerification::kAll;
+  LevelDbConfig all{tuning};
+  EXPECT_TRUE(all.read_options().verify_checksums);
+  EXPECT_TRUE(all.scan_options().verify_checksums);
+}
+
+TEST(LevelDbOptionsTest, CountsTableReads) {
+  LevelDbConfig config;
+  leveldb::Env* env = config.open_options().env;
+  std::string dir;
+  ASSERT_TRUE(env->GetTestDirectory(&dir).ok());
+  std::string path = dir + "/LevelDbOptionsTest_CountsTableReads";
+  ASSERT_TRUE(leveldb::WriteStringToFile(env, "contents", path).ok());
+
+  leveldb::RandomAccessFile* opened = nullptr;
+  ASSERT_TRUE(env->NewRandomAccessFile(path, &opened).ok());
+  std::unique_ptr<leveldb::RandomAccessFile> file{opened};
+  char scratch[8];
+  leveldb::Slice result;
+  ASSERT_TRUE(file->Read(0, 4, &result, scratch).ok());
+  ASSERT_TRUE(file->Read(4, 4, &result, scratch).ok());
+  EXPECT_EQ("ents", result.ToString());
+  EXPECT_EQ(2, config.stats().block_reads.load());
+
+  file.reset();
+  env->DeleteFile(path);
+}
+
+TEST(LevelDbOptionsTest, TransactionsCountLookups) {
+  LevelDbConfig config;
+  std::string dir;
+  ASSERT_TRUE(config.open_options().env->GetTestDirectory(&dir).ok());
+  std::string path = dir + "/LevelDbOptionsTest_TransactionsCountLookups";
+  leveldb::DestroyDB(path, config.open_options());
+
+  leveldb::DB* opened = nullptr;
+  ASSERT_TRUE(leveldb::DB::Open(config.open_options(), path, &opened).ok());
+  std::unique_ptr<leveldb::DB> db{opened};
+  {
+    LevelDbTransaction txn(db.get(), "Populate", config);
+    txn.Put("present", "value");
+    txn.Commit();
+  }
+
+  LevelDbTransaction txn(db.get(), "Lookups", config);
+  txn.Put("pending", "value");
+  std::string value;
+  EXPECT_TRUE(txn.Get("present", &value).ok());
+  EXPECT_TRUE(txn.Get("absent", &value).IsNotFound());
+  // Lookups answered by the transaction's own changes don't reach LevelDB.
+  EXPECT_TRUE(txn.Get("pending", &value).ok());
+
+  EXPECT_EQ(2, config.stats().lookups.load());
+  EXPECT_EQ(1, config.stats().misses.load());
+
+  db.reset();
+  leveldb::DestroyDB(path, config.open_options());
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/firebase/firestore/local/leveldb_remote_document_cache.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Firestore/core/src/firebase/firestore/local/leveldb_transaction.h"
+#include "Firestore/core/src/firebase/firestore/local/local_serializer.h"
+#include "Firestore/core/src/firebase/firestore/model/database_id.h"
+#include "Firestore/core/src/firebase/firestore/model/document.h"
+#include "Firestore/core/src/firebase/firestore/model/no_document.h"
+#include "Firestore/core/src/firebase/firestore/remote/serializer.h"
+#include "Firestore/core/test/firebase/firestore/testutil/testutil.h"
+#include "gtest/gtest.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+using model::DatabaseId;
+using model::Document;
+using model::MaybeDocument;
+using model::NoDocument;
+using testutil::DeletedDoc;
+using testutil::Doc;
+using testutil::Key;
+using testutil::Resource;
+
+class LevelDbRemoteDocumentCacheTest : public ::testing::Test {
+ public:
+  LevelDbRemoteDocumentCacheTest()
+      : remote_serializer_{DatabaseId{"p", "d"}},
+        serializer_{remote_serializer_} {
+    std::string dir;
+    leveldb::Status status =
+        leveldb::Env::Default()->GetTestDirectory(&dir);
+    EXPECT_TRUE(status.ok());
+    path_ = dir + "/LevelDbRemoteDocumentCacheTest";
+    leveldb::DestroyDB(path_, leveldb::Options{});
+
+    leveldb::Options options;
+    options.create_if_missing = true;
+    leveldb::DB* db = nullptr;
+    status = leveldb::DB::Open(options, path_, &db);
+    EXPECT_TRUE(status.ok());
+    db_.reset(db);
+  }
+
+  ~LevelDbRemoteDocumentCacheTest() {
+    db_.reset();
+    leveldb::DestroyDB(path_, leveldb::Options{});
+  }
+
+  /** Commits the given documents and deleted documents to the database. */
+  void Commit(const std::vector<Document>& documents,
+              const std::vector<NoDocument>& deleted = {}) {
+    LevelDbTransaction txn(db_.get(), "Commit");
+    LevelDbRemoteDocumentCache cache(&txn, &serializer_);
+    for (const Document& document : documents) {
+      cache.Add(document);
+    }
+    for (const NoDocument& document : deleted) {
+      cache.Add(document);
+    }
+    txn.Commit();
+  }
+
+  /** Returns the keys a scan of `collection` visits, in order. */
+  std::vector<std::string> ScannedKeys(LevelDbRemoteDocumentCache* cache,
+                                       absl::string_view collection) {
+    std::vector<std::string> result;
+    auto scan = cache->ScanCollection(Resource(collection));
+    for (; scan.Valid(); scan.Next()) {
+      result.push_back(scan.key().ToString());
+    }
+    return result;
+  }
+
+ protected:
+  remote::Serializer remote_serializer_;
+  LocalSerializer serializer_;
+  std::string path_;
+  std::unique_ptr<leveldb::DB> db_;
+};
+
+TEST_F(LevelDbRemoteDocumentCacheTest, AddsGetsAndRemovesEntries) {
+  Commit({Doc("rooms/a", 1)}, {DeletedDoc("rooms/b", 2)});
+
+  LevelDbTransaction txn(db_.get(), "Get");
+  LevelDbRemoteDocumentCache cache(&txn, &serializer_);
+  std::unique_ptr<MaybeDocument> found = cache.Get(Key("rooms/a"));
+  ASSERT_NE(nullptr, found);
+  EXPECT_EQ(Doc("rooms/a", 1), *found);
+
+  found = cache.Get(Key("rooms/b"));
+  ASSERT_NE(nullptr, found);
+  EXPECT_EQ(DeletedDoc("rooms/b", 2), *found);
+
+  EXPECT_EQ(nullptr, cache.Get(Key("rooms/c")));
+
+  cache.Remove(Key("rooms/a"));
+  EXPECT_EQ(nullptr, cache.Get(Key("rooms/a")));
+}
+
+TEST_F(LevelDbRemoteDocumentCacheTest, ScanSkipsSubcollections) {
+  Commit({Doc("rooms/a", 1), Doc("rooms/a/messages/1", 1),
+          Doc("rooms/a/messages/2", 1), Doc("rooms/b", 1),
+          Doc("rooms/b/messages/1/reactions/1", 1), Doc("rooms/c", 1),
+          Doc("roomsx/a", 1), Doc("users/a", 1)});
+
+  LevelDbTransaction txn(db_.get(), "Scan");
+  LevelDbRemoteDocumentCache cache(&txn, &serializer_);
+  std::vector<std::string> expected{"rooms/a", "rooms/b", "rooms/c"};
+  EXPECT_EQ(expected, ScannedKeys(&cache, "rooms"));
+
+  auto scan = cache.ScanCollection(Resource("rooms"));
+  while (scan.Valid()) {
+    scan.Next();
+  }
+  EXPECT_EQ(2u, scan.skipped_subtrees());
+
+  expected = {"rooms/a/messages/1", "rooms/a/messages/2"};
+  EXPECT_EQ(expected, ScannedKeys(&cache, "rooms/a/messages"));
+
+  EXPECT_TRUE(ScannedKeys(&cache, "empty").empty());
+}
+
+TEST_F(LevelDbRemoteDocumentCacheTest, ScanSeesPendingChanges) {
+  Commit({Doc("rooms/a", 1), Doc("rooms/b", 1), Doc("rooms/b/messages/1", 1)});
+
+  LevelDbTransaction txn(db_.get(), "Scan");
+  LevelDbRemoteDocumentCache cache(&txn, &serializer_);
+  cache.Remove(Key("rooms/a"));
+  cache.Add(Doc("rooms/b/messages/2", 2));
+  cache.Add(Doc("rooms/c", 2));
+
+  std::vector<std::string> expected{"rooms/b", "rooms/c"};
+  EXPECT_EQ(expected, ScannedKeys(&cache, "rooms"));
+}
+
+TEST_F(LevelDbRemoteDocumentCacheTest, GetCollectionOmitsDeletedDocuments) {
+  Commit({Doc("rooms/a", 1), Doc("rooms/c", 3), Doc("rooms/c/messages/1", 3)},
+         {DeletedDoc("rooms/b", 2)});
+
+  LevelDbTransaction txn(db_.get(), "GetCollection");
+  LevelDbRemoteDocumentCache cache(&txn, &serializer_);
+  std::vector<std::unique_ptr<Document>> documents =
+      cache.GetCollection(Resource("rooms"));
+  ASSERT_EQ(2u, documents.size());
+  EXPECT_EQ(Doc("rooms/a", 1), *documents[0]);
+  EXPECT_EQ(Doc("rooms/c", 3), *documents[1]);
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
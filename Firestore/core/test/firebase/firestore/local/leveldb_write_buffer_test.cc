@@ -0,0 +1,167 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/firebase/firestore/local/leveldb_write_buffer.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+namespace {
+
+/** Describes each change in the buffer, in order, as "key=value" or "-key". */
+std::vector<std::string> Changes(const LevelDbWriteBuffer& buffer) {
+  std::vector<std::string> result;
+  for (const auto& change : buffer) {
+    std::string key{change.first};
+    if (change.second.deleted) {
+      result.push_back("-" + key);
+    } else {
+      result.push_back(key + "=" + std::string{change.second.value});
+    }
+  }
+  return result;
+}
+
+/** Records the operations applied to a WriteBatch. */
+class Recorder : public leveldb::WriteBatch::Handler {
+ public:
+  void Put(const leveldb::Slice& key, const leveldb::Slice& value) override {
+    ops.push_back(key.ToString() + "=" + value.ToString());
+  }
+
+  void Delete(const leveldb::Slice& key) override {
+    ops.push_back("-" + key.ToString());
+  }
+
+  std::vector<std::string> ops;
+};
+
+}  // namespace
+
+TEST(LevelDbWriteBufferTest, KeepsLatestChangeInKeyOrder) {
+  LevelDbWriteBuffer buffer;
+  buffer.Put("b", "1");
+  buffer.Delete("c");
+  buffer.Put("a", "2");
+  buffer.Put("c", "3");
+  buffer.Delete("b");
+  buffer.Put("", "4");
+
+  std::vector<std::string> expected{"=4", "a=2", "-b", "c=3"};
+  EXPECT_EQ(expected, Changes(buffer));
+  EXPECT_EQ(4u, buffer.size());
+
+  EXPECT_TRUE(buffer.find("b")->second.deleted);
+  EXPECT_EQ("3", buffer.find("c")->second.value);
+  EXPECT_TRUE(buffer.find("d") == buffer.end());
+  EXPECT_EQ("c", buffer.lower_bound("bb")->first);
+}
+
+TEST(LevelDbWriteBufferTest, ValuesRemainValidAfterChanges) {
+  LevelDbWriteBuffer buffer;
+  buffer.Put("key", "original");
+  absl::string_view key = buffer.begin()->first;
+  absl::string_view value = buffer.begin()->second.value;
+
+  buffer.Put("key", "overwritten");
+  buffer.Delete("key");
+  for (int i = 0; i < 10000; i++) {
+    buffer.Put("key" + std::to_string(i), std::string(100, 'v'));
+  }
+
+  EXPECT_EQ("key", key);
+  EXPECT_EQ("original", value);
+}
+
+TEST(LevelDbWriteBufferTest, CopiesLargeValues) {
+  LevelDbWriteBuffer buffer;
+  std::string large(100000, 'x');
+  buffer.Put("large", large);
+  buffer.Put("small", "y");
+
+  EXPECT_EQ(large, buffer.find("large")->second.value);
+  EXPECT_EQ("y", buffer.find("small")->second.value);
+  EXPECT_EQ(large.size() + 11, buffer.arena_bytes());
+}
+
+TEST(LevelDbWriteBufferTest, ValuesRemainValidAfterShorterOverwrites) {
+  LevelDbWriteBuffer buffer;
+  buffer.Put("key", "original");
+  absl::string_view original = buffer.find("key")->second.value;
+
+  buffer.Put("key", "short");
+  absl::string_view shorter = buffer.find("key")->second.value;
+  buffer.Put("key", "equal");
+  absl::string_view equal = buffer.find("key")->second.value;
+  buffer.Put("key", "");
+  buffer.Put("key", "x");
+
+  EXPECT_EQ("original", original);
+  EXPECT_EQ("short", shorter);
+  EXPECT_EQ("equal", equal);
+  EXPECT_EQ("x", buffer.find("key")->second.value);
+}
+
+TEST(LevelDbWriteBufferTest, ValuesRemainValidAfterDeleteAndPut) {
+  LevelDbWriteBuffer buffer;
+  buffer.Put("key", "original");
+  absl::string_view value = buffer.find("key")->second.value;
+
+  buffer.Delete("key");
+  buffer.Put("key", "short");
+  EXPECT_EQ("original", value);
+
+  buffer.Delete("key");
+  buffer.Put("key", "replaced");
+  EXPECT_EQ("original", value);
+  EXPECT_EQ("replaced", buffer.find("key")->second.value);
+}
+
+TEST(LevelDbWriteBufferTest, PutsViewsOfCurrentValue) {
+  LevelDbWriteBuffer buffer;
+  buffer.Put("key", "abcdef");
+  absl::string_view value = buffer.find("key")->second.value;
+
+  buffer.Put("key", value.substr(1));
+  EXPECT_EQ("bcdef", buffer.find("key")->second.value);
+  EXPECT_EQ("abcdef", value);
+}
+
+TEST(LevelDbWriteBufferTest, AppendsChangesToBatch) {
+  LevelDbWriteBuffer buffer;
+  buffer.Put("b", "1");
+  buffer.Delete("a");
+  buffer.Put("c", "2");
+
+  leveldb::WriteBatch batch;
+  buffer.AppendTo(&batch);
+  Recorder recorder;
+  ASSERT_TRUE(batch.Iterate(&recorder).ok());
+
+  std::vector<std::string> expected{"-a", "b=1", "c=2"};
+  EXPECT_EQ(expected, recorder.ops);
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
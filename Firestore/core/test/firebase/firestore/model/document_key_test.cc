@@ -157,6 +157,27 @@ TEST(DocumentKey, Comparator) {
   EXPECT_TRUE(util::Comparator<DocumentKey>{}(abcd, xyzw));
 }
 
+TEST(DocumentKey, HashAndToString) {
+  DocumentKey key = Key("rooms/firestore/messages/1");
+  DocumentKey copy = key;
+  DocumentKey equal = Key("rooms/firestore/messages/1");
+
+  EXPECT_EQ(key.Hash(), equal.Hash());
+  EXPECT_EQ(util::Hash(key.path()), key.Hash());
+  EXPECT_EQ(DocumentKeyHash{}(key), key.Hash());
+  EXPECT_NE(key.Hash(), Key("rooms/firestore/messages/2").Hash());
+
+  EXPECT_EQ("rooms/firestore/messages/1", key.ToString());
+  EXPECT_EQ("rooms/firestore/messages/1", equal.ToString());
+  // Copies share the lazily computed canonical string.
+  EXPECT_EQ(&key.ToString(), &copy.ToString());
+
+  DocumentKey moved = std::move(copy);
+  EXPECT_EQ("", copy.ToString());  // NOLINT: use after move intended
+  EXPECT_EQ(DocumentKey{}.Hash(), copy.Hash());
+  EXPECT_EQ(key, moved);
+}
+
 }  // namespace model
 }  // namespace firestore
 }  // namespace firebase
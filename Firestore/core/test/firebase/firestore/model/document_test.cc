@@ -71,6 +71,27 @@ TEST(Document, Comparison) {
                           SnapshotVersion(Timestamp())));
 }
 
+TEST(Document, Hash) {
+  Document doc = MakeDocument("foo", "i/am/a/path", Timestamp(123, 456), true);
+  EXPECT_EQ(doc.Hash(),
+            MakeDocument("foo", "i/am/a/path", Timestamp(123, 456), true)
+                .Hash());
+  EXPECT_NE(doc.Hash(),
+            MakeDocument("bar", "i/am/a/path", Timestamp(123, 456), true)
+                .Hash());
+
+  // Comparisons after the hashes are cached give the same results.
+  Document same = MakeDocument("foo", "i/am/a/path", Timestamp(123, 456), true);
+  Document different =
+      MakeDocument("bar", "i/am/a/path", Timestamp(123, 456), true);
+  same.Hash();
+  different.Hash();
+  EXPECT_EQ(doc, same);
+  EXPECT_NE(doc, different);
+  EXPECT_TRUE(doc.DataEquals(same));
+  EXPECT_FALSE(doc.DataEquals(different));
+}
+
 }  // namespace model
 }  // namespace firestore
 }  // namespace firebase
@@ -17,6 +17,9 @@
 #include "Firestore/core/src/firebase/firestore/model/field_value.h"
 
 #include <climits>
+#include <cmath>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "Firestore/core/test/firebase/firestore/testutil/testutil.h"
@@ -466,6 +469,164 @@ TEST(FieldValue, CompareMixedType) {
   EXPECT_TRUE(array_value < object_value);
 }
 
+TEST(FieldValue, CompareCopiesOfSharedValues) {
+  const FieldValue array_value = FieldValue::ArrayValue(std::vector<FieldValue>{
+      FieldValue::TrueValue(), FieldValue::StringValue("abc")});
+  const FieldValue array_copy = array_value;
+  EXPECT_EQ(array_value, array_copy);
+  EXPECT_FALSE(array_value < array_copy);
+  EXPECT_LT(array_value,
+            FieldValue::ArrayValue(std::vector<FieldValue>{
+                FieldValue::TrueValue(), FieldValue::StringValue("abd")}));
+
+  const FieldValue blob_value = FieldValue::BlobValue(Bytes("abc"), 4);
+  const FieldValue blob_copy = blob_value;
+  EXPECT_EQ(blob_value, blob_copy);
+  EXPECT_FALSE(blob_value < blob_copy);
+  EXPECT_LT(blob_value, FieldValue::BlobValue(Bytes("abd"), 4));
+}
+
+TEST(FieldValue, CompareTo) {
+  using util::ComparisonResult;
+  const FieldValue one = FieldValue::IntegerValue(1);
+  const FieldValue one_point_zero = FieldValue::DoubleValue(1.0);
+  const FieldValue two = FieldValue::DoubleValue(2.0);
+  EXPECT_EQ(ComparisonResult::Same, one.CompareTo(one_point_zero));
+  EXPECT_EQ(ComparisonResult::Same, one_point_zero.CompareTo(one));
+  EXPECT_EQ(ComparisonResult::Ascending, one.CompareTo(two));
+  EXPECT_EQ(ComparisonResult::Descending, two.CompareTo(one));
+  EXPECT_EQ(ComparisonResult::Ascending,
+            one.CompareTo(FieldValue::StringValue("1")));
+
+  const FieldValue timestamp = FieldValue::TimestampValue({100, 0});
+  const FieldValue server_timestamp =
+      FieldValue::ServerTimestampValue({0, 0});
+  EXPECT_EQ(ComparisonResult::Ascending, timestamp.CompareTo(server_timestamp));
+  EXPECT_EQ(ComparisonResult::Descending,
+            server_timestamp.CompareTo(timestamp));
+
+  const FieldValue object = FieldValue::ObjectValueFromMap({
+      {"a", FieldValue::IntegerValue(1)},
+      {"b", FieldValue::IntegerValue(2)},
+  });
+  const FieldValue prefix = FieldValue::ObjectValueFromMap({
+      {"a", FieldValue::IntegerValue(1)},
+  });
+  const FieldValue larger_key = FieldValue::ObjectValueFromMap({
+      {"c", FieldValue::IntegerValue(0)},
+  });
+  EXPECT_EQ(ComparisonResult::Descending, object.CompareTo(prefix));
+  EXPECT_EQ(ComparisonResult::Ascending, prefix.CompareTo(object));
+  EXPECT_EQ(ComparisonResult::Ascending, object.CompareTo(larger_key));
+  EXPECT_EQ(ComparisonResult::Same,
+            object.CompareTo(prefix.Set(testutil::Field("b"),
+                                        FieldValue::DoubleValue(2.0))));
+}
+
+TEST(FieldValue, EqualsAgreesWithCompareTo) {
+  const std::vector<FieldValue> values{
+      FieldValue::NullValue(),
+      FieldValue::FalseValue(),
+      FieldValue::IntegerValue(1),
+      FieldValue::DoubleValue(1.0),
+      FieldValue::NanValue(),
+      FieldValue::TimestampValue({100, 0}),
+      FieldValue::ServerTimestampValue({100, 0}),
+      FieldValue::StringValue("abc"),
+      FieldValue::StringValue("abd"),
+      FieldValue::BlobValue(Bytes("abc"), 4),
+      FieldValue::BlobValue(Bytes("ab"), 3),
+      FieldValue::ArrayValue(std::vector<FieldValue>{
+          FieldValue::IntegerValue(1)}),
+      FieldValue::ArrayValue(std::vector<FieldValue>{
+          FieldValue::DoubleValue(1.0)}),
+      FieldValue::ArrayValue(std::vector<FieldValue>{
+          FieldValue::IntegerValue(1), FieldValue::IntegerValue(2)}),
+      FieldValue::ObjectValueFromMap({{"a", FieldValue::IntegerValue(1)}}),
+      FieldValue::ObjectValueFromMap({{"a", FieldValue::DoubleValue(1.0)}}),
+      FieldValue::ObjectValueFromMap({{"b", FieldValue::IntegerValue(1)}}),
+  };
+  for (const FieldValue& lhs : values) {
+    for (const FieldValue& rhs : values) {
+      EXPECT_EQ(lhs.CompareTo(rhs) == util::ComparisonResult::Same,
+                lhs.Equals(rhs));
+    }
+  }
+}
+
+TEST(FieldValue, HashAgreesWithEquals) {
+  const std::vector<FieldValue> values{
+      FieldValue::NullValue(),
+      FieldValue::TrueValue(),
+      FieldValue::IntegerValue(0),
+      FieldValue::DoubleValue(0.0),
+      FieldValue::DoubleValue(-0.0),
+      FieldValue::IntegerValue(1),
+      FieldValue::DoubleValue(1.0),
+      FieldValue::DoubleValue(1.5),
+      FieldValue::NanValue(),
+      FieldValue::DoubleValue(-NAN),
+      FieldValue::TimestampValue({100, 0}),
+      FieldValue::ServerTimestampValue({100, 0}),
+      FieldValue::ServerTimestampValue({100, 0}, {50, 0}),
+      FieldValue::StringValue("abc"),
+      FieldValue::BlobValue(Bytes("abc"), 4),
+      FieldValue::GeoPointValue({0.0, 1.0}),
+      FieldValue::GeoPointValue({-0.0, 1.0}),
+      FieldValue::ArrayValue(std::vector<FieldValue>{
+          FieldValue::IntegerValue(1)}),
+      FieldValue::ArrayValue(std::vector<FieldValue>{
+          FieldValue::DoubleValue(1.0)}),
+      FieldValue::ObjectValueFromMap({{"a", FieldValue::IntegerValue(1)}}),
+      FieldValue::ObjectValueFromMap({{"a", FieldValue::DoubleValue(1.0)}}),
+      FieldValue::ObjectValueFromMap({{"b", FieldValue::IntegerValue(1)}}),
+  };
+  for (const FieldValue& lhs : values) {
+    for (const FieldValue& rhs : values) {
+      if (lhs == rhs) {
+        EXPECT_EQ(lhs.Hash(), rhs.Hash());
+      }
+    }
+  }
+  EXPECT_NE(FieldValue::StringValue("abc").Hash(),
+            FieldValue::StringValue("abd").Hash());
+}
+
+TEST(FieldValue, CachedHashIsCopied) {
+  const FieldValue value = FieldValue::ObjectValueFromMap({
+      {"a", FieldValue::StringValue("A")},
+  });
+  size_t hash = value.Hash();
+  const FieldValue copy = value;
+  EXPECT_EQ(hash, copy.Hash());
+
+  // Values with cached hashes still compare correctly.
+  const FieldValue other = value.Set(testutil::Field("a"),
+                                     FieldValue::StringValue("B"));
+  other.Hash();
+  EXPECT_NE(value, other);
+  EXPECT_EQ(value, copy);
+}
+
+TEST(FieldValue, MovedFromValueDropsCachedHash) {
+  FieldValue source = FieldValue::StringValue("abc");
+  source.Hash();
+  FieldValue moved = std::move(source);
+  EXPECT_EQ(FieldValue::StringValue("abc"), moved);
+  EXPECT_EQ(FieldValue::StringValue("abc").Hash(), moved.Hash());
+  EXPECT_EQ(FieldValue::StringValue(""), source);
+  EXPECT_EQ(FieldValue::StringValue("").Hash(), source.Hash());
+
+  FieldValue target = FieldValue::StringValue("xyz");
+  target.Hash();
+  source = FieldValue::StringValue("abc");
+  source.Hash();
+  target = std::move(source);
+  EXPECT_EQ(FieldValue::StringValue("abc"), target);
+  EXPECT_EQ(FieldValue::StringValue("xyz"), source);
+  EXPECT_EQ(FieldValue::StringValue("xyz").Hash(), source.Hash());
+}
+
 TEST(FieldValue, CompareWithOperator) {
   const FieldValue small = FieldValue::NullValue();
   const FieldValue large = FieldValue::TrueValue();
@@ -527,6 +688,56 @@ TEST(FieldValue, SetRecursive) {
             value.Set(testutil::Field("b.bb"), FieldValue::StringValue("BB")));
 }
 
+TEST(FieldValue, SetLeavesOriginalUnchanged) {
+  const FieldValue value = FieldValue::ObjectValueFromMap({
+      {"a", FieldValue::StringValue("A")},
+      {"b", FieldValue::ObjectValueFromMap({
+                {"ba", FieldValue::StringValue("BA")},
+            })},
+  });
+  const FieldValue copy = value;
+  const FieldValue modified =
+      value.Set(testutil::Field("b.ba"), FieldValue::StringValue("changed"));
+  EXPECT_EQ(copy, value);
+  EXPECT_EQ(FieldValue::StringValue("changed"),
+            *modified.Get(testutil::Field("b.ba")));
+  EXPECT_EQ(FieldValue::StringValue("A"), *modified.Get(testutil::Field("a")));
+}
+
+TEST(FieldValue, SetGetDeleteInLargeObject) {
+  // Enough fields to use the tree-based representation of the object map.
+  FieldValue value = FieldValue::ObjectValueFromMap({});
+  for (int i = 0; i < 100; i++) {
+    value = value.Set(FieldPath{"f" + std::to_string(i), "nested"},
+                      FieldValue::IntegerValue(i));
+  }
+  EXPECT_EQ(100u, value.object_value().internal_value.size());
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(FieldValue::IntegerValue(i),
+              *value.Get(FieldPath{"f" + std::to_string(i), "nested"}));
+  }
+
+  const FieldValue deleted = value.Delete(testutil::Field("f50"));
+  EXPECT_EQ(99u, deleted.object_value().internal_value.size());
+  EXPECT_EQ(absl::nullopt, deleted.Get(testutil::Field("f50.nested")));
+  EXPECT_EQ(FieldValue::IntegerValue(50),
+            *value.Get(testutil::Field("f50.nested")));
+}
+
+TEST(FieldValue, ObjectFieldsAreSorted) {
+  const FieldValue value = FieldValue::ObjectValueFromMap({
+      {"c", FieldValue::IntegerValue(3)},
+      {"a", FieldValue::IntegerValue(1)},
+      {"b", FieldValue::IntegerValue(2)},
+  });
+  std::vector<std::string> keys;
+  for (const auto& kv : value.object_value().internal_value) {
+    keys.push_back(kv.first);
+  }
+  EXPECT_EQ((std::vector<std::string>{"a", "b", "c"}), keys);
+  EXPECT_EQ(FieldValue::IntegerValue(1), *value.Get(testutil::Field("a")));
+}
+
 TEST(FieldValue, Delete) {
   const FieldValue value = FieldValue::ObjectValueFromMap({
       {"a", FieldValue::StringValue("A")},
@@ -72,6 +72,27 @@ TEST(ResourcePath, Comparison) {
   EXPECT_TRUE(ab > a);
 }
 
+TEST(ResourcePath, SharedAndUnsharedParentsCompareByValue) {
+  const ResourcePath path = ResourcePath::FromString("rooms/a");
+  const ResourcePath child = path.Append("messages").Append("1");
+  const ResourcePath built{"rooms", "a", "messages", "1"};
+  const std::vector<std::string> moved{"rooms", "a", "messages", "1"};
+
+  EXPECT_EQ(child, ResourcePath::FromString("rooms/a/messages/1"));
+  EXPECT_EQ(child, built);
+  EXPECT_EQ(child, ResourcePath{std::vector<std::string>{moved}});
+  EXPECT_EQ(path, child.PopLast().PopLast());
+  EXPECT_EQ(ResourcePath::FromString("a/messages/1"), child.PopFirst());
+  EXPECT_TRUE(path.IsPrefixOf(child));
+
+  EXPECT_TRUE(child < ResourcePath::FromString("rooms/a/messages/2"));
+  EXPECT_TRUE(child < ResourcePath::FromString("rooms/b/messages/1"));
+  EXPECT_TRUE(ResourcePath::FromString("rooms/a/messages") < child);
+  EXPECT_FALSE(child < built);
+  EXPECT_TRUE(child <= built);
+  EXPECT_TRUE(child >= built);
+}
+
 TEST(ResourcePath, Parsing) {
   const auto parse = [](const std::pair<std::string, size_t> expected) {
     const auto path = ResourcePath::FromString(expected.first);
@@ -93,11 +114,15 @@ TEST(ResourcePath, Parsing) {
   EXPECT_EQ(expected, parse(expected));
 
   EXPECT_EQ(ResourcePath::FromString("/foo/").CanonicalString(), "foo");
+  EXPECT_EQ(ResourcePath::FromString("/foo/bar/"),
+            ResourcePath::FromString("foo/bar"));
+  EXPECT_TRUE(ResourcePath::FromString("/").empty());
 }
 
 TEST(ResourcePath, ParseFailures) {
   ASSERT_ANY_THROW(ResourcePath::FromString("//"));
   ASSERT_ANY_THROW(ResourcePath::FromString("foo//bar"));
+  ASSERT_ANY_THROW(ResourcePath::FromString("foo/bar//"));
 }
 
 }  // namespace model
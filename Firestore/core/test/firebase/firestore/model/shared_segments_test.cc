@@ -0,0 +1,111 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/firebase/firestore/model/shared_segments.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/base/config.h"
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace model {
+namespace impl {
+
+namespace {
+
+SharedSegments Find(const std::vector<std::string>& segments) {
+  return SharedSegments::Find(segments.begin(), segments.end());
+}
+
+}  // namespace
+
+TEST(SharedSegments, HoldsSegments) {
+  std::vector<absl::string_view> views{"rooms", "Eros", "messages"};
+  SharedSegments segments = SharedSegments::Copy(views.begin(), views.end());
+  ASSERT_EQ(3u, segments.size());
+  EXPECT_EQ("rooms", segments[0]);
+  EXPECT_EQ("Eros", segments[1]);
+  EXPECT_EQ("messages", segments[2]);
+
+  SharedSegments copy = segments;
+  EXPECT_TRUE(copy.SameAs(segments));
+  SharedSegments moved = std::move(copy);
+  EXPECT_TRUE(moved.SameAs(segments));
+  EXPECT_EQ(0u, copy.size());  // NOLINT: use after move intended
+}
+
+TEST(SharedSegments, EmptyListsAreTheSame) {
+  std::vector<std::string> none;
+  EXPECT_EQ(0u, Find(none).size());
+  EXPECT_TRUE(Find(none).SameAs(SharedSegments{}));
+  EXPECT_TRUE(SharedSegments::Copy(none.begin(), none.end())
+                  .SameAs(SharedSegments{}));
+}
+
+TEST(SharedSegments, CopyNeverShares) {
+  std::vector<std::string> values{"rooms", "Eros"};
+  SharedSegments first = SharedSegments::Copy(values.begin(), values.end());
+  SharedSegments second = SharedSegments::Copy(values.begin(), values.end());
+  EXPECT_FALSE(first.SameAs(second));
+}
+
+#if ABSL_HAVE_THREAD_LOCAL
+
+TEST(SharedSegments, FindSharesEqualSegments) {
+  SharedSegments first = Find({"rooms", "Eros"});
+  SharedSegments second = Find({"rooms", "Eros"});
+  EXPECT_TRUE(first.SameAs(second));
+
+  EXPECT_FALSE(first.SameAs(Find({"rooms", "Eros", "messages"})));
+  EXPECT_FALSE(first.SameAs(Find({"rooms"})));
+  EXPECT_FALSE(first.SameAs(Find({"roomsEros"})));
+}
+
+TEST(SharedSegments, SharedListsOutliveTheCache) {
+  SharedSegments first = Find({"rooms", "Eros"});
+
+  // Evict the list by filling every slot with others.
+  for (int i = 0; i < 1000; ++i) {
+    Find({"rooms", std::to_string(i)});
+  }
+
+  ASSERT_EQ(2u, first.size());
+  EXPECT_EQ("rooms", first[0]);
+  EXPECT_EQ("Eros", first[1]);
+}
+
+TEST(SharedSegments, ThreadsKeepSeparateCaches) {
+  SharedSegments mine = Find({"rooms", "Eros"});
+  SharedSegments theirs;
+  std::thread thread{[&theirs] { theirs = Find({"rooms", "Eros"}); }};
+  thread.join();
+
+  EXPECT_FALSE(mine.SameAs(theirs));
+  ASSERT_EQ(2u, theirs.size());
+  EXPECT_EQ("Eros", theirs[1]);
+}
+
+#endif  // ABSL_HAVE_THREAD_LOCAL
+
+}  // namespace impl
+}  // namespace model
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/firebase/firestore/nanopb/reader.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Firestore/core/include/firebase/firestore/firestore_errors.h"
+#include "absl/strings/string_view.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace nanopb {
+
+namespace {
+
+/** Returns the encoding of a length-delimited field's value. */
+std::vector<uint8_t> EncodeString(const std::string& value) {
+  std::vector<uint8_t> bytes;
+  size_t size = value.size();
+  do {
+    uint8_t byte = size & 0x7f;
+    size >>= 7;
+    bytes.push_back(size ? byte | 0x80 : byte);
+  } while (size);
+  bytes.insert(bytes.end(), value.begin(), value.end());
+  return bytes;
+}
+
+}  // namespace
+
+TEST(ReaderTest, ReadStringViewRefersToInput) {
+  std::vector<uint8_t> bytes = EncodeString("hello");
+  std::vector<uint8_t> second = EncodeString(std::string(200, 'x'));
+  bytes.insert(bytes.end(), second.begin(), second.end());
+
+  Reader reader = Reader::Wrap(bytes.data(), bytes.size());
+  absl::string_view hello = reader.ReadStringView();
+  absl::string_view xs = reader.ReadStringView();
+  ASSERT_TRUE(reader.status().ok());
+
+  EXPECT_EQ("hello", hello);
+  EXPECT_EQ(reinterpret_cast<const char*>(bytes.data() + 1), hello.data());
+  EXPECT_EQ(std::string(200, 'x'), xs);
+  EXPECT_EQ(reinterpret_cast<const char*>(bytes.data() + 8), xs.data());
+}
+
+TEST(ReaderTest, ReadStringViewOfEmptyString) {
+  std::vector<uint8_t> bytes = EncodeString("");
+  Reader reader = Reader::Wrap(bytes.data(), bytes.size());
+  EXPECT_EQ("", reader.ReadStringView());
+  EXPECT_TRUE(reader.status().ok());
+}
+
+TEST(ReaderTest, ReadStringViewFailsOnTruncatedInput) {
+  std::vector<uint8_t> bytes = EncodeString("hello");
+  bytes.pop_back();
+
+  Reader reader = Reader::Wrap(bytes.data(), bytes.size());
+  absl::string_view result = reader.ReadStringView();
+  EXPECT_TRUE(result.empty());
+  EXPECT_EQ(FirestoreErrorCode::DataLoss, reader.status().code());
+
+  // Once failed, the reader doesn't read any further.
+  EXPECT_TRUE(reader.ReadStringView().empty());
+  EXPECT_EQ(FirestoreErrorCode::DataLoss, reader.status().code());
+}
+
+TEST(ReaderTest, ReadStringCopies) {
+  std::vector<uint8_t> bytes = EncodeString("hello");
+  Reader reader = Reader::Wrap(bytes.data(), bytes.size());
+  std::string result = reader.ReadString();
+  bytes.assign(bytes.size(), 0);
+  EXPECT_EQ("hello", result);
+  EXPECT_TRUE(reader.status().ok());
+}
+
+}  // namespace nanopb
+}  // namespace firestore
+}  // namespace firebase
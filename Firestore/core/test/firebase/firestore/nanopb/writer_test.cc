@@ -0,0 +1,82 @@
+/*
+ * Copyright 2018 Google
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/firebase/firestore/nanopb/writer.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Firestore/core/include/firebase/firestore/firestore_errors.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace nanopb {
+
+using util::Status;
+
+namespace {
+
+/** Writes a nested message holding `value` as a single string field. */
+void WriteStringMessage(Writer* writer, const std::string& value) {
+  writer->WriteTag({PB_WT_STRING, 1});
+  writer->WriteNestedMessage([&value](Writer* message) {
+    message->WriteTag({PB_WT_STRING, 1});
+    message->WriteString(value);
+  });
+}
+
+}  // namespace
+
+TEST(WriterTest, WritesNestedMessagesInPlace) {
+  std::vector<uint8_t> bytes;
+  Writer writer = Writer::Wrap(&bytes);
+  WriteStringMessage(&writer, "abc");
+  ASSERT_TRUE(writer.status().ok());
+
+  std::vector<uint8_t> expected{0x0a, 0x05, 0x0a, 0x03, 'a', 'b', 'c'};
+  EXPECT_EQ(expected, bytes);
+  EXPECT_EQ(expected.size(), writer.bytes_written());
+}
+
+TEST(WriterTest, FailedNestedMessageLeavesNoBytesBehind) {
+  std::vector<uint8_t> bytes;
+  Writer writer = Writer::Wrap(&bytes);
+  WriteStringMessage(&writer, "abc");
+  std::vector<uint8_t> before = bytes;
+
+  writer.WriteTag({PB_WT_STRING, 2});
+  size_t tag_end = bytes.size();
+  writer.WriteNestedMessage([](Writer* outer) {
+    WriteStringMessage(outer, std::string(200, 'x'));
+    outer->WriteTag({PB_WT_STRING, 2});
+    outer->WriteNestedMessage([](Writer* inner) {
+      inner->WriteTag({PB_WT_STRING, 1});
+      inner->WriteString("partial");
+      inner->set_status(Status{FirestoreErrorCode::Internal, "failed"});
+    });
+  });
+
+  EXPECT_EQ(FirestoreErrorCode::Internal, writer.status().code());
+  before.push_back(0x12);
+  EXPECT_EQ(before, bytes);
+  EXPECT_EQ(tag_end, bytes.size());
+}
+
+}  // namespace nanopb
+}  // namespace firestore
+}  // namespace firebase
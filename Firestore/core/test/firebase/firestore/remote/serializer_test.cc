@@ -481,6 +481,38 @@ TEST_F(SerializerTest, EncodesNestedObjects) {
   ExpectRoundTrip(model, proto, FieldValue::Type::Object);
 }
 
+TEST_F(SerializerTest, EncodesDeeplyNestedObjects) {
+  // Nested messages are written before their lengths are known, so exercise
+  // lengths that need one, two and three byte varints at various depths.
+  const std::string long_string(300, 'x');
+  const std::string longer_string(20000, 'y');
+
+  FieldValue model = FieldValue::ObjectValueFromMap({
+      {"s", FieldValue::StringValue(longer_string)},
+  });
+  v1beta1::Value proto;
+  (*proto.mutable_map_value()->mutable_fields())["s"] =
+      ValueProto(longer_string);
+
+  for (int depth = 0; depth < 10; depth++) {
+    model = FieldValue::ObjectValueFromMap({
+        {"i", FieldValue::IntegerValue(depth)},
+        {"nested", model},
+        {"s", FieldValue::StringValue(depth % 2 ? long_string : "short")},
+    });
+
+    v1beta1::Value parent_proto;
+    google::protobuf::Map<std::string, v1beta1::Value>* fields =
+        parent_proto.mutable_map_value()->mutable_fields();
+    (*fields)["i"] = ValueProto(int64_t{depth});
+    (*fields)["nested"] = proto;
+    (*fields)["s"] = ValueProto(depth % 2 ? long_string : "short");
+    proto = parent_proto;
+  }
+
+  ExpectRoundTrip(model, proto, FieldValue::Type::Object);
+}
+
 TEST_F(SerializerTest, EncodesFieldValuesWithRepeatedEntries) {
   // Technically, serialized Value protos can contain multiple values. (The last
   // one "wins".) However, well-behaved proto emitters (such as libprotobuf)
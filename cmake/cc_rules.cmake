@@ -67,6 +67,28 @@ function(cc_test name)
   target_link_libraries(${name} ${cct_DEPENDS})
 endfunction()
 
+# cc_benchmark(
+#   target
+#   SOURCES sources...
+#   DEPENDS libraries...
+# )
+#
+# Defines a new benchmark executable target with the given target name,
+# sources, and dependencies. Implicitly adds DEPENDS on benchmark::benchmark
+# and benchmark::benchmark_main. Benchmarks are built by default but are not
+# registered with CTest; run them directly.
+function(cc_benchmark name)
+  set(multi DEPENDS SOURCES)
+  cmake_parse_arguments(ccb "" "" "${multi}" ${ARGN})
+
+  list(APPEND ccb_DEPENDS benchmark::benchmark benchmark::benchmark_main)
+
+  add_executable(${name} ${ccb_SOURCES})
+  add_objc_flags(${name} ccb)
+
+  target_link_libraries(${name} ${ccb_DEPENDS})
+endfunction()
+
 # add_objc_flags(target sources...)
 #
 # Adds OBJC_FLAGS to the compile options of the given target if any of the
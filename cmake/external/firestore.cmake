@@ -13,6 +13,7 @@
 # limitations under the License.
 
 include(ExternalProject)
+include(external/benchmark)
 include(external/googletest)
 include(external/grpc)
 include(external/leveldb)
@@ -26,6 +27,7 @@ endif()
 ExternalProject_Add(
   Firestore
   DEPENDS
+    benchmark
     googletest
     grpc
     leveldb